@@ -2,19 +2,152 @@
 #include <GLFW/glfw3.h>
 #include "stb_image.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <random>
+#include <vector>
 
 #include "shader_master.h" // Shader header file that reads shaders from disk, compiles and links them & checks for errors
+#include "shader_batch.h" // Compiles all our shader programs in one go (in parallel where the driver supports it)
+#include "gl_extensions.h" // Optional extensions above our 3.3 core GLAD
+#include "frame_timing.h" // Fixed timestep simulation + frame limiter
+#include "redraw_tracker.h" // Dirty flags for render-on-demand
+#include "command_buffer.h" // Deferred GL command lists (recorded on any thread, replayed on the GL thread)
+#include "render_thread.h" // Render thread that owns the GL context + SPSC frame queue
+#include "render_queue.h" // Sort-key draw queue
+#include "gl_state_cache.h" // Skips redundant program/texture/VAO binds
+#include "render_graph.h" // Passes + their render targets (FBOs allocated & aliased automatically)
+#include "dynamic_resolution.h" // Scene resolution follows the frame time (GPU timer queries)
+#include "culling.h" // SIMD frustum culling + CPU Hi-Z occlusion culling
+#include "scene_storage.h" // Entities & their components in per-archetype arrays
+#include "simd_math.h" // Vec/Mat4/Quat (SSE/NEON)
+#include "transform_hierarchy.h" // Parent/child transforms, breadth-first, dirty subtrees only
+#include "job_system.h" // Shared worker threads (parallel loops over the scene)
+#include "texture_master.h" // Image loading through the VFS
+#include "texture_streaming.h" // Mip levels streamed in as the draws need them
+#include "texture_hdr.h" // .hdr & 16 bit images -> half float / packed float textures
+#include "texture_objects.h" // Immutable texture storage + shared sampler objects + texture quality tiers
+#include "virtual_texture.h" // Images of any size drawn from a fixed page cache
+#include "mesh_master.h" // Cooked mesh loading through the VFS
+#include "virtual_fs.h" // Asset pack + loose file access
+
+// Everything the simulation updates. Rendering draws an interpolation of the last two states:
+struct SimulationState
+{
+	float mixIntensity; // Just for textures blending
+	float cameraX; // Center of the view in world units (WASD)
+	float cameraY;
+	float time; // Seconds of simulated time, drives the scene animation
+	TextureQuality textureQuality; // Keys 1 to 4
+};
+
+// Everything the render side needs for one frame. The main thread builds it, the render thread only reads its own copy:
+struct FrameSnapshot
+{
+	SimulationState state; // Already interpolated for this frame
+	int framebufferWidth;
+	int framebufferHeight;
+	bool representOnly; // Nothing changed, just put the last frame on screen again
+};
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void processInput(GLFWwindow* window);
+void window_refresh_callback(GLFWwindow* window);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void processInput(GLFWwindow* window, SimulationState& state, float dt);
+bool isInputActive(GLFWwindow* window);
+SimulationState interpolateState(const SimulationState& previous, const SimulationState& current, float alpha);
+void makeCamera(const SimulationState& state, float aspect, Mat4& view, Mat4& projection);
 
 //Settings:
 const unsigned int SCREEN_WIDTH = 800;
 const unsigned int SCREEN_HEIGHT = 600;
 
-// Just for textures blending:
-float MIX_INTENSITY = 0.2f;
+// Asset pack built by Tools/asset_packer.cpp. If it's missing every asset is read as a loose file instead:
+const char* ASSET_PACK_PATH = "HelloGPU.hgpak";
+
+// Cooked mesh every scene instance draws (built from Meshes/quad.obj by Tools/mesh_cooker.cpp):
+const char* QUAD_MESH_PATH = "Meshes/quad.hgmesh";
+
+// Just for textures blending (starting value, and how fast UP/DOWN change it):
+const float MIX_INTENSITY = 0.2f;
+const float MIX_CHANGE_PER_SECOND = 1.0f;
+
+// Simulation runs at a fixed rate whatever the render rate is:
+const double SIMULATION_STEP = 1.0 / 60.0;
+
+// Frame pacing: VSync, Unlimited, Target (sleep + spin to TARGET_FPS) or Adaptive (late frames tear instead of waiting a whole vblank):
+const FrameLimitMode FRAME_LIMIT_MODE = FrameLimitMode::VSync;
+const double TARGET_FPS = 60.0;
+
+// Render on demand: only draw when something changed (input, resize, streamed resources) and otherwise block waiting for events.
+// The timeout just makes sure we wake up now and then even if nobody posts an event:
+const bool RENDER_ON_DEMAND = true;
+const double IDLE_WAIT_TIMEOUT = 0.5;
+
+// Render on a dedicated thread that owns the GL context, so a blocking swap doesn't stall input & simulation:
+const bool USE_RENDER_THREAD = true;
+
+// Dynamic resolution: the scene is rendered at a fraction of the window size that shrinks when a frame takes longer than
+// the budget and grows back when there's headroom, then upscaled to the window (sharpness 0 = plain bilinear blit):
+const bool DYNAMIC_RESOLUTION = true;
+const double FRAME_BUDGET_MS = 1000.0 / 60.0;
+const float DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;
+const float DYNAMIC_RESOLUTION_MAX_SCALE = 1.0f;
+const float UPSCALE_SHARPNESS = 0.3f;
+
+// Scene: SCENE_INSTANCE_COUNT copies of our quad scattered over a square world and over depth, seen through an orthographic
+// camera VIEW_HEIGHT world units tall. WASD pans it. The quads come in clusters: a root with up to SCENE_MAX_CHILDREN smaller
+// quads attached around it, which may have children of their own, SCENE_HIERARCHY_DEPTH levels in all. SCENE_MOVING_FRACTION
+// of the clusters drift and spin (children carried along by their parents) while ANIMATE_SCENE is on (the transforms are
+// updated on all cores every frame). Off by default: a moving scene redraws every frame, so render-on-demand would never
+// idle. Turn it on to measure the transform update:
+const unsigned int SCENE_INSTANCE_COUNT = 150000;
+const unsigned int SCENE_MAX_CHILDREN = 3;
+const unsigned int SCENE_HIERARCHY_DEPTH = 3;
+const float SCENE_MOVING_FRACTION = 0.75f;
+const bool ANIMATE_SCENE = false;
+const float SCENE_WORLD_SIZE = 160.0f;
+const float SCENE_DEPTH = 20.0f;
+const float VIEW_HEIGHT = 4.0f;
+const float CAMERA_SPEED = 3.0f;
+
+// Culling: frustum culling always runs, occlusion culling tests the survivors against a small CPU depth buffer filled with
+// the biggest instances (at most OCCLUDER_BUDGET of them per frame):
+const bool OCCLUSION_CULLING = true;
+const float OCCLUDER_MIN_SCALE = 1.0f;
+const unsigned int OCCLUDER_BUDGET = 64;
+
+// Level of detail: meshes cooked with a LOD chain draw, per instance, the coarsest level that is at most LOD_PIXEL_ERROR
+// pixels away from the full mesh on screen. LOD_HYSTERESIS is the margin around that budget where an instance keeps its
+// level, so it doesn't pop between two levels every frame (see mesh_lod.h):
+const float LOD_PIXEL_ERROR = 1.0f;
+const float LOD_HYSTERESIS = 0.25f;
+
+// Texture streaming: at startup only the mip levels up to TEXTURE_RESIDENT_TAIL_SIZE texels go on the GPU. Finer ones are
+// decoded in the background when the instances on screen get big enough to sample them, and levels nobody needs anymore are
+// dropped (least recently needed first) once the streamed textures would take more than TEXTURE_MEMORY_BUDGET bytes
+// (see texture_streaming.h):
+const int TEXTURE_RESIDENT_TAIL_SIZE = 64;
+const size_t TEXTURE_MEMORY_BUDGET = 32u << 20;
+
+// Texture quality tier at startup. Keys 1 to 4 switch between Low, Medium, High and Ultra while running: anisotropic filtering,
+// mip bias, trilinear or bilinear mip filtering and the finest mip level the streaming keeps (see texture_objects.h). Low end
+// machines trade sharpness for sampling cost & texture memory here:
+const TextureQuality TEXTURE_QUALITY = TextureQuality::High;
+
+// High precision images (.hdr, 16 bit PNGs) skip the streaming and are uploaded whole in this format: Rgba16F (8 bytes a texel,
+// keeps alpha) or, at 4 bytes a texel without alpha, R11G11B10F or Rgb9E5 (see texture_hdr.h). Any of them is half the memory
+// of GL_RGBA32F or less:
+const HdrTextureFormat HDR_TEXTURE_FORMAT = HdrTextureFormat::Rgba16F;
+
+// Virtual texturing: a world map behind the scene (as wide as SCENE_WORLD_SIZE, at the back of the depth range), tiled by
+// Tools/texture_tiler.cpp. Only the pages on screen are loaded, into a cache of VIRTUAL_TEXTURE_CACHE_PAGES x
+// VIRTUAL_TEXTURE_CACHE_PAGES pages of 128x128 texels, whatever the size of the image. Without the file there's no backdrop
+// (see virtual_texture.h):
+const char* WORLD_MAP_PATH = "Textures/world.hgvt";
+const int VIRTUAL_TEXTURE_CACHE_PAGES = 16;
+const int VIRTUAL_TEXTURE_FEEDBACK_DIVISOR = 8;
 
 
 int main()
@@ -23,6 +156,7 @@ int main()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE); //Ask for a window framebuffer that can encode linear colors to sRGB when we write to it
 
 	//Instantiate a GLFW window:
 	GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Hello GPU", NULL, NULL); //This function returns a pointer to a new window
@@ -43,6 +177,18 @@ int main()
 		std::cout << "GLAD: Failed to initialize GLAD ! .. terminating" << std::endl; //Check if it failed
 		return -1;
 	}
+	//Look up the extensions we can use on top of 3.3 core (same loader as GLAD):
+	initGLExtensions((GLADloadproc)glfwGetProcAddress);
+
+	//Color management: color textures are GL_SRGB8_ALPHA8 so the sampler decodes them to linear, the shaders light, mix & blend in
+	//linear space, and with GL_FRAMEBUFFER_SRGB every write to an sRGB render target (the scene texture, the window) is encoded back.
+	//If the window framebuffer can't encode (driver ignored the hint), the present shader does that last encode itself:
+	glEnable(GL_FRAMEBUFFER_SRGB);
+	GLint backbufferEncoding = GL_LINEAR;
+	glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_BACK_LEFT, GL_FRAMEBUFFER_ATTACHMENT_COLOR_ENCODING, &backbufferEncoding);
+	bool srgbBackbuffer = backbufferEncoding == GL_SRGB;
+	if (!srgbBackbuffer)
+		std::cout << "sRGB: the window framebuffer is linear, the present pass encodes to sRGB in its shader" << std::endl;
 
 
 	//After GLFW created a window for our game and GLAD specified exact OpenGL version, we have to tell OpenGL the size of the rendering window
@@ -51,68 +197,99 @@ int main()
 
 	//We register the callback functions after we've created the window and before the render loop is initiated:
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback); //Resize the render viewport whenever user resizes GLFW window by registering the callback we wrote to our GLFW window
+	glfwSetWindowRefreshCallback(window, window_refresh_callback); //Window contents got damaged (uncovered, moved ...) and must be shown again
+	glfwSetKeyCallback(window, key_callback); //Key presses & releases wake the loop even while it idles
 
 
 
-	//Build & Compile a shader program:
-	Shader myShader("Shaders/vertexShader/RGB_HelloTriangle_vertexSh.glsl", "Shaders/fragmentShader/RGB_HelloTriangle_fragSh.glsl");
+	//Mount the asset pack before loading anything so shaders and textures come out of one mapped file:
+	VirtualFS::get().mountPack(ASSET_PACK_PATH);
 
+	//Build & Compile shader programs as one batch: every compile/link is issued now, results are checked after the buffers & textures are set up
+	//so the driver compiles in the background (KHR_parallel_shader_compile) while we do the rest of the startup work:
+	double shaderSubmitTime = glfwGetTime();
+	ShaderBatch::setMaxCompilerThreads();
+	ShaderBatch shaderBatch;
+	int helloTriangleProgram = shaderBatch.add("Shaders/vertexShader/RGB_HelloTriangle_vertexSh.glsl", "Shaders/fragmentShader/RGB_HelloTriangle_fragSh.glsl");
+	int presentProgram = shaderBatch.add("Shaders/vertexShader/Fullscreen_vertexSh.glsl",
+		UPSCALE_SHARPNESS > 0.0f ? "Shaders/fragmentShader/Sharpen_fragSh.glsl" : "Shaders/fragmentShader/Blit_fragSh.glsl");
+	int worldMapProgram = shaderBatch.add("Shaders/vertexShader/VirtualTexture_vertexSh.glsl", "Shaders/fragmentShader/VirtualTexture_fragSh.glsl");
+	int worldMapFeedbackProgram = shaderBatch.add("Shaders/vertexShader/VirtualTexture_vertexSh.glsl", "Shaders/fragmentShader/VirtualTextureFeedback_fragSh.glsl");
+	shaderBatch.submit();
+	double shaderSubmitMs = (glfwGetTime() - shaderSubmitTime) * 1000.0;
 
+	//Decode the images on the job system while we set up the buffers; only the upload (glTexImage2D) has to wait for them on this thread.
+	//Only their mip tails are kept (the small levels), the rest is streamed in later when the draws need it:
+	// If images loaded flipped:
+	stbi_set_flip_vertically_on_load(true); // Set before the jobs start, they only read it (the streaming jobs too)
+	const char* imagePaths[2] = { "Textures/images/island.png", "Textures/images/kenway.png" };
+	DecodedMips decodedImages[2];
+	HdrMips decodedHdrImages[2]; // Instead, for .hdr & 16 bit images
+	JobCounter imageDecodeJobs;
+	double imageDecodeTime = glfwGetTime();
+	for (int i = 0; i < 2; i++)
+	{
+		JobSystem::get().run([&decodedImages, &decodedHdrImages, &imagePaths, i]()
+		{
+			// The file's header picks the path (stbi_is_hdr / stbi_is_16_bit): high precision images are decoded to float and
+			// converted to HDR_TEXTURE_FORMAT, every level at once
+			if (imagePrecision(imagePaths[i]) != ImagePrecision::Ldr8)
+			{
+				decodeHdrMips(imagePaths[i], ColorSpace::Srgb, HDR_TEXTURE_FORMAT, decodedHdrImages[i]);
+				return;
+			}
+			// Load a 2D image using stb_image.h function (through the VFS, see texture_master.h) and filter it down to its tail:
+			decodeMipTail(imagePaths[i], ColorSpace::Srgb, TEXTURE_RESIDENT_TAIL_SIZE, decodedImages[i]); // Both are color images
+		}, &imageDecodeJobs);
+	}
 
-	//To start drawing something (Start the graphics pipeline) we have to first give OpenGL some input vertex data after processing it:
-	//Step_1:Vertex data definition:
-	float GLTriangles_Vertices[] = {
-		// Position attribute:    Color toward vertex:   texture[0] Coords:   texture[1] Coords:     EBO index:
-		//X:   Y:    Z:           R:    G:    B:         S:     T:             S:     T:
-	    0.5f,  0.5f, 0.0f,        1.0f, 0.0f, 0.0f,      1.0f,  1.0f,          1.0f,  1.0f,          // (0) Right Top
-	    0.5f, -0.5f, 0.0f,        0.0f, 1.0f, 0.0f,      1.0f,  0.0f,          1.0f,  0.0f,          // (1) Right Bottom
-	   -0.5f, -0.5f, 0.0f,        0.0f, 0.0f, 1.0f,      0.0f,  0.0f,          0.0f,  0.0f,          // (2) Left Bottom
-	   -0.5f,  0.5f, 0.0f,        1.0f, 0.0f, 1.0f,      0.0f,  1.0f,          0.0f,  1.0f           // (3) Left Top
-	};
-	//EBO is buffer for storing indices of vertices we have (each unique vertex has an index) for index drawing
-	unsigned int eboIndices[] = {
-		0, 1, 3,
-		1, 2, 3
-	};
 
-	//Step_2:Generating buffer objects with a buffer ID for each one:
-	unsigned int VBO, VAO, EBO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-
-	//Step_3:Binding VAO first that will store upcoming-to-be-bound:
-	//-----> 1) Vertex attribute configurations via glVertexAttribPointer & Vertex buffer objects associated with vertex attributes by calls to glVertexAttribPointer
-	//-----> 2) EBO (if VAO is unbound firstly)
-	glBindVertexArray(VAO);
-
-	//Step_4:Binding every generated buffer with the target suitable for its type
-	//Step_5:Copy pre-defined data into the currently bound (allocated) buffer to store this data on GPU VRAM
-	glBindBuffer(GL_ARRAY_BUFFER, VBO); //We chose GL_ARRAY_BUFFER to indicate that we are binding a vertex buffer (its type basically which is an array of values back to back)
-	//From that point on any buffer calls we make (on the GL_ARRAY_BUFFER target) will be used to configure the currently bound buffer, which is VBO
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLTriangles_Vertices), GLTriangles_Vertices, GL_STATIC_DRAW); //This function starts passing data into the VRAM buffer
-	
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO); //We chose GL_ELEMENT_ARRAY_BUFFER this time to indicate that we are binding an element buffer (its type basically which is an array of elements (indices) back to back)
-	//From that point on any buffer calls we make (on the GL_ELEMENT_ARRAY_BUFFER target) will be used to configure the currently bound buffer, which is EBO
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(eboIndices), eboIndices, GL_STATIC_DRAW);
-
-	//Step_6:Interpreting vertex data by specifying each single vertex and each single attribute of this single vertex
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)0); //Position attribute data (1st attribute)
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(3 * sizeof(float))); //Color attribute data (2nd attribute)
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(6 * sizeof(float))); //Texture[0] Coords attribute data (3rd attribute)
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(8 * sizeof(float))); //Texture[1] Coords attribute data (3rd attribute)
-	glEnableVertexAttribArray(3);
-
-	//Step_7:Unbind buffers to free VRAM
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	// REMEMBER!!: Do NOT unbind the EBO while a VAO is active as the bound element buffer object IS stored in the VAO; keep the EBO bound
+	//To start drawing something (Start the graphics pipeline) we have to first give OpenGL some input vertex data:
+	//The quad comes from a cooked mesh (Tools/mesh_cooker.cpp turns Meshes/quad.obj into it), so this is one map of the file
+	//and one glBufferData for the VBO and one for the EBO; the VAO is set up from the attribute table in the file header (see mesh_master.h)
+	GpuMesh quadGpuMesh;
+	if (!loadMesh(QUAD_MESH_PATH, quadGpuMesh))
+	{
+		std::cout << "Failed to load the quad mesh ! .. terminating" << std::endl;
+		JobSystem::get().wait(imageDecodeJobs); // They write into this function's locals
+		glfwTerminate();
+		return -1;
+	}
+	unsigned int VAO = quadGpuMesh.vertexArray;
+
+
+
+	// Instance buffers: refilled every frame with the world matrices of the visible instances only. A mat4 attribute takes 4
+	// locations (4 to 7, one column each), all advancing once per instance (divisor). One per level of detail of the mesh,
+	// each in a VAO of its own, so every level is one instanced draw (GL 3.3 has no base instance to share one buffer)
+	unsigned int lodVAOs[MESH_MAX_LODS];
+	unsigned int instanceVBOs[MESH_MAX_LODS];
+	glGenBuffers(quadGpuMesh.lodCount, instanceVBOs);
+	for (uint32_t lod = 0; lod < quadGpuMesh.lodCount; lod++)
+	{
+		lodVAOs[lod] = lod == 0 ? VAO : createMeshVertexArray(quadGpuMesh);
+		glBindVertexArray(lodVAOs[lod]);
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBOs[lod]);
+		glBufferData(GL_ARRAY_BUFFER, (lod == 0 ? SCENE_INSTANCE_COUNT : 0) * sizeof(Mat4), NULL, GL_STREAM_DRAW);
+		for (unsigned int column = 0; column < 4; column++)
+		{
+			glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Mat4), (void*)(column * 4 * sizeof(float)));
+			glEnableVertexAttribArray(4 + column);
+			glVertexAttribDivisor(4 + column, 1);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
-	// Optional for now: Now you can unbind EBO
+	// Camera uniform buffer (view, projection, viewProjection: the "Camera" block of the shaders), written once per frame
+	const GLuint CAMERA_BLOCK_BINDING = 0;
+	unsigned int cameraUBO;
+	glGenBuffers(1, &cameraUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+	glBufferData(GL_UNIFORM_BUFFER, 3 * sizeof(Mat4), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, cameraUBO);
 
 
 
@@ -121,118 +298,759 @@ int main()
 	// Generate objects for our textures as usual:
 	unsigned int textures[2];
 	glGenTextures(2, textures);
-	
-	// Load the first texture (texture[0]):
-	glBindTexture(GL_TEXTURE_2D, textures[0]);
 
 	// Texture is a 2D image wrapped on our geometry. To know which part of texture will be visible on our geometry, we must sample textures
 	// Sampling means specifying where vertices will be on a normalized range of texture plane
+	// How a texture is sampled (wrapping & filtering) lives in a sampler object bound next to it, not in the texture itself: textures that
+	// sample the same way share one sampler (the cache makes one per distinct state), and changing the filtering is just binding another one
+	SamplerCache samplerCache;
 
 	// Set texture wrapping mode :
 	// XYZ of texture is : str
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // Arguments: OpenGL state machine target that texture will be bound to (in this case 2D bcs we want to wrap a 2d image) - texture option (in this case wrapping on the 2D axes) - wrapping mode
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	SamplerDesc textureSampling[2];
+	textureSampling[0].wrapS = GL_REPEAT; // Wrapping mode on each axis of the 2D image (s, t)
+	textureSampling[0].wrapT = GL_REPEAT;
 
 	// If we chose GL_CLAMP_TO_BORDER wrapping, we should also specify a border color
 	//float borderColor[] = { 1.0f, 1.0f, 0.0f, 1.0f };
-	//glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+	//glSamplerParameterfv(sampler, GL_TEXTURE_BORDER_COLOR, borderColor);
 
 	// Set texture filtering :
 	// Texture coordinates do not depend on resolution as texture resolution can vary if object size is the same
 	// texture may be small and object is very large or vice versa so to fix distorted resolution we use texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // Linear filtering + Mipmapping .. Put on minifying to specify the transition between mipmaps when getting far from texture
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // GL_LINEAR: produces a smoother pattern, GL_NEAREST: results in blocked patterns .. Put on magnifying to specify the filtering when stretching of texture resolution
+	textureSampling[0].minFilter = GL_LINEAR_MIPMAP_LINEAR; // Linear filtering + Mipmapping .. Put on minifying to specify the transition between mipmaps when getting far from texture
+	textureSampling[0].magFilter = GL_LINEAR; // GL_LINEAR: produces a smoother pattern, GL_NEAREST: results in blocked patterns .. Put on magnifying to specify the filtering when stretching of texture resolution
 
-	// If images loaded flipped:
-	stbi_set_flip_vertically_on_load(true);
+	// The second texture repeats too, but only ever samples its finest resident level:
+	textureSampling[1].wrapS = GL_REPEAT;
+	textureSampling[1].wrapT = GL_REPEAT;
+	textureSampling[1].minFilter = GL_LINEAR;
+	textureSampling[1].magFilter = GL_LINEAR;
+	// Anisotropy, mip bias & trilinear come from the quality tier on top of that (switching tiers swaps the samplers, see the render loop):
+	const TextureQualityTier& startupQuality = textureQualityTier(TEXTURE_QUALITY);
+	GLuint textureSamplers[2] = { samplerCache.get(applyTextureQuality(textureSampling[0], startupQuality)), samplerCache.get(applyTextureQuality(textureSampling[1], startupQuality)) };
 
-	// Load a 2D image using stb_image.h function into a string variable:
-	int width, height, colorChNum;
-	unsigned char *image0_Data = stbi_load("Textures/images/island.png", &width, &height, &colorChNum, 4);
+	// The textures themselves stay mutable (glTexImage2D per level): streaming frees and re-creates their finer levels, which immutable
+	// storage (glTexStorage2D, used for the render targets & the virtual texture, see texture_objects.h) can't do
 
-	// Check if image failed to load and pointer is NULL:
-	if (image0_Data)
+	// The decode jobs started above; help them finish (this thread runs decode jobs too instead of just blocking):
+	JobSystem::get().wait(imageDecodeJobs);
+	std::cout << "Textures: decoded in " << (glfwGetTime() - imageDecodeTime) * 1000.0 << " ms since submit on " << JobSystem::get().workerCount() + 1 << " thread(s)" << std::endl;
+	TextureStreamingSettings streamingSettings;
+	streamingSettings.budgetBytes = TEXTURE_MEMORY_BUDGET;
+	streamingSettings.finestLevel = startupQuality.finestLevel;
+	TextureStreamer textureStreamer(streamingSettings);
+
+	// Set mipmap :
+	// Mipmaps are exactly like LODs but specifically for textures. Just as a Mesh LOD reduces the triangles for a distant model, a mipmap reduces the resolution of a texture for a distant object
+	// Mipmap is basically a collection of texture images where each subsequent texture is twice as small compared to the previous one
+	// The decode job already halved the image down to 1 pixel and kept the small levels. add() puts each one in with glTexImage2D(target, mipmap level, img format, size, 0, format and type of data, pointer to the data)
+	// and sets GL_TEXTURE_BASE_LEVEL to the biggest one it has, so the missing bigger ones are never sampled. They're streamed in when the draws get big enough to need them
+	// High precision images aren't streamed: their whole chain goes up now, into a texture of their own (immutable storage can't
+	// reuse the name we generated)
+	bool highPrecision[2] = { decodedHdrImages[0].valid(), decodedHdrImages[1].valid() };
+	bool textureTranslucent[2] = { decodedImages[0].translucent || decodedHdrImages[0].translucent, decodedImages[1].translucent || decodedHdrImages[1].translucent };
+	for (int i = 0; i < 2; i++)
 	{
-		// Load the 2D image into current object and generate a texture out of it:
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image0_Data);
-		// Arguments:   Target,   mipmap,img format, size,   ??, format and type of data and a pointer to data itself of the image
-
-		// Set mipmap :
-		// Mipmaps are exactly like LODs but specifically for textures. Just as a Mesh LOD reduces the triangles for a distant model, a mipmap reduces the resolution of a texture for a distant object
-		// Mipmap is basically a collection of texture images where each subsequent texture is twice as small compared to the previous one
-		glGenerateMipmap(GL_TEXTURE_2D); // Automatically generate a mipmap with image halved until its resolution is 1 pixel. If you want to avoid that just specify how many divisions you need in glTexImage2D()
+		if (!highPrecision[i])
+			continue;
+		const HdrMips& hdr = decodedHdrImages[i];
+		glDeleteTextures(1, &textures[i]);
+		textures[i] = createHdrTexture(hdr);
+		std::cout << "Textures: " << imagePaths[i] << " is " << (hdr.precision == ImagePrecision::Hdr ? "HDR" : "16 bit") << ", " << hdr.width << "x" << hdr.height
+			<< " with " << hdr.levels.size() << " levels in " << hdrTextureFormatName(hdr.format) << ": " << hdr.bytes() / 1024 << " KB (" << hdr.bytes() / hdr.bytesPerTexel * 16 / 1024
+			<< " KB as RGBA32F)" << std::endl;
+		decodedHdrImages[i] = HdrMips();
 	}
-	else
+
+	// Check if image failed to load:
+	if (!highPrecision[0] && !textureStreamer.add(textures[0], imagePaths[0], decodedImages[0]))
 	{
 		std::cout << "Failed to load the texture" << std::endl;
 	}
 
-	// Free VRAM of texture:
-	stbi_image_free(image0_Data);
+	// Free the decoded levels, GL has its own copy:
+	decodedImages[0] = DecodedMips();
 
 	// Load the second texture (texture[1]):
-	glBindTexture(GL_TEXTURE_2D, textures[1]);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	unsigned char *image1_Data = stbi_load("Textures/images/kenway.png", &width, &height, &colorChNum, 4);
-	if (image1_Data)
-	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image1_Data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
+	if (!highPrecision[1] && !textureStreamer.add(textures[1], imagePaths[1], decodedImages[1]))
 	{
 		std::cout << "Failed to load the texture" << std::endl;
 	}
-	stbi_image_free(image1_Data);
+	decodedImages[1] = DecodedMips();
+	TextureStreamingStats reportedStreamingStats = textureStreamer.stats();
+	std::cout << "Textures: " << reportedStreamingStats.residentBytes / 1024 << " KB resident at startup (mip tails), " << reportedStreamingStats.fullChainBytes / 1024
+		<< " KB with every level, " << samplerCache.size() << " sampler object(s), " << (glExtensions().textureStorage ? "immutable" : "mutable (no ARB_texture_storage)")
+		<< " storage for fixed size textures" << std::endl;
+	std::cout << "TextureQuality: " << startupQuality.name << " (keys 1-4), anisotropic filtering ";
+	if (glExtensions().textureFilterAnisotropic)
+		std::cout << "up to " << glExtensions().maxTextureAnisotropy << "x" << std::endl;
+	else
+		std::cout << "not supported" << std::endl;
+
+	// The world map: a virtual texture (its last level is loaded now, the rest page by page as the camera gets to it)
+	VirtualTextureSettings worldMapSettings;
+	worldMapSettings.cacheSidePages = VIRTUAL_TEXTURE_CACHE_PAGES;
+	worldMapSettings.feedbackDivisor = VIRTUAL_TEXTURE_FEEDBACK_DIVISOR;
+	VirtualTexture worldMap;
+	if (worldMap.load(WORLD_MAP_PATH, worldMapSettings))
+		std::cout << "VirtualTexture: " << WORLD_MAP_PATH << " " << worldMap.imageWidth() << "x" << worldMap.imageHeight() << ", cache of " << worldMap.stats().cachePages
+			<< " pages" << std::endl;
+	else
+		std::cout << "VirtualTexture: no " << WORLD_MAP_PATH << " (make one with Tools/texture_tiler.cpp), no world map" << std::endl;
+
+	// Collect the shader batch (errors are reported here) now that the other startup work is done:
+	double shaderWaitTime = glfwGetTime();
+	shaderBatch.finish();
+	ShaderSourceCache::get().clear(); // Every program is linked, the GLSL files don't need to stay mapped
+	std::cout << "Shaders: " << shaderBatch.size() << " program(s), submit " << shaderSubmitMs << " ms, wait at finish " << (glfwGetTime() - shaderWaitTime) * 1000.0 << " ms"
+		<< (glExtensions().parallelShaderCompile ? " (parallel compile)" : "") << std::endl;
+	Shader myShader(shaderBatch.program(helloTriangleProgram));
 
 	// Compile the shader program to reach the uniforms of samplers inside it:
 	myShader.use();
 	glUniform1i(glGetUniformLocation(myShader.ID, "myTexture_0"), 0); // Get the uniform called myTexture_0 form our shader program and pass to it the texture UNIT (value of sampler uniform)
 	glUniform1i(glGetUniformLocation(myShader.ID, "myTexture_1"), 1); // Get the uniform called myTexture_0 form our shader program and pass to it the texture UNIT (value of sampler uniform)
 
+	// Uniform locations are looked up once here: command lists are recorded without a GL context so they can't ask for them
+	GLint mixIntensityLocation = glGetUniformLocation(myShader.ID, "mix_intensity");
+	glUniformBlockBinding(myShader.ID, glGetUniformBlockIndex(myShader.ID, "Camera"), CAMERA_BLOCK_BINDING);
 
+	// World map shaders: the plane is the quad mesh stretched over the scene with the image's aspect, just in front of the far plane.
+	// Textures on units 2 (page cache) and 3 (indirection), out of the way of the quads' two
+	const GLuint WORLD_MAP_CACHE_UNIT = 2, WORLD_MAP_INDIRECTION_UNIT = 3;
+	Shader worldMapShader(shaderBatch.program(worldMapProgram));
+	Shader worldMapFeedbackShader(shaderBatch.program(worldMapFeedbackProgram));
+	Mat4 worldMapModel = mat4Identity();
+	unsigned int worldMapVAO = 0;
+	if (worldMap.loaded())
+	{
+		float mapHeight = SCENE_WORLD_SIZE * (float)worldMap.imageHeight() / (float)worldMap.imageWidth();
+		worldMapModel = mat4Translation(vec3(0.0f, 0.0f, -(SCENE_DEPTH + 0.5f))) * mat4Scale(vec3(SCENE_WORLD_SIZE, mapHeight, 1.0f));
+		Shader* worldMapShaders[2] = { &worldMapShader, &worldMapFeedbackShader };
+		for (int s = 0; s < 2; s++)
+		{
+			worldMapShaders[s]->use();
+			worldMap.setupProgram(worldMapShaders[s]->ID, WORLD_MAP_CACHE_UNIT, WORLD_MAP_INDIRECTION_UNIT);
+			glUniformMatrix4fv(glGetUniformLocation(worldMapShaders[s]->ID, "model"), 1, GL_FALSE, worldMapModel.m);
+			glUniformBlockBinding(worldMapShaders[s]->ID, glGetUniformBlockIndex(worldMapShaders[s]->ID, "Camera"), CAMERA_BLOCK_BINDING);
+		}
+		worldMapVAO = createMeshVertexArray(quadGpuMesh); // Same buffers, without the instance attributes
+		glBindVertexArray(0);
+	}
+	GLsizei worldMapIndexCount = (GLsizei)quadGpuMesh.lods[0].indexCount; // Level 0 of the quad
+	const void* worldMapIndexOffset = (const void*)quadGpuMesh.lods[0].indexOffset;
 
-	// RENDER LOOP :
-	while (!glfwWindowShouldClose(window))
+	// Scene entities: every quad gets a transform (its node in the hierarchy), the mesh & material to draw it with, and a
+	// bounding sphere (read by the culling). The moving ones also get a Motion, which puts them in an archetype of their own
+	SceneStorage scene;
+	TransformHierarchy hierarchy;
+	Renderable quadMesh;
+	quadMesh.vertexArray = VAO;
+	quadMesh.indexCount = quadGpuMesh.indexCount; // Indices provided in the element buffer object (EBO that's currently bound automatically by VAO)
+	quadMesh.indexType = quadGpuMesh.indexType;
+	quadMesh.boundingRadius = quadGpuMesh.boundingRadius; // From the cooker: the sphere around the origin through the farthest vertex
+	quadMesh.lods = quadGpuMesh.lods;
+	quadMesh.lodCount = quadGpuMesh.lodCount;
+	quadMesh.meshUnitsPerTexcoord = quadGpuMesh.meshUnitsPerTexcoord;
+	Material quadMaterial;
+	quadMaterial.program = myShader.ID;
+	quadMaterial.textures[0] = textures[0];
+	quadMaterial.textures[1] = textures[1];
+	quadMaterial.samplers[0] = textureSamplers[0];
+	quadMaterial.samplers[1] = textureSamplers[1];
+	// Our shader mixes both textures, so the quads need blending as soon as one of them has a texel that isn't opaque (the
+	// decode premultiplied their alpha, see premultiplyAlpha() in texture_master.h). Opaque quads skip blending and write depth:
+	quadMaterial.translucent = textureTranslucent[0] || textureTranslucent[1];
+	std::cout << "Blending: quads are " << (quadMaterial.translucent ? "translucent (premultiplied alpha, drawn back to front after the opaque draws)"
+		: "opaque (no blending, depth written)") << std::endl;
+	std::mt19937 sceneRandom(12345);
+	std::uniform_real_distribution<float> randomUnit(0.0f, 1.0f);
+	unsigned int quadCount = 0;
+	auto addQuad = [&](uint32_t parentNode, const Vec3& position, float scale, bool moving, float amplitude)
 	{
-		// Handle user input
-		processInput(window);
+		Entity quadEntity = scene.create(COMPONENT_TRANSFORM | COMPONENT_RENDERABLE | COMPONENT_MATERIAL | COMPONENT_BOUNDS | (moving ? COMPONENT_MOTION : 0u));
+		uint32_t node = hierarchy.addNode(parentNode, position, quatIdentity(), vec3(scale, scale, scale));
+		scene.transform(quadEntity)->node = node;
+		*scene.renderable(quadEntity) = quadMesh;
+		*scene.material(quadEntity) = quadMaterial;
+		if (moving)
+		{
+			Motion* motion = scene.motion(quadEntity);
+			motion->origin[0] = position.x;
+			motion->origin[1] = position.y;
+			motion->origin[2] = position.z;
+			motion->amplitude = amplitude;
+			motion->frequency = 0.5f + randomUnit(sceneRandom) * 1.5f;
+			motion->phase = randomUnit(sceneRandom) * 6.2832f;
+			motion->spin = (randomUnit(sceneRandom) - 0.5f) * 3.0f;
+		}
+		quadCount++;
+		return node;
+	};
+	std::vector<uint32_t> levelNodes, nextLevelNodes;
+	while (quadCount < SCENE_INSTANCE_COUNT)
+	{
+		bool moving = randomUnit(sceneRandom) < SCENE_MOVING_FRACTION;
+		Vec3 rootPosition = vec3((randomUnit(sceneRandom) - 0.5f) * SCENE_WORLD_SIZE, (randomUnit(sceneRandom) - 0.5f) * SCENE_WORLD_SIZE, -randomUnit(sceneRandom) * SCENE_DEPTH);
+		levelNodes.assign(1, addQuad(TransformHierarchy::NO_PARENT, rootPosition, 0.3f + randomUnit(sceneRandom) * 0.9f, moving, 0.1f + randomUnit(sceneRandom) * 0.4f));
+		for (unsigned int depth = 1; depth < SCENE_HIERARCHY_DEPTH; depth++)
+		{
+			nextLevelNodes.clear();
+			for (size_t n = 0; n < levelNodes.size(); n++)
+			{
+				unsigned int children = (unsigned int)(randomUnit(sceneRandom) * (SCENE_MAX_CHILDREN + 1)) % (SCENE_MAX_CHILDREN + 1);
+				for (unsigned int c = 0; c < children && quadCount < SCENE_INSTANCE_COUNT; c++)
+				{
+					// Around the parent's edge, in the parent's space (it scales and turns with it), slightly in front
+					float angle = randomUnit(sceneRandom) * 6.2832f;
+					float distance = 0.9f + randomUnit(sceneRandom) * 0.3f;
+					nextLevelNodes.push_back(addQuad(levelNodes[n], vec3(std::cos(angle) * distance, std::sin(angle) * distance, 0.01f), 0.35f + randomUnit(sceneRandom) * 0.2f, moving, 0.0f));
+				}
+			}
+			levelNodes.swap(nextLevelNodes);
+		}
+	}
+
+	// Systems: Motion -> local transforms, hierarchy -> world matrices (dirty subtrees only), world matrices -> bounds.
+	// Each runs over whole arrays, split over the job system
+	auto animateScene = [&scene, &hierarchy](float time)
+	{
+		scene.parallelForEach(COMPONENT_TRANSFORM | COMPONENT_MOTION, 4096, [time, &hierarchy](Archetype& archetype, size_t begin, size_t end)
+		{
+			for (size_t row = begin; row < end; row++)
+			{
+				const Motion& motion = archetype.motions[row];
+				float angle = time * motion.frequency + motion.phase;
+				Vec3 position = vec3(motion.origin[0] + std::cos(angle) * motion.amplitude, motion.origin[1] + std::sin(angle) * motion.amplitude, motion.origin[2]);
+				hierarchy.setLocal(archetype.transforms[row].node, position, quatFromAxisAngle(vec3(0.0f, 0.0f, 1.0f), time * motion.spin + motion.phase));
+			}
+		});
+	};
+	auto updateSceneBounds = [&scene, &hierarchy](uint32_t components)
+	{
+		scene.parallelForEach(components | COMPONENT_TRANSFORM | COMPONENT_RENDERABLE | COMPONENT_BOUNDS, 4096, [&hierarchy](Archetype& archetype, size_t begin, size_t end)
+		{
+			for (size_t row = begin; row < end; row++)
+			{
+				const Mat4& world = hierarchy.world(archetype.transforms[row].node);
+				archetype.bounds.set(row, world.m[12], world.m[13], world.m[14], mat4MaxScale(world) * archetype.renderables[row].boundingRadius);
+			}
+		});
+	};
+	hierarchy.update();
+	updateSceneBounds(0); // Everything once; afterwards only what moves
+	std::cout << "Scene: " << scene.entityCount() << " entities in " << scene.archetypeCount() << " archetypes, hierarchy " << hierarchy.levelCount()
+		<< " levels deep, job system with " << JobSystem::get().workerCount() + 1 << " thread(s)" << std::endl;
+
+	// Shader of the present pass: copies (upscales) the scene texture to the window with a fullscreen triangle
+	Shader presentShader(shaderBatch.program(presentProgram));
+	presentShader.use();
+	presentShader.setInt("sourceTexture", 0);
+	presentShader.setBool("encodeOutput", !srgbBackbuffer);
+	if (UPSCALE_SHARPNESS > 0.0f)
+		presentShader.setFloat("sharpness", UPSCALE_SHARPNESS);
+	unsigned int fullscreenVAO; // Core profile needs a VAO bound to draw, even an empty one (positions come from gl_VertexID)
+	glGenVertexArrays(1, &fullscreenVAO);
+
+	// One command list per recording task; the frame is recorded in parallel and replayed in list order
+	std::vector<CommandList> frameCommandLists(1);
+	CommandList translucentCommands; // The translucent bucket of the queue, replayed after the world map
+
+	// Draws are pushed to the render queue with a sort key, sorted by state, and replayed through the state cache
+	RenderQueue renderQueue;
+	GLStateCache stateCache;
+	RenderQueueStats reportedQueueStats;
+
+	// Render graph: the scene goes to an offscreen texture, the present pass puts it on the window. Post/UI passes go in between.
+	// Resources and passes are only declared here (no GL calls), the graph creates its FBOs on the render thread at compile()
+	RenderGraph renderGraph;
+	RGTextureDesc sceneColorDesc;
+	sceneColorDesc.internalFormat = GL_SRGB8_ALPHA8; // 8 bits per channel spent where the eye sees steps; written & read as linear
+	sceneColorDesc.filter = GL_LINEAR; // Bilinear when the present pass stretches it over the window
+	RGResource sceneColor = renderGraph.createTexture("sceneColor", sceneColorDesc);
+	RGTextureDesc sceneDepthDesc; // Instances overlap at different depths
+	sceneDepthDesc.internalFormat = GL_DEPTH_COMPONENT24;
+	sceneDepthDesc.filter = GL_NEAREST;
+	RGResource sceneDepth = renderGraph.createTexture("sceneDepth", sceneDepthDesc);
+	RGResource backbuffer = renderGraph.importBackbuffer("backbuffer");
+	Mat4 worldMapClip = mat4Identity(); // viewProjection * worldMapModel of the frame: when it changes the world map needs a new feedback
+	renderGraph.addPass("scene", {}, { sceneColor, sceneDepth }, [&](const RGPassContext& pass)
+	{
+		// World map feedback: which of its pages this view samples, drawn into the virtual texture's own small target (it has
+		// to run even though nothing in the graph reads it). Only when the view moved
+		if (worldMap.loaded() && worldMap.beginFeedback(stateCache, worldMapClip.m, pass.width, pass.height))
+		{
+			stateCache.useProgram(worldMapFeedbackShader.ID);
+			stateCache.bindVertexArray(worldMapVAO);
+			glDrawElements(GL_TRIANGLES, worldMapIndexCount, quadGpuMesh.indexType, worldMapIndexOffset);
+			worldMap.endFeedback();
+		}
+
+		// Execute the recorded lists on this (GL) thread, in order, dropping binds of what is already bound:
+		glEnable(GL_DEPTH_TEST);
+		for (size_t i = 0; i < frameCommandLists.size(); i++)
+			replayCommandList(frameCommandLists[i], &stateCache); // Opaque draws: no blending, depth written
+
+		// The world map after the opaque draws: behind everything, so the depth test skips the pixels the opaque quads already cover
+		if (worldMap.loaded())
+		{
+			stateCache.useProgram(worldMapShader.ID);
+			worldMap.bind(stateCache, WORLD_MAP_CACHE_UNIT, WORLD_MAP_INDIRECTION_UNIT);
+			stateCache.bindVertexArray(worldMapVAO);
+			glDrawElements(GL_TRIANGLES, worldMapIndexCount, quadGpuMesh.indexType, worldMapIndexOffset);
+		}
+
+		// Translucent draws over everything opaque (world map included), depth tested but not written. Then depth writes go
+		// back on: the next frame's clear needs them
+		replayCommandList(translucentCommands, &stateCache);
+		stateCache.setBlendMode(BlendMode::Opaque);
+		glDisable(GL_DEPTH_TEST);
+	});
+	renderGraph.addPass("present", { sceneColor }, { backbuffer }, [&](const RGPassContext& pass)
+	{
+		stateCache.useProgram(presentShader.ID);
+		stateCache.bindTexture(0, GL_TEXTURE_2D, pass.texture(sceneColor));
+		stateCache.bindSampler(0, 0); // The render target's own filtering, not the quads' sampler left on this unit
+		stateCache.bindVertexArray(fullscreenVAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	});
+
+
+
+	// Draw (or just re-present) one frame from a snapshot. Runs on the render thread when USE_RENDER_THREAD is set,
+	// so it only touches GL state and the snapshot, never the simulation
+	FrameLimiter frameLimiter(FRAME_LIMIT_MODE, TARGET_FPS);
+	int viewportWidth = 0, viewportHeight = 0;
+
+	// Frame time -> scene scale. GPU time comes from timer queries a few frames old, CPU time is the render side's own work
+	DynamicResolutionSettings resolutionSettings;
+	resolutionSettings.targetMs = FRAME_BUDGET_MS;
+	resolutionSettings.minScale = DYNAMIC_RESOLUTION_MIN_SCALE;
+	resolutionSettings.maxScale = DYNAMIC_RESOLUTION_MAX_SCALE;
+	DynamicResolution dynamicResolution(resolutionSettings);
+	GpuFrameTimer gpuFrameTimer;
+
+	// Culling state, render thread only (reused every frame so culling doesn't allocate)
+	std::vector<uint32_t> frustumVisible;
+	struct VisibleRange { Archetype* archetype; size_t begin, end; }; // Rows of one archetype in frustumVisible
+	std::vector<VisibleRange> visibleRanges;
+	double sceneUpdateMs = 0.0;
+	size_t hierarchyRecomputed = 0;
+	std::vector<float> visibleInstances[MESH_MAX_LODS]; // World matrices, per level of detail
+	std::vector<std::pair<float, uint32_t>> instanceDepths; // Translucent instances: (view z, instance), to sort them back to front
+	std::vector<float> sortedInstances;
+	size_t trianglesDrawn = 0, trianglesFullDetail = 0; // Summed over the report period
+	OcclusionBuffer occlusionBuffer;
+	CullingStats cullingStats;
+	double cullingReportTime = 0.0;
+	unsigned int cullingReportFrames = 0;
+	TextureQuality appliedTextureQuality = TEXTURE_QUALITY;
+	auto presentFrame = [&](const FrameSnapshot& frame)
+	{
+		// Only the window contents were damaged: sceneColor still holds the last frame (nothing aliases it after the present
+		// pass), so run just the present pass. If the size changed in between, fall through and draw a whole frame
+		if (frame.representOnly && frame.framebufferWidth == viewportWidth && frame.framebufferHeight == viewportHeight
+			&& renderGraph.executePass("present"))
+		{
+			glfwSwapBuffers(window);
+			return;
+		}
+
+		double frameStartTime = glfwGetTime();
+
+		// The resize callback runs on the main thread which has no context, so the render targets follow the snapshot here
+		// (the graph sets the viewport of every pass from its target size). A new scene scale recreates them too
+		bool scaleChanged = sceneColorDesc.scale != dynamicResolution.scale();
+		if (frame.framebufferWidth != viewportWidth || frame.framebufferHeight != viewportHeight || scaleChanged)
+		{
+			viewportWidth = frame.framebufferWidth;
+			viewportHeight = frame.framebufferHeight;
+			sceneColorDesc.scale = dynamicResolution.scale();
+			sceneDepthDesc.scale = sceneColorDesc.scale; // Attachments of one pass share a size
+			renderGraph.setTextureDesc(sceneColor, sceneColorDesc);
+			renderGraph.setTextureDesc(sceneDepth, sceneDepthDesc);
+			renderGraph.compile(viewportWidth, viewportHeight);
+			if (scaleChanged)
+				std::cout << "DynamicResolution: scene at " << (int)(sceneColorDesc.scale * 100.0f + 0.5f) << "% of " << viewportWidth << "x" << viewportHeight
+					<< " (budget " << FRAME_BUDGET_MS << " ms)" << std::endl;
+			else
+				renderGraph.printSummary();
+			stateCache.invalidate(); // Render targets were recreated, texture names may have been reused
+		}
+
+		// Texture quality tier switched: every material gets the tier's samplers (made once, then shared by the cache) and the
+		// streaming's finest level follows. Nothing is reloaded, levels past the new cap are dropped or streamed in as usual
+		if (frame.state.textureQuality != appliedTextureQuality)
+		{
+			appliedTextureQuality = frame.state.textureQuality;
+			const TextureQualityTier& tier = textureQualityTier(appliedTextureQuality);
+			for (int i = 0; i < 2; i++)
+				textureSamplers[i] = samplerCache.get(applyTextureQuality(textureSampling[i], tier));
+			scene.forEach(COMPONENT_MATERIAL, [&](Archetype& archetype, size_t begin, size_t end)
+			{
+				for (size_t row = begin; row < end; row++)
+				{
+					archetype.materials[row].samplers[0] = textureSamplers[0];
+					archetype.materials[row].samplers[1] = textureSamplers[1];
+				}
+			});
+			textureStreamer.setFinestLevel(tier.finestLevel);
+			std::cout << "TextureQuality: " << tier.name << " (anisotropy " << std::min(tier.maxAnisotropy, glExtensions().maxTextureAnisotropy) << "x, mip bias "
+				<< tier.lodBias << ", " << (tier.trilinear ? "trilinear" : "bilinear") << ", finest streamed level " << tier.finestLevel << ")" << std::endl;
+		}
 
 		//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> Rendering Commands <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // Choose a color to replace color buffer contents with it
-		glClear(GL_COLOR_BUFFER_BIT); // Clear only color buffer and replace it with the registered color
+		// Camera of this frame, for the culling and (through the uniform buffer) for every shader:
+		Mat4 camera[3]; // view, projection, viewProjection (the layout of the Camera block)
+		makeCamera(frame.state, (float)viewportWidth / (float)(viewportHeight > 0 ? viewportHeight : 1), camera[0], camera[1]);
+		camera[2] = camera[1] * camera[0];
+		const Mat4& viewProjection = camera[2];
+		glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(camera), camera);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-		// Activate and Bind textures:
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, textures[0]);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, textures[1]);
+		// Move the animated entities to where they are at this frame's (interpolated) time:
+		if (ANIMATE_SCENE)
+		{
+			double updateStart = glfwGetTime();
+			animateScene(frame.state.time);
+			hierarchyRecomputed += hierarchy.update();
+			updateSceneBounds(COMPONENT_MOTION);
+			sceneUpdateMs += (glfwGetTime() - updateStart) * 1000.0;
+		}
 
-		glUniform1f(glGetUniformLocation(myShader.ID, "mix_intensity"), MIX_INTENSITY);
+		// Culling: frustum first (SIMD over the bounds of each archetype), then the survivors against the occlusion buffer
+		const uint32_t drawnComponents = COMPONENT_TRANSFORM | COMPONENT_RENDERABLE | COMPONENT_MATERIAL | COMPONENT_BOUNDS;
+		double cullingStart = glfwGetTime();
+		Frustum frustum = Frustum::fromMatrix(viewProjection.m);
+		frustumVisible.clear();
+		visibleRanges.clear();
+		cullingStats.total = 0;
+		scene.forEach(drawnComponents, [&](Archetype& archetype, size_t, size_t)
+		{
+			VisibleRange range = { &archetype, frustumVisible.size(), 0 };
+			frustumCull(archetype.bounds, frustum, frustumVisible);
+			range.end = frustumVisible.size();
+			visibleRanges.push_back(range);
+			cullingStats.total += (unsigned int)archetype.size();
+		});
+		double occlusionStart = glfwGetTime();
+		cullingStats.frustumCulled = cullingStats.total - (unsigned int)frustumVisible.size();
+		cullingStats.occlusionCulled = 0;
+		for (uint32_t lod = 0; lod < MESH_MAX_LODS; lod++)
+			visibleInstances[lod].clear();
+		if (OCCLUSION_CULLING)
+		{
+			occlusionBuffer.clear();
+			unsigned int occluders = 0;
+			for (size_t r = 0; r < visibleRanges.size(); r++)
+			{
+				const Archetype& archetype = *visibleRanges[r].archetype;
+				for (size_t i = visibleRanges[r].begin; i < visibleRanges[r].end && occluders < OCCLUDER_BUDGET; i++)
+				{
+					uint32_t row = frustumVisible[i];
+					if (archetype.bounds.radius()[row] < OCCLUDER_MIN_SCALE * archetype.renderables[row].boundingRadius)
+						continue;
+					if (archetype.materials[row].translucent)
+						continue; // Blended: what is behind it shows through, so it hides nothing. Only the opaque bucket occludes
+					// The quad's corners in its own space, straight to the screen
+					Mat4 toClip = viewProjection * hierarchy.world(archetype.transforms[row].node);
+					float corners[4][3];
+					bool inFront = true;
+					for (int c = 0; c < 4 && inFront; c++)
+						inFront = OcclusionBuffer::transformToScreen(toClip.m, (c == 1 || c == 2) ? 0.5f : -0.5f, (c >= 2) ? 0.5f : -0.5f, 0.0f, corners[c]);
+					if (!inFront)
+						continue;
+					occlusionBuffer.rasterizeTriangle(corners[0], corners[1], corners[2]);
+					occlusionBuffer.rasterizeTriangle(corners[0], corners[2], corners[3]);
+					occluders++;
+				}
+			}
+			occlusionBuffer.buildHiZ();
+		}
+		const Archetype* firstVisible = NULL; // Its mesh & material are used for the draw
+		float scenePixelHeight = (float)viewportHeight * sceneColorDesc.scale;
+		float maxPixelsPerTexcoord = 0.0f; // Biggest on screen texture repeat of the frame, what the texture streaming has to serve
+		for (size_t r = 0; r < visibleRanges.size(); r++)
+		{
+			Archetype& archetype = *visibleRanges[r].archetype;
+			for (size_t i = visibleRanges[r].begin; i < visibleRanges[r].end; i++)
+			{
+				uint32_t row = frustumVisible[i];
+				float rect[4], nearestDepth;
+				if (OCCLUSION_CULLING && projectSphere(viewProjection.m, archetype.bounds.x()[row], archetype.bounds.y()[row], archetype.bounds.z()[row],
+					archetype.bounds.radius()[row], rect, nearestDepth) && occlusionBuffer.isOccluded(rect, nearestDepth))
+				{
+					cullingStats.occlusionCulled++;
+					continue;
+				}
+				// Level of detail from the projected size: the bounds radius over the mesh's is the instance's scale
+				Renderable& renderable = archetype.renderables[row];
+				float meshScale = renderable.boundingRadius > 0.0f ? archetype.bounds.radius()[row] / renderable.boundingRadius : 1.0f;
+				float pixelsPerMeshUnit = meshScale * pixelsPerWorldUnit(camera[1], viewProjection, archetype.bounds.x()[row], archetype.bounds.y()[row],
+					archetype.bounds.z()[row], scenePixelHeight);
+				maxPixelsPerTexcoord = std::max(maxPixelsPerTexcoord, pixelsPerMeshUnit * renderable.meshUnitsPerTexcoord);
+				if (renderable.lods)
+				{
+					renderable.lod = selectLod(renderable.lods, renderable.lodCount, pixelsPerMeshUnit, renderable.lod, LOD_PIXEL_ERROR, LOD_HYSTERESIS);
+					trianglesDrawn += renderable.lods[renderable.lod].indexCount / 3;
+					trianglesFullDetail += renderable.lods[0].indexCount / 3;
+				}
+				const Mat4& world = hierarchy.world(archetype.transforms[row].node);
+				visibleInstances[renderable.lod].insert(visibleInstances[renderable.lod].end(), world.m, world.m + 16);
+				if (!firstVisible)
+					firstVisible = &archetype;
+			}
+		}
+		cullingStats.visible = 0;
+		for (uint32_t lod = 0; lod < quadGpuMesh.lodCount; lod++)
+			cullingStats.visible += (unsigned int)(visibleInstances[lod].size() / 16);
+		cullingStats.frustumMs += (occlusionStart - cullingStart) * 1000.0;
+		cullingStats.occlusionMs += (glfwGetTime() - occlusionStart) * 1000.0;
+		cullingReportFrames++;
 
-		// Use currently bound shader program
-		myShader.use();
+		// Translucent instances blend over each other in the order they are drawn, so back to front: farthest view z first
+		// (instances of different levels of detail are different draws, each is sorted on its own)
+		if (firstVisible && firstVisible->materials[0].translucent)
+		{
+			const Mat4& view = camera[0];
+			for (uint32_t lod = 0; lod < quadGpuMesh.lodCount; lod++)
+			{
+				std::vector<float>& instances = visibleInstances[lod];
+				instanceDepths.clear();
+				for (uint32_t i = 0; i < (uint32_t)(instances.size() / 16); i++)
+				{
+					const float* position = &instances[i * 16 + 12];
+					instanceDepths.push_back(std::make_pair(view.m[2] * position[0] + view.m[6] * position[1] + view.m[10] * position[2] + view.m[14], i));
+				}
+				std::sort(instanceDepths.begin(), instanceDepths.end());
+				sortedInstances.resize(instances.size());
+				for (size_t i = 0; i < instanceDepths.size(); i++)
+					std::copy(&instances[instanceDepths[i].second * 16], &instances[instanceDepths[i].second * 16] + 16, &sortedInstances[i * 16]);
+				instances.swap(sortedInstances);
+			}
+		}
 
-		// Bind the VAO of our GLTriangles vertex data so it knows automatically which VBO to process for its specific attribute config
-		glBindVertexArray(VAO);
+		// Only the visible instances go to the GPU:
+		for (uint32_t lod = 0; lod < quadGpuMesh.lodCount; lod++)
+		{
+			if (visibleInstances[lod].empty())
+				continue;
+			glBindBuffer(GL_ARRAY_BUFFER, instanceVBOs[lod]);
+			glBufferData(GL_ARRAY_BUFFER, visibleInstances[lod].size() * sizeof(float), visibleInstances[lod].data(), GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-		//glDrawArrays(GL_TRIANGLES, 0, 3); //Draw primitives using the previously defined vertex attribute configuration and with the VBO's vertex data (indirectly bound via the VAO)
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0); //Draw primitives using indices provided in the element buffer object (EBO that's currently bound automatically by VAO)
+		// Mip levels for what's on screen: finished decodes are uploaded now (this frame already samples them), missing ones are started
+		if (firstVisible)
+		{
+			textureStreamer.request(firstVisible->materials[0].textures[0], maxPixelsPerTexcoord);
+			textureStreamer.request(firstVisible->materials[0].textures[1], maxPixelsPerTexcoord);
+		}
+		textureStreamer.update(stateCache);
+
+		// World map pages: reads back the last feedback, uploads the pages that finished loading and starts loading the missing ones
+		worldMapClip = viewProjection * worldMapModel;
+		worldMap.update(stateCache);
+
+		// Queue the draws of the frame. All our entities share one mesh & material (the quad: shader program, 2 textures and the
+		// VAO of our GLTriangles vertex data), so it's one instanced draw of every visible instance per level of detail
+		renderQueue.clear();
+		if (firstVisible)
+		{
+			const Renderable& mesh = firstVisible->renderables[0];
+			const Material& material = firstVisible->materials[0];
+			for (uint32_t lod = 0; lod < quadGpuMesh.lodCount; lod++)
+			{
+				if (visibleInstances[lod].empty())
+					continue;
+				DrawItem quad;
+				quad.program = material.program;
+				quad.textures[0] = material.textures[0];
+				quad.textures[1] = material.textures[1];
+				quad.samplers[0] = material.samplers[0];
+				quad.samplers[1] = material.samplers[1];
+				quad.translucent = material.translucent;
+				quad.vertexArray = lodVAOs[lod];
+				quad.indexCount = mesh.lods ? mesh.lods[lod].indexCount : mesh.indexCount;
+				quad.indexOffset = mesh.lods ? mesh.lods[lod].indexOffset : 0;
+				quad.indexType = mesh.indexType;
+				quad.floatUniformLocation = mixIntensityLocation;
+				quad.floatUniformValue = frame.state.mixIntensity;
+				quad.instanceCount = (GLsizei)(visibleInstances[lod].size() / 16);
+				renderQueue.push(quad);
+			}
+		}
+		renderQueue.sort(); // Group draws by state so the binds between them mostly vanish
+
+		// Record the frame (no GL calls in here, this may run on worker threads):
+		recordParallel(frameCommandLists, [&](CommandList& commands, size_t part)
+		{
+			(void)part; // Just one part for now, the scene traversal will split its objects over the lists
+			commands.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, 0.0f, 0.0f, 0.0f, 1.0f); // Clear color (to black) and depth
+			renderQueue.record(commands, RenderBucket::Opaque);
+		});
+		translucentCommands.reset();
+		renderQueue.record(translucentCommands, RenderBucket::Translucent); // Replayed after the world map, see the scene pass
+
+		// Run the passes: scene (replays the recorded lists into sceneColor), then present to the window
+		stateCache.resetCounters();
+		if (DYNAMIC_RESOLUTION)
+			gpuFrameTimer.begin();
+		renderGraph.execute();
+		if (DYNAMIC_RESOLUTION)
+		{
+			gpuFrameTimer.end();
+			// A new scale is applied at the start of the next frame; ask for that frame in case we render on demand
+			if (dynamicResolution.update(gpuFrameTimer.latestMs(), (glfwGetTime() - frameStartTime) * 1000.0))
+				RedrawTracker::get().requestRender();
+		}
+
+		// Tell how much sorting saved whenever the numbers change:
+		const RenderQueueStats& queueStats = renderQueue.lastStats();
+		if (queueStats.draws != reportedQueueStats.draws || queueStats.saved() != reportedQueueStats.saved())
+		{
+			std::cout << "RenderQueue: " << queueStats.draws << " draw(s), state switches " << queueStats.switchesUnsorted << " unsorted -> " << queueStats.switchesSorted
+				<< " sorted (saved " << queueStats.saved() << "), issued this frame " << stateCache.frameCounters().total() << std::endl;
+			reportedQueueStats = queueStats;
+		}
+		const TextureStreamingStats& streamingStats = textureStreamer.stats();
+		if (streamingStats.residentBytes != reportedStreamingStats.residentBytes)
+		{
+			std::cout << "TextureStreaming: " << streamingStats.residentBytes / 1024 << " KB resident of " << streamingStats.fullChainBytes / 1024 << " KB (levels streamed in "
+				<< streamingStats.levelsStreamed << ", dropped " << streamingStats.levelsDropped << ", base level " << textureStreamer.residentLevel(textures[0]) << " / "
+				<< textureStreamer.residentLevel(textures[1]) << ")" << std::endl;
+			reportedStreamingStats = streamingStats;
+		}
+
+		// Culling numbers, averaged over about a second:
+		if (frameStartTime - cullingReportTime >= 1.0)
+		{
+			std::cout << "Culling: " << cullingStats.total << " objects, frustum culled " << cullingStats.frustumCulled << ", occlusion culled " << cullingStats.occlusionCulled
+				<< ", drawn " << cullingStats.visible << " | frustum " << cullingStats.frustumMs / cullingReportFrames << " ms, occlusion "
+				<< cullingStats.occlusionMs / cullingReportFrames << " ms per frame" << std::endl;
+			if (quadGpuMesh.lodCount > 1)
+				std::cout << "LOD: " << trianglesDrawn / cullingReportFrames << " triangles drawn per frame, " << trianglesFullDetail / cullingReportFrames
+					<< " at full detail" << std::endl;
+			trianglesDrawn = trianglesFullDetail = 0;
+			const VirtualTextureStats& worldMapStats = worldMap.stats();
+			if (worldMap.loaded())
+				std::cout << "VirtualTexture: " << worldMapStats.residentPages << " / " << worldMapStats.cachePages << " cache pages used, " << worldMapStats.requestedPages
+					<< " requested, " << worldMapStats.pendingLoads << " loading | " << worldMapStats.pagesLoaded << " loaded, " << worldMapStats.pagesEvicted << " evicted since start"
+					<< std::endl;
+			if (ANIMATE_SCENE)
+				std::cout << "Scene: " << scene.entityCount() << " entities, " << hierarchyRecomputed / cullingReportFrames << " world matrices recomputed, transform + bounds update "
+					<< sceneUpdateMs / cullingReportFrames << " ms per frame" << std::endl;
+			cullingStats.frustumMs = cullingStats.occlusionMs = sceneUpdateMs = 0.0;
+			hierarchyRecomputed = 0;
+			cullingReportFrames = 0;
+			cullingReportTime = frameStartTime;
+		}
 
 		//---------------------------------------------------------------------------------------------------------------------------------------------
 
 		glfwSwapBuffers(window); //Swap the Double buffer to the back one when we end drawing the frame
+		frameLimiter.endFrame(); //Wait out the rest of the frame if we render faster than the target
+	};
+
+	// Hand the context over to the render thread, or keep rendering inline on this one:
+	RenderThread<FrameSnapshot> renderThread;
+	if (USE_RENDER_THREAD)
+	{
+		glfwMakeContextCurrent(NULL); // A context can only be current on one thread at a time
+		renderThread.start(window, [&]() { frameLimiter.apply(); }, presentFrame);
+	}
+	else
+	{
+		frameLimiter.apply();
+	}
+	auto submitFrame = [&](const FrameSnapshot& frame)
+	{
+		if (USE_RENDER_THREAD)
+			renderThread.submit(frame); // Waits only if the render thread is already two frames behind
+		else
+			presentFrame(frame);
+	};
+
+
+
+	// RENDER LOOP :
+	SimulationState previousState = { MIX_INTENSITY, 0.0f, 0.0f, 0.0f, TEXTURE_QUALITY };
+	SimulationState currentState = previousState;
+	glfwSetWindowUserPointer(window, &currentState); // For key_callback (it runs on this thread, inside glfwPollEvents/glfwWaitEvents)
+	FixedTimestep timestep(SIMULATION_STEP);
+	timestep.reset(glfwGetTime());
+
+	while (!glfwWindowShouldClose(window))
+	{
+		// Minimized or hidden: nothing to show, so sleep until an event arrives instead of spinning, and don't let the
+		// simulation catch up on the time we spent hidden
+		if (glfwGetWindowAttrib(window, GLFW_ICONIFIED) || !glfwGetWindowAttrib(window, GLFW_VISIBLE))
+		{
+			glfwWaitEvents();
+			timestep.reset(glfwGetTime());
+			continue;
+		}
+
+		int framebufferWidth, framebufferHeight;
+		glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+
+		// Idle: no input held, the simulation settled and nobody asked for a redraw -> block until an event arrives
+		// instead of drawing the same frame again. If the window was only damaged, re-present the last frame
+		if (RENDER_ON_DEMAND && !ANIMATE_SCENE && !RedrawTracker::get().isRenderPending() && !isInputActive(window) && previousState.mixIntensity == currentState.mixIntensity
+			&& previousState.cameraX == currentState.cameraX && previousState.cameraY == currentState.cameraY)
+		{
+			if (RedrawTracker::get().consumePresent())
+			{
+				FrameSnapshot represent = { currentState, framebufferWidth, framebufferHeight, true };
+				submitFrame(represent);
+			}
+			glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT);
+			timestep.reset(glfwGetTime());
+			continue;
+		}
+
+		// Handle user input & advance the simulation in fixed steps
+		timestep.beginFrame(glfwGetTime());
+		while (timestep.step())
+		{
+			previousState = currentState;
+			processInput(window, currentState, timestep.dt());
+			if (ANIMATE_SCENE)
+				currentState.time += (float)timestep.dt();
+		}
+		RedrawTracker::get().consumeRender();
+
+		// Snapshot what this frame shows and hand it over; we go on with the next frame's simulation right away
+		FrameSnapshot frame = { interpolateState(previousState, currentState, timestep.alpha()), framebufferWidth, framebufferHeight, false };
+		submitFrame(frame);
+
 		glfwPollEvents(); //Wait for any events from user (handled after that by callback functions)
 	}
 
+	// Let the render thread finish its queued frames and take the context back for cleanup:
+	if (USE_RENDER_THREAD)
+	{
+		renderThread.stop();
+		glfwMakeContextCurrent(window);
+	}
+
 	// Deallocate VRAM at the end:
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	renderGraph.release();
+	gpuFrameTimer.release();
+	glDeleteVertexArrays(1, &fullscreenVAO);
+	for (uint32_t lod = 1; lod < quadGpuMesh.lodCount; lod++)
+		glDeleteVertexArrays(1, &lodVAOs[lod]);
+	glDeleteBuffers(quadGpuMesh.lodCount, instanceVBOs);
+	releaseMesh(quadGpuMesh);
+	glDeleteTextures(2, textures);
+	samplerCache.release();
+	worldMap.release();
+	if (worldMapVAO)
+		glDeleteVertexArrays(1, &worldMapVAO);
+	glDeleteBuffers(1, &cameraUBO);
 
 	glfwTerminate();
 	return 0;
@@ -240,26 +1058,81 @@ int main()
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) //Callback definition to resize the render viewport whenever user resizes GLFW window
 {
-	glViewport(0, 0, width, height);
+	// No glViewport here: this runs on the main thread, which may not own the context. Every frame snapshot carries the
+	// framebuffer size and the render side applies it
+	RedrawTracker::get().requestRender(); // New size, the old frame doesn't fit anymore
+}
+
+void window_refresh_callback(GLFWwindow* window) //Callback definition for damaged window contents: nothing changed, just show the last frame again
+{
+	RedrawTracker::get().requestPresent();
 }
 
-void processInput(GLFWwindow* window) //Callback definition to handle user input in a specific window
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) //Callback definition for key presses & releases, the only input that reaches us while the loop idles
 {
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if (action == GLFW_REPEAT)
+		return;
+	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true); //If we pressed ESCAPE window should close
 
+	// Texture quality tier: switched on the press itself, so a tap shorter than one idle wait isn't lost
+	SimulationState* state = (SimulationState*)glfwGetWindowUserPointer(window);
+	if (state && action == GLFW_PRESS && key >= GLFW_KEY_1 && key < GLFW_KEY_1 + TEXTURE_QUALITY_COUNT)
+		state->textureQuality = (TextureQuality)(key - GLFW_KEY_1);
+
+	RedrawTracker::get().requestRender(); // Run the loop at least once: held keys then keep it going through isInputActive()
+}
+
+void processInput(GLFWwindow* window, SimulationState& state, float dt) //Handle held keys in a specific window, once per fixed simulation step
+{
+	// Change per second * step length: holding a key has the same effect at any frame rate
 	if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
 	{
-		if (MIX_INTENSITY <= 1.0f)
-		{
-			MIX_INTENSITY += 0.1f;
-		}
+		state.mixIntensity += MIX_CHANGE_PER_SECOND * dt;
+		if (state.mixIntensity > 1.0f)
+			state.mixIntensity = 1.0f;
 	}
 	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
 	{
-		if (MIX_INTENSITY >= 0.1f)
-		{
-			MIX_INTENSITY -= 0.1f;
-		}
+		state.mixIntensity -= MIX_CHANGE_PER_SECOND * dt;
+		if (state.mixIntensity < 0.0f)
+			state.mixIntensity = 0.0f;
 	}
+
+	// Camera pan:
+	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+		state.cameraX -= CAMERA_SPEED * dt;
+	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+		state.cameraX += CAMERA_SPEED * dt;
+	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+		state.cameraY -= CAMERA_SPEED * dt;
+	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+		state.cameraY += CAMERA_SPEED * dt;
+}
+
+bool isInputActive(GLFWwindow* window) //True while a key that drives the simulation is held, so render-on-demand keeps the loop running
+{
+	return glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS
+		|| glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS
+		|| glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+}
+
+SimulationState interpolateState(const SimulationState& previous, const SimulationState& current, float alpha) //Blend the last two simulation states for a render frame
+{
+	SimulationState blended;
+	blended.mixIntensity = previous.mixIntensity + (current.mixIntensity - previous.mixIntensity) * alpha;
+	blended.cameraX = previous.cameraX + (current.cameraX - previous.cameraX) * alpha;
+	blended.cameraY = previous.cameraY + (current.cameraY - previous.cameraY) * alpha;
+	blended.time = previous.time + (current.time - previous.time) * alpha;
+	blended.textureQuality = current.textureQuality; // A switch, nothing to blend
+	return blended;
+}
+
+void makeCamera(const SimulationState& state, float aspect, Mat4& view, Mat4& projection) //Orthographic camera centered on the camera position
+{
+	// Visible box: VIEW_HEIGHT tall, as wide as the window aspect, z from +1 (near) down to -SCENE_DEPTH - 1 (far)
+	float halfHeight = VIEW_HEIGHT * 0.5f;
+	float halfWidth = halfHeight * aspect;
+	view = mat4Translation(vec3(-state.cameraX, -state.cameraY, 0.0f));
+	projection = mat4Ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, -1.0f, SCENE_DEPTH + 1.0f); // Distances along -z, like glOrtho
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 330 core
+
+out vec4 FragmentColor;
+
+in vec2 calculatedTexCoord;
+
+uniform sampler2D sourceTexture; // sRGB: sampled (and filtered) as linear
+uniform bool encodeOutput;       // The window framebuffer can't encode sRGB (GL_FRAMEBUFFER_SRGB does it otherwise)
+
+vec3 linearToSrgb(vec3 color)
+{
+	return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, step(vec3(0.0031308), color));
+}
+
+void main()
+{
+	FragmentColor = texture(sourceTexture, calculatedTexCoord);
+	if (encodeOutput)
+		FragmentColor.rgb = linearToSrgb(FragmentColor.rgb);
+}
\ No newline at end of file
@@ -6,6 +6,8 @@ in vec3 calculatedColor;
 in vec2 calculatedTex0Coord;
 in vec2 calculatedTex1Coord;
 
+// Both textures are GL_SRGB8_ALPHA8: the sampler hands us linear colors, so the mix below blends light, not gamma-encoded
+// values, and GL_FRAMEBUFFER_SRGB encodes the result when it is written. No conversion in here
 uniform sampler2D myTexture_0;
 uniform sampler2D myTexture_1;
 
@@ -0,0 +1,35 @@
+#version 330 core
+
+// Upscale with a bilinear fetch, then sharpen a little to win back some of the detail lost to the lower resolution.
+// Unsharp mask over the 4 neighbours (one source texel away), clamped to their min/max so edges don't ring
+
+out vec4 FragmentColor;
+
+in vec2 calculatedTexCoord;
+
+uniform sampler2D sourceTexture; // sRGB: sampled (and filtered) as linear
+uniform bool encodeOutput;       // The window framebuffer can't encode sRGB (GL_FRAMEBUFFER_SRGB does it otherwise)
+uniform float sharpness;         // 0 = plain bilinear
+
+vec3 linearToSrgb(vec3 color)
+{
+	return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, step(vec3(0.0031308), color));
+}
+
+void main()
+{
+	vec2 texel = 1.0 / vec2(textureSize(sourceTexture, 0));
+	vec3 center = texture(sourceTexture, calculatedTexCoord).rgb;
+	vec3 left = texture(sourceTexture, calculatedTexCoord - vec2(texel.x, 0.0)).rgb;
+	vec3 right = texture(sourceTexture, calculatedTexCoord + vec2(texel.x, 0.0)).rgb;
+	vec3 up = texture(sourceTexture, calculatedTexCoord + vec2(0.0, texel.y)).rgb;
+	vec3 down = texture(sourceTexture, calculatedTexCoord - vec2(0.0, texel.y)).rgb;
+
+	vec3 blurred = (left + right + up + down) * 0.25;
+	vec3 sharpened = center + (center - blurred) * sharpness;
+	vec3 low = min(center, min(min(left, right), min(up, down)));
+	vec3 high = max(center, max(max(left, right), max(up, down)));
+
+	vec3 color = clamp(sharpened, low, high);
+	FragmentColor = vec4(encodeOutput ? linearToSrgb(color) : color, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+
+// Feedback pass of a virtual texture (see virtual_texture.h): writes the page and level each pixel samples, packed in RGBA8.
+// Drawn at 1 / divisor of the screen size, so the level is corrected by vtFeedbackBias = log2(divisor)
+
+out vec4 FragmentColor;
+
+in vec2 calculatedTex0Coord;
+
+uniform int vtPagesPerSide;
+uniform int vtMaxLevel;
+uniform vec2 vtImageScale;
+uniform float vtFeedbackBias;
+
+const float PAGE_SIZE = 128.0;
+
+void main()
+{
+	vec2 virtualCoord = clamp(calculatedTex0Coord, 0.0, 1.0) * vtImageScale;
+	vec2 texel = virtualCoord * float(vtPagesPerSide) * PAGE_SIZE;
+	vec2 dx = dFdx(texel), dy = dFdy(texel);
+	float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) - vtFeedbackBias;
+	int level = clamp(int(floor(lod)), 0, vtMaxLevel);
+
+	int levelPages = vtPagesPerSide >> level;
+	ivec2 page = clamp(ivec2(virtualCoord * float(levelPages)), ivec2(0), ivec2(levelPages - 1));
+
+	// r, g: low 8 bits of x, y; b: their next 4 bits; a: level + 1 (0 = nothing virtual textured here)
+	FragmentColor = vec4(float(page.x & 255), float(page.y & 255), float(((page.x >> 8) & 15) | (((page.y >> 8) & 15) << 4)), float(level + 1)) / 255.0;
+}
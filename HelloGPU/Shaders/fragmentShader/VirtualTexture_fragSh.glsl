@@ -0,0 +1,40 @@
+#version 330 core
+
+// Samples a virtual texture (see virtual_texture.h): the indirection texture says which slot of the page cache holds the
+// page under this pixel (or the closest coarser page that is loaded), then the texel is read from that slot
+
+out vec4 FragmentColor;
+
+in vec2 calculatedTex0Coord;
+
+uniform sampler2D vtCache;       // Page cache: slots of 136x136 texels (128 + a 4 texel border on each side)
+uniform sampler2D vtIndirection; // One texel per page and level: (slot x, slot y, level of the page in the slot) / 255
+uniform int vtPagesPerSide;      // At level 0
+uniform int vtMaxLevel;
+uniform vec2 vtImageScale;       // Texcoords 0..1 over the image -> over the square virtual space
+uniform float vtCacheTexels;     // Cache side in texels
+
+const float PAGE_SIZE = 128.0;
+const float STORED_PAGE_SIZE = 136.0;
+const float PAGE_BORDER = 4.0;
+
+void main()
+{
+	vec2 virtualCoord = clamp(calculatedTex0Coord, 0.0, 1.0) * vtImageScale;
+
+	// Level from the screen derivatives, like the hardware picks a mip level (but the finer one, no trilinear)
+	vec2 texel = virtualCoord * float(vtPagesPerSide) * PAGE_SIZE;
+	vec2 dx = dFdx(texel), dy = dFdy(texel);
+	float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+	int level = clamp(int(floor(lod)), 0, vtMaxLevel);
+
+	int levelPages = vtPagesPerSide >> level;
+	ivec2 page = clamp(ivec2(virtualCoord * float(levelPages)), ivec2(0), ivec2(levelPages - 1));
+	ivec3 entry = ivec3(texelFetch(vtIndirection, page, level).xyz * 255.0 + 0.5);
+
+	// Where we are inside the page that's actually there (it may be a coarser one covering this page)
+	int mappedLevel = entry.z;
+	vec2 inPage = (virtualCoord * float(vtPagesPerSide >> mappedLevel) - vec2(page >> (mappedLevel - level))) * PAGE_SIZE;
+	vec2 cacheTexel = vec2(entry.xy) * STORED_PAGE_SIZE + PAGE_BORDER + inPage;
+	FragmentColor = textureLod(vtCache, cacheTexel / vtCacheTexels, 0.0);
+}
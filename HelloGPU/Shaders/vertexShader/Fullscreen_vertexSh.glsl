@@ -0,0 +1,13 @@
+#version 330 core
+
+// Fullscreen triangle without any vertex buffer: draw 3 vertices with an empty VAO and build the positions from gl_VertexID
+// (0 -> (-1,-1), 1 -> (3,-1), 2 -> (-1,3)). One triangle covering the screen avoids the diagonal seam of a 2 triangle quad
+
+out vec2 calculatedTexCoord;
+
+void main()
+{
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	calculatedTexCoord = position;
+	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
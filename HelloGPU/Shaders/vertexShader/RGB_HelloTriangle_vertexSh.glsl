@@ -4,6 +4,14 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aCol;
 layout (location = 2) in vec2 aTex0Coord;
 layout (location = 3) in vec2 aTex1Coord;
+layout (location = 4) in mat4 aModel; // Per instance (divisor 1): world matrix from the transform hierarchy, takes locations 4 to 7
+
+layout (std140) uniform Camera // Uniform buffer written once per frame, shared by every program that includes the block
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+};
 
 out vec3 calculatedColor;
 out vec2 calculatedTex0Coord;
@@ -11,7 +19,7 @@ out vec2 calculatedTex1Coord;
 
 void main()
 {
-	gl_Position = vec4(aPos, 1.0);
+	gl_Position = viewProjection * aModel * vec4(aPos, 1.0);
 	calculatedColor = aCol;
 	calculatedTex0Coord = aTex0Coord;
 	calculatedTex1Coord = aTex1Coord;
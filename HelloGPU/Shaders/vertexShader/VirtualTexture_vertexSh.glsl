@@ -0,0 +1,21 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTex0Coord;
+
+layout (std140) uniform Camera // Uniform buffer written once per frame, shared by every program that includes the block
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+};
+
+uniform mat4 model; // One object, no instancing
+
+out vec2 calculatedTex0Coord;
+
+void main()
+{
+	gl_Position = viewProjection * model * vec4(aPos, 1.0);
+	calculatedTex0Coord = aTex0Coord;
+}
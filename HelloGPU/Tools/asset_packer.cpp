@@ -0,0 +1,94 @@
+// Offline asset packer: builds the .hgpak file mounted by Main.cpp (see asset_pack.h for the format)
+//
+// Build (standalone, it is excluded from the HelloGPU project build):
+//     cl /EHsc /O2 /I.. asset_packer.cpp          or          g++ -O2 -I.. asset_packer.cpp -o asset_packer
+//
+// Run it from the HelloGPU folder so the stored paths match the ones the code asks for:
+//     asset_packer HelloGPU.hgpak --lz4 Shaders/vertexShader/RGB_HelloTriangle_vertexSh.glsl Shaders/fragmentShader/RGB_HelloTriangle_fragSh.glsl Textures/images/island.png Textures/images/kenway.png Meshes/quad.hgmesh
+//
+// Options:
+//     --lz4          try LZ4 on every following file (kept only if it saves space)
+//     --align N      blob alignment in bytes, power of two (default 64, 4096 = page aligned)
+//     @list.txt      read more input paths from a text file, one per line
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include "../asset_pack.h"
+
+static bool readWholeFile(const std::string& path, std::vector<unsigned char>& bytes)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    bytes.resize((size_t)size);
+    return size == 0 || (bool)file.read((char*)bytes.data(), size);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: asset_packer <out.hgpak> [--lz4] [--align N] <files... | @list.txt>" << std::endl;
+        return 1;
+    }
+
+    AssetPackWriter writer;
+    bool useLZ4 = false;
+    uint32_t alignment = PACK_DEFAULT_ALIGNMENT;
+    size_t rawTotal = 0;
+    int fileCount = 0;
+
+    std::vector<std::string> inputs;
+    for (int i = 2; i < argc; i++)
+        inputs.push_back(argv[i]);
+
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        const std::string& arg = inputs[i];
+        if (arg == "--lz4")
+        {
+            useLZ4 = true;
+            continue;
+        }
+        if (arg == "--align" && i + 1 < inputs.size())
+        {
+            alignment = (uint32_t)std::strtoul(inputs[++i].c_str(), NULL, 10);
+            continue;
+        }
+        if (!arg.empty() && arg[0] == '@')
+        {
+            std::ifstream list(arg.substr(1));
+            std::string line;
+            while (std::getline(list, line))
+            {
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                if (!line.empty())
+                    inputs.push_back(line);
+            }
+            continue;
+        }
+
+        std::vector<unsigned char> bytes;
+        if (!readWholeFile(arg, bytes))
+        {
+            std::cout << "ERROR::ASSET_PACKER::CANNOT_READ: " << arg << std::endl;
+            return 1;
+        }
+        rawTotal += bytes.size();
+        fileCount++;
+        writer.add(arg, bytes, useLZ4);
+    }
+
+    if (!writer.write(argv[1], alignment))
+        return 1;
+
+    std::cout << "Packed " << fileCount << " files (" << rawTotal << " bytes) into " << argv[1] << std::endl;
+    return 0;
+}
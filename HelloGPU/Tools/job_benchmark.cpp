@@ -0,0 +1,178 @@
+// Job system scaling benchmark: runs the same workloads on pools of 1..N threads (the calling thread + N-1 workers)
+// and prints the time and the speedup over one thread
+//
+// Build (standalone, it is excluded from the HelloGPU project build):
+//     cl /EHsc /O2 /I.. job_benchmark.cpp          or          g++ -O2 -pthread -I.. job_benchmark.cpp -o job_benchmark
+//
+// Usage:
+//     job_benchmark [maxThreads] [repeats]        (defaults: all hardware threads, 5 repeats, the best run is kept)
+//
+// Workloads:
+//     transforms   parallelFor over 1M entity-like records (position += velocity * dt, bounds update), grain 4096: memory bound
+//     compute      parallelFor over 1M items of trig-heavy math, grain 1024: compute bound, should scale ~linearly
+//     tiny jobs    100k separate run() jobs of ~1 microsecond each, submitted from a job: scheduling + stealing overhead
+//     tree         recursive split (each job spawns 2 children until 16k leaves) with waits inside jobs: help-while-waiting
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "../job_system.h"
+
+struct Record
+{
+    float position[3];
+    float velocity[3];
+    float radius;
+    float bounds[4];
+};
+
+static double nowMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static volatile float sink = 0.0f; // Keeps the compute results alive
+
+static void transformsWorkload(JobSystem& jobs, std::vector<Record>& records)
+{
+    jobs.parallelFor(records.size(), 4096, [&records](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            Record& r = records[i];
+            for (int c = 0; c < 3; c++)
+            {
+                r.position[c] += r.velocity[c] * 0.016f;
+                r.bounds[c] = r.position[c];
+            }
+            r.bounds[3] = r.radius;
+        }
+    });
+}
+
+static void computeWorkload(JobSystem& jobs, std::vector<float>& values)
+{
+    jobs.parallelFor(values.size(), 1024, [&values](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            float x = (float)i * 0.001f;
+            for (int k = 0; k < 16; k++)
+                x = std::sin(x) * std::cos(x * 0.5f) + 0.1f;
+            values[i] = x;
+        }
+    });
+}
+
+static void tinyJobsWorkload(JobSystem& jobs)
+{
+    JobCounter all;
+    // Submitted from inside a job so they go to a worker deque and the others have to steal them
+    jobs.run([&jobs, &all]()
+    {
+        for (int i = 0; i < 100000; i++)
+        {
+            jobs.run([i]()
+            {
+                float x = (float)i;
+                for (int k = 0; k < 40; k++)
+                    x = x * 0.999f + 0.5f;
+                if (x < 0.0f)
+                    sink = x;
+            }, &all);
+        }
+    }, &all);
+    jobs.wait(all);
+}
+
+static void treeNode(JobSystem& jobs, int depth)
+{
+    if (depth == 0)
+    {
+        float x = 1.0f;
+        for (int k = 0; k < 2000; k++)
+            x = std::sqrt(x + (float)k);
+        if (x < 0.0f)
+            sink = x;
+        return;
+    }
+    JobCounter children;
+    jobs.run([&jobs, depth]() { treeNode(jobs, depth - 1); }, &children);
+    jobs.run([&jobs, depth]() { treeNode(jobs, depth - 1); }, &children);
+    jobs.wait(children); // Runs other jobs meanwhile instead of blocking this worker
+}
+
+template <typename Workload>
+static double bestOf(int repeats, Workload workload)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++)
+    {
+        double start = nowMs();
+        workload();
+        double elapsed = nowMs() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int hardware = std::thread::hardware_concurrency();
+    unsigned int maxThreads = argc > 1 ? (unsigned int)std::atoi(argv[1]) : (hardware > 0 ? hardware : 1);
+    int repeats = argc > 2 ? std::atoi(argv[2]) : 5;
+    if (maxThreads < 1)
+        maxThreads = 1;
+    if (repeats < 1)
+        repeats = 1;
+
+    std::vector<Record> records(1000000);
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        Record& r = records[i];
+        for (int c = 0; c < 3; c++)
+        {
+            r.position[c] = (float)(i % 1000);
+            r.velocity[c] = 1.0f;
+        }
+        r.radius = 1.0f;
+    }
+    std::vector<float> values(1000000);
+
+    const char* names[4] = { "transforms", "compute", "tiny jobs", "tree" };
+    double baseline[4] = {};
+    std::cout << "Hardware threads: " << hardware << ", best of " << repeats << " runs" << std::endl;
+    std::cout << std::left << std::setw(9) << "threads";
+    for (int w = 0; w < 4; w++)
+        std::cout << std::setw(24) << names[w];
+    std::cout << std::endl;
+
+    for (unsigned int threads = 1; threads <= maxThreads; threads++)
+    {
+        JobSystem jobs(threads - 1); // The thread that waits is the last one
+        double times[4];
+        times[0] = bestOf(repeats, [&]() { transformsWorkload(jobs, records); });
+        times[1] = bestOf(repeats, [&]() { computeWorkload(jobs, values); });
+        times[2] = bestOf(repeats, [&]() { tinyJobsWorkload(jobs); });
+        times[3] = bestOf(repeats, [&]() { treeNode(jobs, 14); });
+
+        std::cout << std::setw(9) << threads;
+        for (int w = 0; w < 4; w++)
+        {
+            if (threads == 1)
+                baseline[w] = times[w];
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision(2) << times[w] << " ms (x" << std::setprecision(2) << baseline[w] / times[w] << ")";
+            std::cout << std::setw(24) << cell.str();
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
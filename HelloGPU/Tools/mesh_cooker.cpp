@@ -0,0 +1,206 @@
+// Offline mesh cooker: turns OBJ / glTF 2.0 source meshes into .hgmesh files (see mesh_format.h) that the app maps and
+// uploads as they are. All the parsing happens here, the runtime never sees text
+//
+// Build (standalone, it is excluded from the HelloGPU project build):
+//     cl /EHsc /O2 /I.. mesh_cooker.cpp          or          g++ -O2 -I.. mesh_cooker.cpp -o mesh_cooker
+//
+// Run it from the HelloGPU folder:
+//     mesh_cooker Meshes/quad.obj Meshes/quad.hgmesh
+//
+// Options:
+//     --no-normals   drop the normals even if the source has them (our scene shader doesn't read them yet)
+//     --no-optimize  keep the exporter's vertex / triangle order (to compare against, see Tools/mesh_draw_benchmark.cpp)
+//     --no-lods      write the full mesh only, no simplified levels of detail
+//
+// Unless --no-lods is given a LOD chain is generated (mesh_simplify.h): each level has about half the triangles of the
+// previous one, simplified from the full mesh, until the simplifier can't remove more than 10% or MESH_MAX_LODS is reached.
+// The levels share the vertex buffer. The app picks one per instance by projected size (mesh_lod.h)
+//
+// Unless --no-optimize is given the vertex and index order is optimized (mesh_optimizer.h): duplicate vertices merged,
+// each level's triangles reordered for the post-transform cache and for overdraw, vertices reordered for fetch. ACMR /
+// ATVR / overdraw / overfetch of the full mesh are printed before and after
+//
+// Vertex layout written (interleaved, locations match the scene shaders):
+//     position   3 x float               location 0
+//     color      4 x unsigned byte, unorm location 1   (white when the source has no colors)
+//     texcoord0  2 x float               location 2   (only if the source has texture coordinates)
+//     texcoord1  2 x float               location 3   (the source's second set, or the same bytes as texcoord0)
+//     normal     3 x float               location 8   (only if the source has normals)
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../mesh_format.h"
+#include "../mesh_import.h"
+#include "../mesh_optimizer.h"
+#include "../mesh_simplify.h"
+
+static double nowMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static MeshFileAttribute makeAttribute(uint32_t location, uint32_t componentType, uint16_t componentCount, bool normalized, uint32_t offset)
+{
+    MeshFileAttribute attribute = { location, componentType, componentCount, (uint16_t)(normalized ? 1 : 0), offset };
+    return attribute;
+}
+
+static unsigned char toUnorm8(float value)
+{
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return (unsigned char)(value * 255.0f + 0.5f);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: mesh_cooker <in.obj | in.gltf | in.glb> <out.hgmesh> [--no-normals] [--no-optimize] [--no-lods]" << std::endl;
+        return 1;
+    }
+    std::string inputPath = argv[1], outputPath = argv[2];
+    bool keepNormals = true, optimize = true, makeLods = true;
+    for (int i = 3; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--no-normals")
+            keepNormals = false;
+        else if (std::string(argv[i]) == "--no-optimize")
+            optimize = false;
+        else if (std::string(argv[i]) == "--no-lods")
+            makeLods = false;
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    double importStart = nowMs();
+    ImportedMesh mesh;
+    if (!importMesh(inputPath, mesh))
+        return 1;
+    double importMs = nowMs() - importStart;
+
+    // Interleaved layout from what the source has
+    std::vector<MeshFileAttribute> attributes;
+    uint32_t stride = 0;
+    attributes.push_back(makeAttribute(MESH_LOCATION_POSITION, MESH_TYPE_FLOAT, 3, false, stride));
+    stride += 3 * sizeof(float);
+    uint32_t colorOffset = stride;
+    attributes.push_back(makeAttribute(MESH_LOCATION_COLOR, MESH_TYPE_UNSIGNED_BYTE, 4, true, stride));
+    stride += 4;
+    uint32_t texcoord0Offset = stride, texcoord1Offset = stride;
+    if (!mesh.texcoords0.empty())
+    {
+        attributes.push_back(makeAttribute(MESH_LOCATION_TEXCOORD0, MESH_TYPE_FLOAT, 2, false, stride));
+        stride += 2 * sizeof(float);
+        if (!mesh.texcoords1.empty())
+        {
+            texcoord1Offset = stride;
+            stride += 2 * sizeof(float);
+        }
+        attributes.push_back(makeAttribute(MESH_LOCATION_TEXCOORD1, MESH_TYPE_FLOAT, 2, false, texcoord1Offset)); // Aliases texcoord0 when there's no second set
+    }
+    bool writeNormals = keepNormals && !mesh.normals.empty();
+    uint32_t normalOffset = stride;
+    if (writeNormals)
+    {
+        attributes.push_back(makeAttribute(MESH_LOCATION_NORMAL, MESH_TYPE_FLOAT, 3, false, stride));
+        stride += 3 * sizeof(float);
+    }
+
+    size_t vertexCount = mesh.vertexCount();
+    std::vector<unsigned char> vertexData(vertexCount * stride, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        unsigned char* vertex = vertexData.data() + v * stride;
+        std::memcpy(vertex, &mesh.positions[v * 3], 3 * sizeof(float));
+        for (int c = 0; c < 3; c++)
+            vertex[colorOffset + c] = mesh.colors.empty() ? 255 : toUnorm8(mesh.colors[v * 3 + c]);
+        vertex[colorOffset + 3] = 255;
+        if (!mesh.texcoords0.empty())
+            std::memcpy(vertex + texcoord0Offset, &mesh.texcoords0[v * 2], 2 * sizeof(float));
+        if (!mesh.texcoords0.empty() && !mesh.texcoords1.empty())
+            std::memcpy(vertex + texcoord1Offset, &mesh.texcoords1[v * 2], 2 * sizeof(float));
+        if (writeNormals)
+            std::memcpy(vertex + normalOffset, &mesh.normals[v * 3], 3 * sizeof(float));
+    }
+
+    // Positions are at offset 0 of the vertex
+    std::vector<uint32_t> indices = mesh.indices;
+    size_t sourceVertexCount = vertexCount;
+    double optimizeStart = nowMs();
+    VertexCacheStats cacheBefore;
+    float overdrawBefore = 0.0f, overfetchBefore = 0.0f;
+    if (optimize && !indices.empty())
+    {
+        cacheBefore = analyzeVertexCache(indices, vertexCount);
+        overdrawBefore = analyzeOverdraw(indices, vertexData.data(), vertexCount, stride, 0);
+        overfetchBefore = analyzeVertexFetch(indices, vertexCount, stride);
+        vertexCount = remapDuplicateVertices(vertexData, stride, indices);
+    }
+
+    // LOD chain, every level simplified from the full mesh
+    std::vector<std::vector<uint32_t>> lodIndices(1, indices);
+    std::vector<float> lodErrors(1, 0.0f);
+    double simplifyStart = nowMs();
+    while (makeLods && lodIndices.size() < MESH_MAX_LODS)
+    {
+        size_t previous = lodIndices.back().size();
+        float error = 0.0f;
+        std::vector<uint32_t> simplified = simplifyMesh(indices, vertexData.data(), vertexCount, stride, 0, previous / 6 * 3, &error);
+        if (simplified.empty() || simplified.size() > previous * 9 / 10)
+            break;
+        lodIndices.push_back(simplified);
+        lodErrors.push_back(std::max(error, lodErrors.back())); // Coarser never claims to be closer than finer
+    }
+    double simplifyMs = nowMs() - simplifyStart;
+
+    // Optimization stage, per level, then all levels into one index list (the finest first, so its vertices come first)
+    std::vector<MeshFileLod> lods;
+    indices.clear();
+    for (size_t l = 0; l < lodIndices.size(); l++)
+    {
+        if (optimize)
+        {
+            std::vector<uint32_t> hardBoundaries;
+            optimizeVertexCache(lodIndices[l], vertexCount, MESH_VERTEX_CACHE_SIZE, &hardBoundaries);
+            optimizeOverdraw(lodIndices[l], vertexData.data(), vertexCount, stride, 0, hardBoundaries);
+        }
+        MeshFileLod lod = { (uint32_t)indices.size(), (uint32_t)lodIndices[l].size(), lodErrors[l], 0 };
+        lods.push_back(lod);
+        indices.insert(indices.end(), lodIndices[l].begin(), lodIndices[l].end());
+    }
+    if (optimize && !indices.empty())
+    {
+        vertexCount = optimizeVertexFetch(vertexData, stride, indices);
+        double optimizeMs = nowMs() - optimizeStart - simplifyMs;
+
+        std::vector<uint32_t> fullIndices(indices.begin(), indices.begin() + lods[0].indexCount);
+        VertexCacheStats cacheAfter = analyzeVertexCache(fullIndices, vertexCount);
+        float overdrawAfter = analyzeOverdraw(fullIndices, vertexData.data(), vertexCount, stride, 0);
+        float overfetchAfter = analyzeVertexFetch(fullIndices, vertexCount, stride);
+        std::cout << "Optimized in " << optimizeMs << " ms: " << sourceVertexCount - vertexCount << " duplicate / unused vertices removed" << std::endl
+            << "    ACMR (cache " << MESH_VERTEX_CACHE_SIZE << ")  " << cacheBefore.acmr << " -> " << cacheAfter.acmr << std::endl
+            << "    ATVR            " << cacheBefore.atvr << " -> " << cacheAfter.atvr << std::endl
+            << "    overdraw        " << overdrawBefore << " -> " << overdrawAfter << std::endl
+            << "    overfetch       " << overfetchBefore << " -> " << overfetchAfter << std::endl;
+    }
+    if (makeLods)
+    {
+        std::cout << "LODs (simplified in " << simplifyMs << " ms):" << std::endl;
+        for (size_t l = 0; l < lods.size(); l++)
+            std::cout << "    " << l << ": " << lods[l].indexCount / 3 << " triangles, error " << lods[l].error << std::endl;
+    }
+
+    if (!writeMeshFile(outputPath, attributes, stride, vertexData, indices, lods))
+        return 1;
+
+    std::cout << inputPath << " -> " << outputPath << ": " << vertexCount << " vertices (" << stride << " bytes each), " << lods[0].indexCount / 3
+        << " triangles (" << lods.size() << " LODs), " << (vertexCount <= 65536 ? 16 : 32) << " bit indices, imported in " << importMs << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,251 @@
+// Mesh draw benchmark: draws cooked meshes (.hgmesh) into an offscreen target and times it on the GPU (or llvmpipe), to
+// see what the cooker's optimization stage (mesh_optimizer.h) is worth. Cook the same source twice and compare:
+//     mesh_cooker in.obj raw.hgmesh --no-optimize
+//     mesh_cooker in.obj optimized.hgmesh
+//     mesh_draw_benchmark raw.hgmesh optimized.hgmesh
+//
+// Build (standalone, it is excluded from the HelloGPU project build), with the same GLFW / glad as the app:
+//     cl /EHsc /O2 /I.. /I<glfw>/include /I<glad>/include mesh_draw_benchmark.cpp <glad>/src/glad.c glfw3.lib opengl32.lib user32.lib gdi32.lib shell32.lib
+//     g++ -O2 -I.. -I<glad>/include mesh_draw_benchmark.cpp <glad>/src/glad.c -lglfw -ldl -o mesh_draw_benchmark
+//
+// Usage:
+//     mesh_draw_benchmark <a.hgmesh> [b.hgmesh ...] [--frames N] [--size S] [--meshlets]     (defaults: 60 frames, 1024 x 1024)
+//
+// --meshlets culls the clusters of every draw on the CPU first (meshlet.h: frustum + normal cone) and draws the rest with
+// glMultiDrawElements; the culling time is part of the frame time, and the share of clusters culled is printed
+//
+// Each frame draws the mesh from 8 directions with back face culling and depth test, with a vertex and a fragment shader
+// that do a bit of work so both vertex shader runs (ACMR) and shaded fragments (overdraw) show. Frames end with glFinish;
+// the median frame is reported. The files are benchmarked in turns so clock / thermal drift hits them all the same
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../simd_math.h"
+#include "../mesh_master.h"
+
+static const char* vertexShaderSource =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "uniform mat4 viewProjection;\n"
+    "uniform mat4 model;\n"
+    "out vec3 normal;\n"
+    "out vec3 worldPos;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 world = model * vec4(aPos, 1.0);\n"
+    "    vec3 p = world.xyz;\n"
+    "    for (int i = 0; i < 16; i++)\n" // Stand-in for skinning / morphing work
+    "        p += 0.0001 * sin(p.yzx * float(i + 1));\n"
+    "    worldPos = p;\n"
+    "    normal = normalize(mat3(model) * aPos);\n"
+    "    gl_Position = viewProjection * vec4(p, 1.0);\n"
+    "}\n";
+
+static const char* fragmentShaderSource =
+    "#version 330 core\n"
+    "in vec3 normal;\n"
+    "in vec3 worldPos;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 n = normalize(normal);\n"
+    "    vec3 color = vec3(0.0);\n"
+    "    for (int i = 0; i < 8; i++)\n" // A few point lights
+    "    {\n"
+    "        vec3 light = vec3(sin(float(i)), cos(float(i) * 1.3), 2.0) * 4.0;\n"
+    "        vec3 toLight = light - worldPos;\n"
+    "        color += max(dot(n, normalize(toLight)), 0.0) / (1.0 + dot(toLight, toLight) * 0.05) * vec3(0.3, 0.25, 0.2);\n"
+    "    }\n"
+    "    FragColor = vec4(color, 1.0);\n"
+    "}\n";
+
+static GLuint compileProgram()
+{
+    GLuint shaders[2] = { glCreateShader(GL_VERTEX_SHADER), glCreateShader(GL_FRAGMENT_SHADER) };
+    const char* sources[2] = { vertexShaderSource, fragmentShaderSource };
+    GLuint program = glCreateProgram();
+    for (int s = 0; s < 2; s++)
+    {
+        glShaderSource(shaders[s], 1, &sources[s], NULL);
+        glCompileShader(shaders[s]);
+        GLint success;
+        glGetShaderiv(shaders[s], GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[1024];
+            glGetShaderInfoLog(shaders[s], sizeof(infoLog), NULL, infoLog);
+            std::cout << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
+            return 0;
+        }
+        glAttachShader(program, shaders[s]);
+    }
+    glLinkProgram(program);
+    glDeleteShader(shaders[0]);
+    glDeleteShader(shaders[1]);
+    return program;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> paths;
+    int frames = 60, size = 1024;
+    bool useMeshlets = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--frames" && i + 1 < argc)
+            frames = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--size" && i + 1 < argc)
+            size = std::max(16, std::atoi(argv[++i]));
+        else if (argument == "--meshlets")
+            useMeshlets = true;
+        else
+            paths.push_back(argument);
+    }
+    if (paths.empty())
+    {
+        std::cout << "Usage: mesh_draw_benchmark <a.hgmesh> [b.hgmesh ...] [--frames N] [--size S] [--meshlets]" << std::endl;
+        return 1;
+    }
+
+    // Hidden window, only for the context: everything is drawn into a framebuffer object
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "mesh_draw_benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    std::cout << glGetString(GL_RENDERER) << " | " << glGetString(GL_VERSION) << std::endl;
+
+    GLuint framebuffer, colorBuffer, depthBuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE" << std::endl;
+        return -1;
+    }
+    glViewport(0, 0, size, size);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    GLuint program = compileProgram();
+    if (program == 0)
+        return -1;
+    glUseProgram(program);
+    GLint viewProjectionLocation = glGetUniformLocation(program, "viewProjection");
+    GLint modelLocation = glGetUniformLocation(program, "model");
+
+    std::vector<GpuMesh> meshes(paths.size());
+    for (size_t m = 0; m < paths.size(); m++)
+        if (!loadMesh(paths[m].c_str(), meshes[m]))
+            return -1;
+
+    // Fits the mesh in the target: camera at 3 radii looking at the origin
+    std::vector<std::vector<double>> frameMs(paths.size());
+    std::vector<double> cullMs(paths.size(), 0.0);
+    std::vector<MeshletDrawList> cullTotals(paths.size());
+    MeshletDrawList drawList;
+    for (int frame = -3; frame < frames; frame++) // 3 warm-up frames
+    {
+        for (size_t m = 0; m < meshes.size(); m++)
+        {
+            const GpuMesh& mesh = meshes[m];
+            float radius = std::max(mesh.boundingRadius, 1e-3f);
+            Mat4 view = mat4LookAt(vec3(0.0f, 0.0f, 3.0f * radius), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+            Mat4 viewProjection = mat4Perspective(0.75f, 1.0f, radius, 5.0f * radius) * view;
+            glUniformMatrix4fv(viewProjectionLocation, 1, GL_FALSE, viewProjection.m);
+            glBindVertexArray(mesh.vertexArray);
+
+            auto start = std::chrono::steady_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (int direction = 0; direction < 8; direction++)
+            {
+                Mat4 model = mat4FromTRS(vec3(0.0f, 0.0f, 0.0f), quatFromAxisAngle(vec3(0.3f, 1.0f, 0.2f), (float)direction * 0.785398f), vec3(1.0f, 1.0f, 1.0f));
+                glUniformMatrix4fv(modelLocation, 1, GL_FALSE, model.m);
+                if (useMeshlets && mesh.meshlets.size() > 0)
+                {
+                    auto cullStart = std::chrono::steady_clock::now();
+                    drawList.clear();
+                    mesh.meshlets.cull((viewProjection * model).m, meshIndexSize(mesh.indexType), drawList);
+                    double cullDrawMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+                    drawMeshlets(mesh, drawList);
+                    if (frame >= 0)
+                    {
+                        cullMs[m] += cullDrawMs;
+                        cullTotals[m].clustersVisible += drawList.clustersVisible;
+                        cullTotals[m].clustersFrustumCulled += drawList.clustersFrustumCulled;
+                        cullTotals[m].clustersBackfaceCulled += drawList.clustersBackfaceCulled;
+                    }
+                }
+                else
+                    glDrawElements(GL_TRIANGLES, mesh.indexCount, mesh.indexType, 0);
+                if (direction + 1 < 8)
+                    glClear(GL_DEPTH_BUFFER_BIT);
+            }
+            glFinish();
+            if (frame >= 0)
+                frameMs[m].push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    double baseline = 0.0;
+    for (size_t m = 0; m < paths.size(); m++)
+    {
+        std::sort(frameMs[m].begin(), frameMs[m].end());
+        double median = frameMs[m][frameMs[m].size() / 2];
+        if (m == 0)
+            baseline = median;
+        std::cout << std::setw(32) << paths[m] << "  " << meshes[m].indexCount / 3 << " triangles, " << meshes[m].vertexCount << " vertices: "
+            << median << " ms / frame (8 draws)";
+        if (m > 0)
+            std::cout << "  " << std::setprecision(1) << (median / baseline - 1.0) * 100.0 << "% vs " << paths[0] << std::setprecision(2);
+        std::cout << std::endl;
+        const MeshletDrawList& totals = cullTotals[m];
+        size_t clusters = totals.clustersVisible + totals.clustersFrustumCulled + totals.clustersBackfaceCulled;
+        if (clusters > 0)
+            std::cout << std::setw(32) << "" << "  " << meshes[m].meshlets.size() << " meshlets: " << std::setprecision(1)
+                << 100.0 * totals.clustersBackfaceCulled / clusters << "% backface culled, " << 100.0 * totals.clustersFrustumCulled / clusters
+                << "% off-screen, culling " << std::setprecision(3) << cullMs[m] / frames / 8 << " ms per draw" << std::setprecision(2) << std::endl;
+    }
+
+    for (size_t m = 0; m < meshes.size(); m++)
+        releaseMesh(meshes[m]);
+    glDeleteProgram(program);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glfwTerminate();
+    return 0;
+}
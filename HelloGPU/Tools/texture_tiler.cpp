@@ -0,0 +1,187 @@
+// Offline texture tiler: cuts an image into the pages of a virtual texture (.hgvt, see virtual_texture_format.h) that the
+// app streams page by page (virtual_texture.h). Meant for images bigger than a GL texture can be (world maps ...): only the
+// pages on screen are ever on the GPU
+//
+// Build (standalone, it is excluded from the HelloGPU project build):
+//     cl /EHsc /O2 /I.. texture_tiler.cpp          or          g++ -O2 -I.. texture_tiler.cpp -o texture_tiler
+//
+// Run it from the HelloGPU folder:
+//     texture_tiler Textures/images/island.png Textures/world.hgvt
+//
+// Options:
+//     --no-lz4       store every page raw (by default a page is LZ4 compressed when that makes it smaller)
+//     --linear       the image is data (normals, masks ...), not sRGB color: filter and sample it as it is
+//
+// The image is flipped like the app flips its textures (first row at the bottom, texcoord v = 0), then every mip level
+// (2x2 box filter, in linear space for sRGB images) down to one page is cut into VT_PAGE_SIZE pages with a VT_PAGE_BORDER texel border taken from the
+// neighbouring pages. The source has to fit in memory once (stb_image limits it to 2 GB of texels)
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../lz4_lite.h"
+#include "../texture_master.h" // downsampleImage, ColorSpace
+#include "../virtual_texture_format.h"
+
+// stb_image's implementation (the app compiles it in stb_image.cpp); after every other include of the header
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb_image.h"
+
+static bool readWholeFile(const std::string& path, std::vector<unsigned char>& bytes)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    bytes.resize((size_t)size);
+    return size == 0 || (bool)file.read((char*)bytes.data(), size);
+}
+
+int main(int argc, char** argv)
+{
+    std::string inputPath, outputPath;
+    bool useLz4 = true;
+    ColorSpace colorSpace = ColorSpace::Srgb;
+    for (int a = 1; a < argc; a++)
+    {
+        std::string argument = argv[a];
+        if (argument == "--no-lz4")
+            useLz4 = false;
+        else if (argument == "--linear")
+            colorSpace = ColorSpace::Linear;
+        else if (inputPath.empty())
+            inputPath = argument;
+        else if (outputPath.empty())
+            outputPath = argument;
+        else
+        {
+            std::cout << "Unexpected argument: " << argument << std::endl;
+            return 1;
+        }
+    }
+    if (inputPath.empty() || outputPath.empty())
+    {
+        std::cout << "Usage: texture_tiler <image> <output.hgvt> [--no-lz4] [--linear]" << std::endl;
+        return 1;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<unsigned char> encoded;
+    if (!readWholeFile(inputPath, encoded) || encoded.empty())
+    {
+        std::cout << "ERROR::TILER::FILE_NOT_SUCCESSFULLY_READ: " << inputPath << std::endl;
+        return 1;
+    }
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, colorChNum;
+    unsigned char* image = stbi_load_from_memory(encoded.data(), (int)encoded.size(), &width, &height, &colorChNum, 4);
+    if (!image)
+    {
+        std::cout << "ERROR::TILER::DECODE_FAILED: " << inputPath << " (" << stbi_failure_reason() << ")" << std::endl;
+        return 1;
+    }
+    encoded.clear();
+    encoded.shrink_to_fit();
+
+    // Square virtual space of a power of two pages on a side, the image in its corner
+    uint32_t pagesNeeded = (uint32_t)((std::max(width, height) + (int)VT_PAGE_SIZE - 1) / (int)VT_PAGE_SIZE);
+    uint32_t levelCount = 1;
+    while ((1u << (levelCount - 1)) < pagesNeeded)
+        levelCount++;
+    if (levelCount > VT_MAX_LEVELS)
+    {
+        std::cout << "ERROR::TILER::IMAGE_TOO_LARGE: " << width << "x" << height << " needs " << levelCount << " levels, the format has " << VT_MAX_LEVELS << std::endl;
+        stbi_image_free(image);
+        return 1;
+    }
+
+    VirtualTextureFileHeader header = {};
+    header.imageWidth = (uint32_t)width;
+    header.imageHeight = (uint32_t)height;
+    header.pagesPerSide = 1u << (levelCount - 1);
+    header.pageSize = VT_PAGE_SIZE;
+    header.pageBorder = VT_PAGE_BORDER;
+    header.levelCount = levelCount;
+    header.flags = colorSpace == ColorSpace::Srgb ? VT_FLAG_SRGB : 0;
+
+    std::vector<VirtualTextureFileLevel> levels;
+    std::vector<VirtualTextureFilePage> pages;
+    std::vector<std::vector<unsigned char>> pageData;
+    std::vector<unsigned char> levelImage, nextLevelImage;
+    std::vector<unsigned char> texels(VT_STORED_PAGE_BYTES), compressed(lz4::compressBound((int)VT_STORED_PAGE_BYTES));
+    const unsigned char* source = image;
+    int levelWidth = width, levelHeight = height;
+    size_t storedPages = 0, rawBytes = 0, storedBytes = 0;
+    for (uint32_t l = 0; l < levelCount; l++)
+    {
+        if (l > 0)
+        {
+            downsampleImage(source, levelWidth, levelHeight, nextLevelImage, colorSpace);
+            levelImage.swap(nextLevelImage);
+            source = levelImage.data();
+            levelWidth = std::max(1, levelWidth / 2);
+            levelHeight = std::max(1, levelHeight / 2);
+            if (l == 1)
+            {
+                stbi_image_free(image); // Level 0 is all cut
+                image = NULL;
+            }
+        }
+        VirtualTextureFileLevel level = {};
+        level.pagesPerSide = header.pagesPerSide >> l;
+        level.firstPage = (uint32_t)pages.size();
+        level.imageWidth = (uint32_t)levelWidth;
+        level.imageHeight = (uint32_t)levelHeight;
+        levels.push_back(level);
+
+        for (uint32_t pageY = 0; pageY < level.pagesPerSide; pageY++)
+        {
+            for (uint32_t pageX = 0; pageX < level.pagesPerSide; pageX++)
+            {
+                VirtualTextureFilePage page = {};
+                pageData.push_back(std::vector<unsigned char>());
+                if ((int)(pageX * VT_PAGE_SIZE) >= levelWidth || (int)(pageY * VT_PAGE_SIZE) >= levelHeight)
+                {
+                    pages.push_back(page); // All padding
+                    continue;
+                }
+                // Page + border; outside the image the edge texels repeat (clamp to edge)
+                for (uint32_t y = 0; y < VT_STORED_PAGE_SIZE; y++)
+                {
+                    int sourceY = std::min(std::max((int)(pageY * VT_PAGE_SIZE + y) - (int)VT_PAGE_BORDER, 0), levelHeight - 1);
+                    for (uint32_t x = 0; x < VT_STORED_PAGE_SIZE; x++)
+                    {
+                        int sourceX = std::min(std::max((int)(pageX * VT_PAGE_SIZE + x) - (int)VT_PAGE_BORDER, 0), levelWidth - 1);
+                        std::memcpy(&texels[((size_t)y * VT_STORED_PAGE_SIZE + x) * 4], source + ((size_t)sourceY * levelWidth + sourceX) * 4, 4);
+                    }
+                }
+                int compressedSize = useLz4 ? lz4::compress(texels.data(), (int)texels.size(), compressed.data(), (int)compressed.size()) : 0;
+                if (compressedSize > 0 && (size_t)compressedSize < texels.size())
+                {
+                    page.flags = VT_PAGE_LZ4;
+                    pageData.back().assign(compressed.begin(), compressed.begin() + compressedSize);
+                }
+                else
+                    pageData.back() = texels;
+                pages.push_back(page);
+                storedPages++;
+                rawBytes += texels.size();
+                storedBytes += pageData.back().size();
+            }
+        }
+    }
+    stbi_image_free(image);
+    header.pageCount = (uint32_t)pages.size();
+
+    if (!writeVirtualTextureFile(outputPath, header, levels, pages, pageData))
+        return 1;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << inputPath << " -> " << outputPath << ": " << width << "x" << height << ", " << header.pagesPerSide << "x" << header.pagesPerSide << " pages at level 0, "
+        << levelCount << " levels, " << storedPages << " pages stored (" << header.pageCount - storedPages << " all padding), " << rawBytes / 1024 << " KB raw -> "
+        << storedBytes / 1024 << " KB" << (useLz4 ? " (LZ4)" : "") << (colorSpace == ColorSpace::Srgb ? ", sRGB" : ", linear") << " in " << ms << " ms" << std::endl;
+    return 0;
+}
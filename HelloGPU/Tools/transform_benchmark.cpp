@@ -0,0 +1,173 @@
+// Transform hierarchy benchmark: 1M nodes in a random tree, world matrices recomputed after different amounts of change,
+// on one thread and on the whole job system, next to a classic pointer-based scene graph walked recursively
+//
+// Build (standalone, it is excluded from the HelloGPU project build):
+//     cl /EHsc /O2 /I.. transform_benchmark.cpp          or          g++ -O2 -pthread -I.. transform_benchmark.cpp -o transform_benchmark
+//
+// Usage:
+//     transform_benchmark [nodes] [repeats]        (defaults: 1000000 nodes, 5 repeats, the best run is kept)
+//
+// Cases:
+//     pointer graph   every node a heap object with a child list, recursive update of everything (the baseline)
+//     all dirty       every root moved: the whole hierarchy is recomputed
+//     10% / 1% dirty  that many random nodes moved: only their subtrees are recomputed
+//     clean           nothing moved: the cost of finding out
+//     rebuild         breadth-first sort of the arrays (only happens when nodes are added)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../simd_math.h"
+#include "../transform_hierarchy.h"
+
+struct PointerNode
+{
+    Vec3 position;
+    Quat rotation;
+    Vec3 scale;
+    Mat4 world;
+    std::vector<PointerNode*> children;
+};
+
+static void updatePointerNode(PointerNode* node, const Mat4& parentWorld)
+{
+    mat4Multiply(parentWorld, mat4FromTRS(node->position, node->rotation, node->scale), node->world);
+    for (size_t i = 0; i < node->children.size(); i++)
+        updatePointerNode(node->children[i], node->world);
+}
+
+static double nowMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename Workload>
+static double bestOf(int repeats, Workload workload)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++)
+    {
+        double start = nowMs();
+        workload();
+        double elapsed = nowMs() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+static void printRow(const char* name, double ms, size_t recomputed, size_t nodes)
+{
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(3) << std::setw(10) << ms << " ms"
+        << std::setw(10) << std::setprecision(2) << ms * 1e6 / (double)nodes << " ns/node" << std::setw(12) << recomputed << " recomputed" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t nodeCount = argc > 1 ? (size_t)std::atol(argv[1]) : 1000000;
+    int repeats = argc > 2 ? std::atoi(argv[2]) : 5;
+    if (nodeCount < 16)
+        nodeCount = 16;
+    if (repeats < 1)
+        repeats = 1;
+
+    // Random tree: a few hundred roots, every other node hangs under a random earlier one (depth grows like log n)
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<uint32_t> parents(nodeCount);
+    std::vector<Vec3> positions(nodeCount);
+    std::vector<Quat> rotations(nodeCount);
+    TransformHierarchy hierarchy;
+    for (size_t i = 0; i < nodeCount; i++)
+    {
+        parents[i] = i < 256 ? (uint32_t)TransformHierarchy::NO_PARENT : (uint32_t)(random() % i);
+        positions[i] = vec3(unit(random), unit(random), unit(random));
+        rotations[i] = quatFromAxisAngle(vec3(0.0f, 0.0f, 1.0f), unit(random) * 3.1416f);
+        hierarchy.addNode(parents[i], positions[i], rotations[i], vec3(0.9f, 0.9f, 0.9f));
+    }
+
+    std::vector<std::unique_ptr<PointerNode>> pointerNodes(nodeCount);
+    std::vector<PointerNode*> pointerRoots;
+    std::vector<size_t> shuffled(nodeCount); // Allocation order unrelated to the tree, like a scene built over time
+    for (size_t i = 0; i < nodeCount; i++)
+        shuffled[i] = i;
+    std::shuffle(shuffled.begin(), shuffled.end(), random);
+    for (size_t i = 0; i < nodeCount; i++)
+    {
+        pointerNodes[shuffled[i]].reset(new PointerNode());
+        PointerNode& node = *pointerNodes[shuffled[i]];
+        node.position = positions[shuffled[i]];
+        node.rotation = rotations[shuffled[i]];
+        node.scale = vec3(0.9f, 0.9f, 0.9f);
+    }
+    for (size_t i = 0; i < nodeCount; i++)
+    {
+        if (parents[i] == TransformHierarchy::NO_PARENT)
+            pointerRoots.push_back(pointerNodes[i].get());
+        else
+            pointerNodes[parents[i]]->children.push_back(pointerNodes[i].get());
+    }
+
+    double rebuildMs = nowMs();
+    hierarchy.update(); // First update sorts the arrays
+    rebuildMs = nowMs() - rebuildMs;
+
+    std::cout << nodeCount << " nodes, " << hierarchy.levelCount() << " levels, job system with " << JobSystem::get().workerCount() + 1
+        << " thread(s), best of " << repeats << " runs" << std::endl;
+
+    Mat4 identity = mat4Identity();
+    double pointerMs = bestOf(repeats, [&]()
+    {
+        for (size_t r = 0; r < pointerRoots.size(); r++)
+            updatePointerNode(pointerRoots[r], identity);
+    });
+    printRow("pointer graph", pointerMs, nodeCount, nodeCount);
+    printRow("rebuild (sort)", rebuildMs, 0, nodeCount);
+
+    const char* threadNames[2] = { "1 thread", "all threads" };
+    for (int threads = 0; threads < 2; threads++)
+    {
+        hierarchy.parallelGrain = threads == 0 ? nodeCount : 4096; // A grain over the largest level keeps every level on this thread
+        std::cout << "-- " << threadNames[threads] << std::endl;
+
+        const double fractions[3] = { 1.0, 0.1, 0.01 };
+        const char* names[3] = { "all dirty", "10% dirty", "1% dirty" };
+        for (int f = 0; f < 3; f++)
+        {
+            size_t recomputed = 0;
+            double best = 1e30;
+            for (int r = 0; r < repeats; r++)
+            {
+                // Flagging is part of the frame's animation, not of the update: keep it out of the timing
+                if (fractions[f] >= 1.0)
+                {
+                    for (size_t i = 0; i < 256; i++)
+                        hierarchy.setLocal((uint32_t)i, positions[i], rotations[i]);
+                }
+                else
+                {
+                    size_t moved = (size_t)((double)nodeCount * fractions[f]);
+                    for (size_t i = 0; i < moved; i++)
+                    {
+                        uint32_t node = (uint32_t)(random() % nodeCount);
+                        hierarchy.setLocal(node, positions[node], rotations[node]);
+                    }
+                }
+                double start = nowMs();
+                recomputed = hierarchy.update();
+                best = std::min(best, nowMs() - start);
+            }
+            printRow(names[f], best, recomputed, nodeCount);
+        }
+        size_t cleanRecomputed = 0;
+        double cleanMs = bestOf(repeats, [&]() { cleanRecomputed = hierarchy.update(); });
+        printRow("clean", cleanMs, cleanRecomputed, nodeCount);
+    }
+    return 0;
+}
@@ -0,0 +1,281 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+// Asset pack (.hgpak): one file that holds every shader & texture so startup costs a single open + mmap instead of
+// one filesystem lookup per asset (that's what hurts on network mounted storage)
+//
+// Layout:
+//   PackHeader                        (32 bytes)
+//   PackEntry[entryCount]             (32 bytes each, sorted by path hash -> binary search)
+//   path strings                      (not null terminated, referenced by PackEntry::pathOffset)
+//   blobs                             (each one starts on a 'alignment' boundary, optionally LZ4 compressed)
+//
+// All integers are little endian. Paths are normalized (forward slashes, no leading "./") before hashing so
+// "Shaders\\vertexShader\\x.glsl" and "./Shaders/vertexShader/x.glsl" find the same entry
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "mapped_file.h"
+#include "lz4_lite.h"
+
+const char PACK_MAGIC[4] = { 'H', 'G', 'P', 'K' };
+const uint32_t PACK_VERSION = 1;
+const uint32_t PACK_DEFAULT_ALIGNMENT = 64; // Cache line; use 4096 to get page aligned blobs
+
+const uint16_t PACK_ENTRY_LZ4 = 1 << 0;
+
+struct PackHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t alignment;
+    uint64_t indexOffset;
+    uint64_t stringsOffset;
+};
+
+struct PackEntry
+{
+    uint64_t pathHash;
+    uint64_t dataOffset;
+    uint32_t storedSize;  // Bytes in the pack
+    uint32_t rawSize;     // Bytes after decompression (== storedSize when not compressed)
+    uint32_t pathOffset;  // Relative to PackHeader::stringsOffset
+    uint16_t pathLength;
+    uint16_t flags;
+};
+
+static_assert(sizeof(PackHeader) == 32, "PackHeader layout is part of the file format");
+static_assert(sizeof(PackEntry) == 32, "PackEntry layout is part of the file format");
+
+// Normalize and hash asset paths the same way in the packer and at runtime
+// ------------------------------------------------------------------------
+inline std::string normalizeAssetPath(const std::string& path)
+{
+    std::string normalized = path;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+    while (normalized.compare(0, 2, "./") == 0)
+        normalized.erase(0, 2);
+    return normalized;
+}
+
+inline uint64_t hashAssetPath(const std::string& normalizedPath)
+{
+    uint64_t hash = 14695981039346656037ull; // FNV-1a 64
+    for (size_t i = 0; i < normalizedPath.size(); i++)
+    {
+        hash ^= (unsigned char)normalizedPath[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+
+// Read side: maps the pack once and answers lookups from the in-memory index
+// ------------------------------------------------------------------------
+class AssetPack
+{
+public:
+    bool open(const std::string& packPath)
+    {
+        if (!file.open(packPath))
+            return false;
+
+        if (file.size() < sizeof(PackHeader))
+        {
+            std::cout << "ERROR::ASSET_PACK::TRUNCATED_HEADER: " << packPath << std::endl;
+            file.close();
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(PackHeader));
+        if (std::memcmp(header.magic, PACK_MAGIC, 4) != 0 || header.version != PACK_VERSION)
+        {
+            std::cout << "ERROR::ASSET_PACK::BAD_MAGIC_OR_VERSION: " << packPath << std::endl;
+            file.close();
+            return false;
+        }
+        uint64_t indexBytes = (uint64_t)header.entryCount * sizeof(PackEntry);
+        if (!inFile(header.indexOffset, indexBytes) || header.stringsOffset > file.size())
+        {
+            std::cout << "ERROR::ASSET_PACK::TRUNCATED_INDEX: " << packPath << std::endl;
+            file.close();
+            return false;
+        }
+
+        // The index is touched by every lookup, ask for it up front in one go
+        file.willNeed((size_t)header.indexOffset, (size_t)indexBytes);
+        entries = (const PackEntry*)(file.data() + header.indexOffset);
+        return true;
+    }
+
+    // Find the entry of a (normalized) path or NULL. Binary search on the hash, then compare the stored path to rule out collisions
+    // ------------------------------------------------------------------------
+    const PackEntry* find(const std::string& normalizedPath) const
+    {
+        if (entries == NULL)
+            return NULL;
+        uint64_t hash = hashAssetPath(normalizedPath);
+        const PackEntry* first = entries;
+        const PackEntry* last = entries + header.entryCount;
+        const PackEntry* it = std::lower_bound(first, last, hash, [](const PackEntry& entry, uint64_t value) { return entry.pathHash < value; });
+        for (; it != last && it->pathHash == hash; ++it)
+        {
+            if (it->pathLength == normalizedPath.size() &&
+                inFile(header.stringsOffset + it->pathOffset, it->pathLength) && // stringsOffset <= size (open) and pathOffset is 32 bit: no wrap
+                std::memcmp(file.data() + header.stringsOffset + it->pathOffset, normalizedPath.data(), it->pathLength) == 0)
+                return it;
+        }
+        return NULL;
+    }
+
+    // Pointer to the stored bytes of an entry (still compressed if the entry has PACK_ENTRY_LZ4)
+    // ------------------------------------------------------------------------
+    const unsigned char* storedData(const PackEntry& entry) const
+    {
+        if (!inFile(entry.dataOffset, entry.storedSize))
+            return NULL;
+        return file.data() + entry.dataOffset;
+    }
+
+    void prefetch(const PackEntry& entry) const
+    {
+        if (!inFile(entry.dataOffset, entry.storedSize))
+            return;
+        file.willNeed((size_t)entry.dataOffset, entry.storedSize);
+    }
+
+    uint32_t entryCount() const { return entries ? header.entryCount : 0; }
+
+private:
+    MappedFile file;
+    PackHeader header = {};
+
+    // Does [offset, offset + bytes) lie inside the mapping? Offsets come from the file (maybe over a network mount, maybe
+    // damaged): compare against what is left after the offset, offset + bytes could wrap around
+    bool inFile(uint64_t offset, uint64_t bytes) const
+    {
+        return offset <= file.size() && bytes <= file.size() - offset;
+    }
+
+    const PackEntry* entries = NULL;
+};
+
+
+// Write side: used by the offline packer (Tools/asset_packer.cpp)
+// ------------------------------------------------------------------------
+class AssetPackWriter
+{
+public:
+    // Add a file under the given asset path. Compression is only kept when it actually shrinks the blob (PNGs won't)
+    void add(const std::string& assetPath, const std::vector<unsigned char>& bytes, bool tryLZ4)
+    {
+        PendingEntry pending;
+        pending.path = normalizeAssetPath(assetPath);
+        pending.rawSize = (uint32_t)bytes.size();
+        pending.flags = 0;
+        pending.data = bytes;
+
+        if (tryLZ4 && !bytes.empty())
+        {
+            std::vector<unsigned char> compressed(lz4::compressBound((int)bytes.size()));
+            int compressedSize = lz4::compress(bytes.data(), (int)bytes.size(), compressed.data(), (int)compressed.size());
+            if (compressedSize > 0 && (size_t)compressedSize < bytes.size() - bytes.size() / 16) // Keep only if it saves > ~6%
+            {
+                compressed.resize(compressedSize);
+                pending.data.swap(compressed);
+                pending.flags |= PACK_ENTRY_LZ4;
+            }
+        }
+        pendingEntries.push_back(pending);
+    }
+
+    bool write(const std::string& packPath, uint32_t alignment = PACK_DEFAULT_ALIGNMENT)
+    {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        {
+            std::cout << "ERROR::ASSET_PACK::ALIGNMENT_NOT_POWER_OF_TWO: " << alignment << std::endl;
+            return false;
+        }
+
+        std::sort(pendingEntries.begin(), pendingEntries.end(), [](const PendingEntry& a, const PendingEntry& b) { return hashAssetPath(a.path) < hashAssetPath(b.path); });
+
+        PackHeader header = {};
+        std::memcpy(header.magic, PACK_MAGIC, 4);
+        header.version = PACK_VERSION;
+        header.entryCount = (uint32_t)pendingEntries.size();
+        header.alignment = alignment;
+        header.indexOffset = sizeof(PackHeader);
+        header.stringsOffset = header.indexOffset + pendingEntries.size() * sizeof(PackEntry);
+
+        std::string strings;
+        std::vector<PackEntry> index(pendingEntries.size());
+        for (size_t i = 0; i < pendingEntries.size(); i++)
+        {
+            index[i].pathHash = hashAssetPath(pendingEntries[i].path);
+            index[i].pathOffset = (uint32_t)strings.size();
+            index[i].pathLength = (uint16_t)pendingEntries[i].path.size();
+            strings += pendingEntries[i].path;
+        }
+
+        uint64_t cursor = header.stringsOffset + strings.size();
+        for (size_t i = 0; i < pendingEntries.size(); i++)
+        {
+            cursor = alignUp(cursor, alignment);
+            index[i].dataOffset = cursor;
+            index[i].storedSize = (uint32_t)pendingEntries[i].data.size();
+            index[i].rawSize = pendingEntries[i].rawSize;
+            index[i].flags = pendingEntries[i].flags;
+            cursor += pendingEntries[i].data.size();
+        }
+
+        std::ofstream out(packPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::ASSET_PACK::CANNOT_WRITE: " << packPath << std::endl;
+            return false;
+        }
+        out.write((const char*)&header, sizeof(header));
+        if (!index.empty())
+            out.write((const char*)index.data(), index.size() * sizeof(PackEntry));
+        out.write(strings.data(), strings.size());
+
+        uint64_t written = header.stringsOffset + strings.size();
+        const char padding[4096] = {};
+        for (size_t i = 0; i < pendingEntries.size(); i++)
+        {
+            uint64_t pad = index[i].dataOffset - written;
+            while (pad > 0)
+            {
+                size_t chunk = pad > sizeof(padding) ? sizeof(padding) : (size_t)pad;
+                out.write(padding, chunk);
+                pad -= chunk;
+            }
+            out.write((const char*)pendingEntries[i].data.data(), pendingEntries[i].data.size());
+            written = index[i].dataOffset + pendingEntries[i].data.size();
+        }
+        return (bool)out;
+    }
+
+private:
+    struct PendingEntry
+    {
+        std::string path;
+        uint32_t rawSize;
+        uint16_t flags;
+        std::vector<unsigned char> data;
+    };
+    std::vector<PendingEntry> pendingEntries;
+
+    static uint64_t alignUp(uint64_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) & ~(uint64_t)(alignment - 1);
+    }
+};
+
+#endif
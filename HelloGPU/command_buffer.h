@@ -0,0 +1,345 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+// Deferred GL command lists. Any thread can record draw/bind/uniform commands into a CommandList (no GL calls, no context
+// needed), and the thread that owns the GL context replays the lists in order. Each list writes its commands back to back
+// into its own LinearAllocator, so recording never takes a lock and after the first frames never touches the heap
+//
+//     std::vector<CommandList> lists(3);
+//     recordParallel(lists, [&](CommandList& list, size_t index) { ...record part 'index' of the scene... });
+//     for (...) replayCommandList(lists[i]);      // GL thread, list order = submission order
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "gl_state_cache.h"
+#include "job_system.h"
+
+// Bump allocator over fixed-size blocks. reset() rewinds it but keeps the blocks for the next frame
+// ------------------------------------------------------------------------
+class LinearAllocator
+{
+public:
+    explicit LinearAllocator(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+
+    // Alignment up to alignof(std::max_align_t): block memory comes from the heap which is at least that aligned
+    void* allocate(size_t size, size_t alignment)
+    {
+        // Move forward through the blocks (the ones past currentBlock are left over from earlier frames and empty)
+        while (currentBlock < blocks.size())
+        {
+            Block& block = blocks[currentBlock];
+            size_t offset = alignUp(block.used, alignment);
+            if (offset + size <= block.memory.size())
+            {
+                block.used = offset + size;
+                return block.memory.data() + offset;
+            }
+            currentBlock++;
+        }
+        Block block;
+        block.memory.resize(size > blockSize ? size : blockSize);
+        block.used = size;
+        blocks.push_back(std::move(block));
+        return blocks.back().memory.data();
+    }
+
+    void reset()
+    {
+        for (size_t i = 0; i < blocks.size(); i++)
+            blocks[i].used = 0;
+        currentBlock = 0;
+    }
+
+    // Walk the used part of every block in allocation order
+    size_t blockCount() const { return currentBlock < blocks.size() ? currentBlock + 1 : blocks.size(); }
+    const unsigned char* blockData(size_t index) const { return blocks[index].memory.data(); }
+    size_t blockUsed(size_t index) const { return blocks[index].used; }
+
+private:
+    struct Block
+    {
+        std::vector<unsigned char> memory;
+        size_t used = 0;
+    };
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t currentBlock = 0;
+
+    static size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+};
+
+
+enum class CommandType : uint16_t
+{
+    Clear,
+    UseProgram,
+    BindTexture,
+    BindSampler,
+    BindVertexArray,
+    SetBlendMode,
+    Uniform1i,
+    Uniform1f,
+    UniformMatrix4f,
+    DrawElements,
+    DrawElementsInstanced
+};
+
+// Every command starts with this header. 'size' covers header + payload so the replay can step over it
+struct CommandHeader
+{
+    CommandType type;
+    uint16_t size;
+};
+
+struct ClearCommand { CommandHeader header; GLbitfield mask; float color[4]; };
+struct UseProgramCommand { CommandHeader header; GLuint program; };
+struct BindTextureCommand { CommandHeader header; GLuint unit; GLenum target; GLuint texture; };
+struct BindSamplerCommand { CommandHeader header; GLuint unit; GLuint sampler; };
+struct BindVertexArrayCommand { CommandHeader header; GLuint vertexArray; };
+struct SetBlendModeCommand { CommandHeader header; BlendMode mode; };
+struct Uniform1iCommand { CommandHeader header; GLint location; GLint value; };
+struct Uniform1fCommand { CommandHeader header; GLint location; GLfloat value; };
+struct UniformMatrix4fCommand { CommandHeader header; GLint location; GLfloat value[16]; };
+struct DrawElementsCommand { CommandHeader header; GLenum mode; GLsizei count; GLenum indexType; uintptr_t indexOffset; };
+struct DrawElementsInstancedCommand { CommandHeader header; GLenum mode; GLsizei count; GLenum indexType; uintptr_t indexOffset; GLsizei instanceCount; };
+
+const size_t COMMAND_ALIGNMENT = 8;
+
+
+class CommandList
+{
+public:
+    // Forget the recorded commands (memory is kept)
+    void reset()
+    {
+        allocator.reset();
+        commandCount = 0;
+    }
+
+    void clear(GLbitfield mask, float r, float g, float b, float a)
+    {
+        ClearCommand* command = push<ClearCommand>(CommandType::Clear);
+        command->mask = mask;
+        command->color[0] = r;
+        command->color[1] = g;
+        command->color[2] = b;
+        command->color[3] = a;
+    }
+    void useProgram(GLuint program)
+    {
+        push<UseProgramCommand>(CommandType::UseProgram)->program = program;
+    }
+    void bindTexture(GLuint unit, GLenum target, GLuint texture)
+    {
+        BindTextureCommand* command = push<BindTextureCommand>(CommandType::BindTexture);
+        command->unit = unit;
+        command->target = target;
+        command->texture = texture;
+    }
+    void bindSampler(GLuint unit, GLuint sampler)
+    {
+        BindSamplerCommand* command = push<BindSamplerCommand>(CommandType::BindSampler);
+        command->unit = unit;
+        command->sampler = sampler;
+    }
+    void bindVertexArray(GLuint vertexArray)
+    {
+        push<BindVertexArrayCommand>(CommandType::BindVertexArray)->vertexArray = vertexArray;
+    }
+    void setBlendMode(BlendMode mode)
+    {
+        push<SetBlendModeCommand>(CommandType::SetBlendMode)->mode = mode;
+    }
+    // Uniform locations must be looked up beforehand on the GL thread (glGetUniformLocation needs the context)
+    void uniform1i(GLint location, GLint value)
+    {
+        Uniform1iCommand* command = push<Uniform1iCommand>(CommandType::Uniform1i);
+        command->location = location;
+        command->value = value;
+    }
+    void uniform1f(GLint location, GLfloat value)
+    {
+        Uniform1fCommand* command = push<Uniform1fCommand>(CommandType::Uniform1f);
+        command->location = location;
+        command->value = value;
+    }
+    void uniformMatrix4f(GLint location, const GLfloat* columnMajor)
+    {
+        UniformMatrix4fCommand* command = push<UniformMatrix4fCommand>(CommandType::UniformMatrix4f);
+        command->location = location;
+        std::memcpy(command->value, columnMajor, sizeof(command->value));
+    }
+    void drawElements(GLenum mode, GLsizei count, GLenum indexType, uintptr_t indexOffset)
+    {
+        DrawElementsCommand* command = push<DrawElementsCommand>(CommandType::DrawElements);
+        command->mode = mode;
+        command->count = count;
+        command->indexType = indexType;
+        command->indexOffset = indexOffset;
+    }
+    void drawElementsInstanced(GLenum mode, GLsizei count, GLenum indexType, uintptr_t indexOffset, GLsizei instanceCount)
+    {
+        DrawElementsInstancedCommand* command = push<DrawElementsInstancedCommand>(CommandType::DrawElementsInstanced);
+        command->mode = mode;
+        command->count = count;
+        command->indexType = indexType;
+        command->indexOffset = indexOffset;
+        command->instanceCount = instanceCount;
+    }
+
+    size_t size() const { return commandCount; }
+    const LinearAllocator& memory() const { return allocator; }
+
+private:
+    LinearAllocator allocator;
+    size_t commandCount = 0;
+
+    template <typename Command>
+    Command* push(CommandType type)
+    {
+        static_assert(sizeof(Command) <= 0xFFFF, "Command size must fit CommandHeader::size");
+        Command* command = (Command*)allocator.allocate(alignUp(sizeof(Command)), COMMAND_ALIGNMENT);
+        command->header.type = type;
+        command->header.size = (uint16_t)alignUp(sizeof(Command));
+        commandCount++;
+        return command;
+    }
+
+    static size_t alignUp(size_t value)
+    {
+        return (value + COMMAND_ALIGNMENT - 1) & ~(COMMAND_ALIGNMENT - 1);
+    }
+};
+
+
+// Execute one recorded list. GL thread only. With a state cache, binds of what is already bound are skipped
+// ------------------------------------------------------------------------
+inline void replayCommandList(const CommandList& list, GLStateCache* stateCache = NULL)
+{
+    const LinearAllocator& memory = list.memory();
+    for (size_t block = 0; block < memory.blockCount(); block++)
+    {
+        const unsigned char* cursor = memory.blockData(block);
+        const unsigned char* const end = cursor + memory.blockUsed(block);
+        while (cursor < end)
+        {
+            const CommandHeader* header = (const CommandHeader*)cursor;
+            switch (header->type)
+            {
+            case CommandType::Clear:
+            {
+                const ClearCommand* command = (const ClearCommand*)cursor;
+                glClearColor(command->color[0], command->color[1], command->color[2], command->color[3]);
+                glClear(command->mask);
+                break;
+            }
+            case CommandType::UseProgram:
+            {
+                GLuint program = ((const UseProgramCommand*)cursor)->program;
+                if (stateCache)
+                    stateCache->useProgram(program);
+                else
+                    glUseProgram(program);
+                break;
+            }
+            case CommandType::BindTexture:
+            {
+                const BindTextureCommand* command = (const BindTextureCommand*)cursor;
+                if (stateCache)
+                {
+                    stateCache->bindTexture(command->unit, command->target, command->texture);
+                }
+                else
+                {
+                    glActiveTexture(GL_TEXTURE0 + command->unit);
+                    glBindTexture(command->target, command->texture);
+                }
+                break;
+            }
+            case CommandType::BindSampler:
+            {
+                const BindSamplerCommand* command = (const BindSamplerCommand*)cursor;
+                if (stateCache)
+                    stateCache->bindSampler(command->unit, command->sampler);
+                else
+                    glBindSampler(command->unit, command->sampler);
+                break;
+            }
+            case CommandType::BindVertexArray:
+            {
+                GLuint vertexArray = ((const BindVertexArrayCommand*)cursor)->vertexArray;
+                if (stateCache)
+                    stateCache->bindVertexArray(vertexArray);
+                else
+                    glBindVertexArray(vertexArray);
+                break;
+            }
+            case CommandType::SetBlendMode:
+            {
+                BlendMode mode = ((const SetBlendModeCommand*)cursor)->mode;
+                if (stateCache)
+                    stateCache->setBlendMode(mode);
+                else
+                    applyBlendMode(mode);
+                break;
+            }
+            case CommandType::Uniform1i:
+            {
+                const Uniform1iCommand* command = (const Uniform1iCommand*)cursor;
+                glUniform1i(command->location, command->value);
+                break;
+            }
+            case CommandType::Uniform1f:
+            {
+                const Uniform1fCommand* command = (const Uniform1fCommand*)cursor;
+                glUniform1f(command->location, command->value);
+                break;
+            }
+            case CommandType::UniformMatrix4f:
+            {
+                const UniformMatrix4fCommand* command = (const UniformMatrix4fCommand*)cursor;
+                glUniformMatrix4fv(command->location, 1, GL_FALSE, command->value);
+                break;
+            }
+            case CommandType::DrawElements:
+            {
+                const DrawElementsCommand* command = (const DrawElementsCommand*)cursor;
+                glDrawElements(command->mode, command->count, command->indexType, (const void*)command->indexOffset);
+                break;
+            }
+            case CommandType::DrawElementsInstanced:
+            {
+                const DrawElementsInstancedCommand* command = (const DrawElementsInstancedCommand*)cursor;
+                glDrawElementsInstanced(command->mode, command->count, command->indexType, (const void*)command->indexOffset, command->instanceCount);
+                break;
+            }
+            }
+            cursor += header->size;
+        }
+    }
+}
+
+// Record lists.size() lists at the same time, one job per list on the shared job system (the calling thread takes part).
+// 'record' gets the list to fill and its index, and must not call GL
+// ------------------------------------------------------------------------
+inline void recordParallel(std::vector<CommandList>& lists, const std::function<void(CommandList&, size_t)>& record)
+{
+    JobSystem::get().parallelFor(lists.size(), 1, [&lists, &record](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            lists[i].reset();
+            record(lists[i], i);
+        }
+    });
+}
+
+#endif
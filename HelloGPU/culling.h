@@ -0,0 +1,393 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+// Visibility culling for many objects:
+// - BoundsSoA: one bounding sphere per object, stored as 4 separate float arrays (structure of arrays) so the frustum test
+//   runs on 8 (AVX) or 4 (SSE) objects per instruction straight out of memory
+// - frustumCull(): sphere vs 6 planes of a view-projection matrix, writes the indices of the objects that survive
+// - OcclusionBuffer: small depth buffer rasterized on the CPU from a few big occluders, reduced into a max-depth pyramid
+//   (hierarchical Z). An object whose screen rectangle is behind every texel it covers can't be seen
+//
+// Matrices are column major (OpenGL layout). Depth in the occlusion buffer is window depth: 0 = near, 1 = far
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULLING_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_SSE 1
+#endif
+
+struct CullingStats
+{
+    unsigned int total = 0;
+    unsigned int frustumCulled = 0;
+    unsigned int occlusionCulled = 0;
+    unsigned int visible = 0;
+    double frustumMs = 0.0;
+    double occlusionMs = 0.0; // Occluder rasterization + Hi-Z build + tests
+};
+
+struct Frustum
+{
+    float planes[6][4]; // xyz = normal pointing inside, w = distance. Normalized so plane distances are in world units
+
+    // Gribb/Hartmann: the planes are sums/differences of the rows of the view-projection matrix
+    // ------------------------------------------------------------------------
+    static Frustum fromMatrix(const float* m)
+    {
+        Frustum frustum;
+        for (int p = 0; p < 6; p++)
+        {
+            int row = p / 2;
+            float sign = (p % 2 == 0) ? 1.0f : -1.0f; // left/bottom/near: row3 + row, right/top/far: row3 - row
+            float length2 = 0.0f;
+            for (int c = 0; c < 4; c++)
+            {
+                frustum.planes[p][c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+                if (c < 3)
+                    length2 += frustum.planes[p][c] * frustum.planes[p][c];
+            }
+            float inverse = length2 > 0.0f ? 1.0f / std::sqrt(length2) : 0.0f;
+            for (int c = 0; c < 4; c++)
+                frustum.planes[p][c] *= inverse;
+        }
+        return frustum;
+    }
+};
+
+
+class BoundsSoA
+{
+public:
+    static const size_t LANES = 8; // Arrays are padded to a multiple of this so SIMD loops never need a scalar tail
+
+    size_t add(float x, float y, float z, float radius)
+    {
+        size_t index = count++;
+        grow();
+        set(index, x, y, z, radius);
+        return index;
+    }
+
+    void set(size_t index, float x, float y, float z, float radius)
+    {
+        centerX[index] = x;
+        centerY[index] = y;
+        centerZ[index] = z;
+        radii[index] = radius;
+    }
+
+    // Remove by moving the last sphere into 'index' (order is not kept)
+    void swapRemove(size_t index)
+    {
+        size_t last = count - 1;
+        set(index, centerX[last], centerY[last], centerZ[last], radii[last]);
+        set(last, 0.0f, 0.0f, 0.0f, -1e30f); // Back to padding
+        count--;
+    }
+
+    void clear()
+    {
+        count = 0;
+        centerX.clear();
+        centerY.clear();
+        centerZ.clear();
+        radii.clear();
+    }
+
+    size_t size() const { return count; }
+    size_t paddedSize() const { return radii.size(); }
+    const float* x() const { return centerX.data(); }
+    const float* y() const { return centerY.data(); }
+    const float* z() const { return centerZ.data(); }
+    const float* radius() const { return radii.data(); }
+
+private:
+    std::vector<float> centerX, centerY, centerZ, radii;
+    size_t count = 0;
+
+    void grow()
+    {
+        size_t padded = (count + LANES - 1) / LANES * LANES;
+        if (padded <= radii.size())
+            return;
+        // Padding spheres have a hugely negative radius: they fail every plane test and are never reported
+        centerX.resize(padded, 0.0f);
+        centerY.resize(padded, 0.0f);
+        centerZ.resize(padded, 0.0f);
+        radii.resize(padded, -1e30f);
+    }
+};
+
+
+// Append the index of every sphere inside (or crossing) the frustum to 'visible'. Returns how many were appended
+// ------------------------------------------------------------------------
+inline size_t frustumCull(const BoundsSoA& bounds, const Frustum& frustum, std::vector<uint32_t>& visible)
+{
+    const size_t before = visible.size();
+    const float* xs = bounds.x();
+    const float* ys = bounds.y();
+    const float* zs = bounds.z();
+    const float* rs = bounds.radius();
+    const size_t padded = bounds.paddedSize();
+
+#if defined(CULLING_AVX)
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; p++)
+    {
+        planeX[p] = _mm256_set1_ps(frustum.planes[p][0]);
+        planeY[p] = _mm256_set1_ps(frustum.planes[p][1]);
+        planeZ[p] = _mm256_set1_ps(frustum.planes[p][2]);
+        planeW[p] = _mm256_set1_ps(frustum.planes[p][3]);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (size_t i = 0; i < padded; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(xs + i);
+        __m256 y = _mm256_loadu_ps(ys + i);
+        __m256 z = _mm256_loadu_ps(zs + i);
+        __m256 negativeRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(rs + i));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, planeX[p]), _mm256_mul_ps(y, planeY[p])),
+                _mm256_add_ps(_mm256_mul_ps(z, planeZ[p]), planeW[p]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GT_OQ));
+        }
+        unsigned int mask = (unsigned int)_mm256_movemask_ps(inside);
+        while (mask)
+        {
+            unsigned int lane = 0;
+            while (!(mask & (1u << lane)))
+                lane++;
+            visible.push_back((uint32_t)(i + lane));
+            mask &= mask - 1;
+        }
+    }
+#elif defined(CULLING_SSE)
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; p++)
+    {
+        planeX[p] = _mm_set1_ps(frustum.planes[p][0]);
+        planeY[p] = _mm_set1_ps(frustum.planes[p][1]);
+        planeZ[p] = _mm_set1_ps(frustum.planes[p][2]);
+        planeW[p] = _mm_set1_ps(frustum.planes[p][3]);
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t i = 0; i < padded; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(xs + i);
+        __m128 y = _mm_loadu_ps(ys + i);
+        __m128 z = _mm_loadu_ps(zs + i);
+        __m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(rs + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])),
+                _mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+            inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negativeRadius));
+        }
+        unsigned int mask = (unsigned int)_mm_movemask_ps(inside);
+        for (unsigned int lane = 0; lane < 4; lane++)
+            if (mask & (1u << lane))
+                visible.push_back((uint32_t)(i + lane));
+    }
+#else
+    for (size_t i = 0; i < padded; i++)
+    {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++)
+            inside = xs[i] * frustum.planes[p][0] + ys[i] * frustum.planes[p][1] + zs[i] * frustum.planes[p][2] + frustum.planes[p][3] > -rs[i];
+        if (inside)
+            visible.push_back((uint32_t)i);
+    }
+#endif
+
+    return visible.size() - before;
+}
+
+// Screen rectangle (NDC) and nearest window depth of a sphere, from the 8 corners of its bounding box.
+// Returns false when part of it is behind the camera: then we know nothing and the object must be drawn
+// ------------------------------------------------------------------------
+inline bool projectSphere(const float* m, float x, float y, float z, float radius, float rect[4], float& nearestDepth)
+{
+    rect[0] = rect[1] = 1e30f;
+    rect[2] = rect[3] = -1e30f;
+    nearestDepth = 1.0f;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        float px = x + ((corner & 1) ? radius : -radius);
+        float py = y + ((corner & 2) ? radius : -radius);
+        float pz = z + ((corner & 4) ? radius : -radius);
+        float w = m[3] * px + m[7] * py + m[11] * pz + m[15];
+        if (w <= 1e-6f)
+            return false;
+        float ndcX = (m[0] * px + m[4] * py + m[8] * pz + m[12]) / w;
+        float ndcY = (m[1] * px + m[5] * py + m[9] * pz + m[13]) / w;
+        float depth = (m[2] * px + m[6] * py + m[10] * pz + m[14]) / w * 0.5f + 0.5f;
+        rect[0] = std::min(rect[0], ndcX);
+        rect[1] = std::min(rect[1], ndcY);
+        rect[2] = std::max(rect[2], ndcX);
+        rect[3] = std::max(rect[3], ndcY);
+        nearestDepth = std::min(nearestDepth, depth);
+    }
+    return true;
+}
+
+
+class OcclusionBuffer
+{
+public:
+    explicit OcclusionBuffer(int width = 256, int height = 128) : width(width), height(height)
+    {
+        // Level 0 is the rasterized depth, every next level keeps the farthest depth of a 2x2 block
+        int w = width, h = height;
+        while (true)
+        {
+            Level level;
+            level.width = w;
+            level.height = h;
+            level.depth.assign((size_t)w * h, 1.0f);
+            levels.push_back(level);
+            if (w == 1 && h == 1)
+                break;
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+        }
+    }
+
+    void clear()
+    {
+        std::fill(levels[0].depth.begin(), levels[0].depth.end(), 1.0f);
+    }
+
+    // Occluder triangle, vertices in NDC x,y and window depth z (use transformToScreen). Keeps the nearest depth per texel
+    // ------------------------------------------------------------------------
+    void rasterizeTriangle(const float* a, const float* b, const float* c)
+    {
+        float ax = toPixelX(a[0]), ay = toPixelY(a[1]);
+        float bx = toPixelX(b[0]), by = toPixelY(b[1]);
+        float cx = toPixelX(c[0]), cy = toPixelY(c[1]);
+        float area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+        if (std::fabs(area) < 1e-8f)
+            return;
+
+        int minX = std::max(0, (int)std::floor(std::min(ax, std::min(bx, cx))));
+        int maxX = std::min(width - 1, (int)std::ceil(std::max(ax, std::max(bx, cx))));
+        int minY = std::max(0, (int)std::floor(std::min(ay, std::min(by, cy))));
+        int maxY = std::min(height - 1, (int)std::ceil(std::max(ay, std::max(by, cy))));
+        float inverseArea = 1.0f / area;
+
+        std::vector<float>& depth = levels[0].depth;
+        for (int py = minY; py <= maxY; py++)
+        {
+            float sampleY = py + 0.5f;
+            for (int px = minX; px <= maxX; px++)
+            {
+                // Barycentric weights at the texel center (edge functions, either winding)
+                float sampleX = px + 0.5f;
+                float w0 = ((bx - sampleX) * (cy - sampleY) - (by - sampleY) * (cx - sampleX)) * inverseArea;
+                float w1 = ((cx - sampleX) * (ay - sampleY) - (cy - sampleY) * (ax - sampleX)) * inverseArea;
+                float w2 = 1.0f - w0 - w1;
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                    continue;
+                float z = w0 * a[2] + w1 * b[2] + w2 * c[2];
+                float& stored = depth[(size_t)py * width + px];
+                if (z < stored)
+                    stored = z;
+            }
+        }
+    }
+
+    // Reduce level 0 into the max-depth pyramid. Call once after all occluders are rasterized
+    // ------------------------------------------------------------------------
+    void buildHiZ()
+    {
+        for (size_t l = 1; l < levels.size(); l++)
+        {
+            const Level& source = levels[l - 1];
+            Level& target = levels[l];
+            for (int y = 0; y < target.height; y++)
+            {
+                for (int x = 0; x < target.width; x++)
+                {
+                    // Odd sizes: the last texel of the level also covers the leftover source row/column
+                    int x0 = x * 2, x1 = (x == target.width - 1) ? source.width - 1 : x * 2 + 1;
+                    int y0 = y * 2, y1 = (y == target.height - 1) ? source.height - 1 : y * 2 + 1;
+                    float farthest = 0.0f;
+                    for (int sy = y0; sy <= y1; sy++)
+                        for (int sx = x0; sx <= x1; sx++)
+                            farthest = std::max(farthest, source.depth[(size_t)sy * source.width + sx]);
+                    target.depth[(size_t)y * target.width + x] = farthest;
+                }
+            }
+        }
+    }
+
+    // Is a screen rectangle (NDC minX, minY, maxX, maxY) whose nearest point is at 'nearestDepth' hidden by the occluders?
+    // The rectangle is grown by one texel: occluders are sampled at texel centers, so a texel on their edge may be only
+    // half covered and must not hide anything on its own
+    // ------------------------------------------------------------------------
+    bool isOccluded(const float rect[4], float nearestDepth) const
+    {
+        float minX = toPixelX(rect[0]) - 1.0f, maxX = toPixelX(rect[2]) + 1.0f;
+        float minY = toPixelY(rect[1]) - 1.0f, maxY = toPixelY(rect[3]) + 1.0f;
+        if (maxX < 0.0f || maxY < 0.0f || minX >= (float)width || minY >= (float)height)
+            return false; // Off screen, the frustum test decides
+        minX = std::max(minX, 0.0f);
+        minY = std::max(minY, 0.0f);
+        maxX = std::min(maxX, (float)width - 1.0f);
+        maxY = std::min(maxY, (float)height - 1.0f);
+
+        // Coarsest level at which the rectangle still spans at most ~4 texels per side: a handful of reads per object
+        float extent = std::max(maxX - minX, maxY - minY);
+        size_t level = 0;
+        while (level + 1 < levels.size() && extent > 4.0f)
+        {
+            extent *= 0.5f;
+            level++;
+        }
+
+        const Level& hiZ = levels[level];
+        int scale = 1 << level;
+        int x0 = std::min(hiZ.width - 1, (int)minX / scale), x1 = std::min(hiZ.width - 1, (int)maxX / scale);
+        int y0 = std::min(hiZ.height - 1, (int)minY / scale), y1 = std::min(hiZ.height - 1, (int)maxY / scale);
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                if (nearestDepth <= hiZ.depth[(size_t)y * hiZ.width + x])
+                    return false;
+        return true;
+    }
+
+    // Object-space point -> NDC x,y + window depth, for rasterizeTriangle. False if behind the camera
+    static bool transformToScreen(const float* m, float x, float y, float z, float out[3])
+    {
+        float w = m[3] * x + m[7] * y + m[11] * z + m[15];
+        if (w <= 1e-6f)
+            return false;
+        out[0] = (m[0] * x + m[4] * y + m[8] * z + m[12]) / w;
+        out[1] = (m[1] * x + m[5] * y + m[9] * z + m[13]) / w;
+        out[2] = (m[2] * x + m[6] * y + m[10] * z + m[14]) / w * 0.5f + 0.5f;
+        return true;
+    }
+
+private:
+    struct Level
+    {
+        int width, height;
+        std::vector<float> depth;
+    };
+    int width, height;
+    std::vector<Level> levels;
+
+    float toPixelX(float ndc) const { return (ndc * 0.5f + 0.5f) * width; }
+    float toPixelY(float ndc) const { return (ndc * 0.5f + 0.5f) * height; }
+};
+
+#endif
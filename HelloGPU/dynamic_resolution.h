@@ -0,0 +1,182 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+// Dynamic resolution. The scene is drawn into an offscreen texture whose size is the window size times a scale, and the
+// scale follows the measured frame time: too slow -> render fewer pixels, plenty of headroom -> render more again.
+// - GpuFrameTimer: GL_TIME_ELAPSED queries in a small ring, read a few frames later so we never wait on the GPU
+// - DynamicResolution: turns frame times into a scale, within [minScale, maxScale], with hysteresis so it doesn't
+//   flip between two sizes (every change reallocates the scene target)
+
+#include <glad/glad.h>
+
+#include <cmath>
+
+// Ring of timer queries. begin()/end() around the GPU work of a frame; latestMs() is the most recent finished result
+// ------------------------------------------------------------------------
+class GpuFrameTimer
+{
+public:
+    static const int LATENCY = 4; // Frames in flight we can measure before reusing a query
+
+    ~GpuFrameTimer() { release(); }
+
+    void begin()
+    {
+        if (!created)
+        {
+            glGenQueries(LATENCY, queries);
+            created = true;
+        }
+        // Collect what finished before reusing the slot (if it's still not done we drop that measurement)
+        collect();
+        glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+    }
+
+    void end()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        pending[current] = true;
+        current = (current + 1) % LATENCY;
+    }
+
+    // Last GPU time in milliseconds, negative until a first result came back
+    double latestMs() const { return latest; }
+
+    // Delete the queries while the context is still current
+    void release()
+    {
+        if (!created)
+            return;
+        glDeleteQueries(LATENCY, queries);
+        created = false;
+    }
+
+private:
+    GLuint queries[LATENCY] = {};
+    bool pending[LATENCY] = {};
+    int current = 0;
+    bool created = false;
+    double latest = -1.0;
+
+    // Oldest first so 'latest' ends up being the newest available result. 'current' is the oldest slot: it was issued
+    // LATENCY frames ago and is about to be reused
+    void collect()
+    {
+        for (int i = 0; i < LATENCY; i++)
+        {
+            int slot = (current + i) % LATENCY;
+            if (!pending[slot])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available && slot != current)
+                continue;
+            if (available)
+            {
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &nanoseconds);
+                latest = (double)nanoseconds / 1000000.0;
+            }
+            pending[slot] = false; // The slot about to be reused is dropped even if unfinished
+        }
+    }
+};
+
+
+struct DynamicResolutionSettings
+{
+    double targetMs = 1000.0 / 60.0; // Frame budget
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float scaleStep = 0.05f;         // Scales are snapped to this so tiny changes don't reallocate the target
+    double downThreshold = 1.0;      // Go down when the smoothed time is above targetMs * downThreshold
+    double upThreshold = 0.8;        // Go up only when it's below targetMs * upThreshold (the gap is the hysteresis)
+    int framesBeforeChange = 8;      // Consecutive frames the condition must hold
+    int cooldownFrames = 15;         // Frames to wait after a change before judging the new size
+};
+
+class DynamicResolution
+{
+public:
+    explicit DynamicResolution(const DynamicResolutionSettings& settings = DynamicResolutionSettings())
+        : settings(settings), currentScale(settings.maxScale) {}
+
+    // Feed the times of the last frame (GPU time negative = unknown, then the CPU time alone is used).
+    // The slower of the two is what limits the frame. Returns true when the scale changed
+    // ------------------------------------------------------------------------
+    bool update(double gpuMs, double cpuMs)
+    {
+        double frameMs = gpuMs > cpuMs ? gpuMs : cpuMs;
+        if (frameMs <= 0.0)
+            return false;
+        smoothedMs = smoothedMs < 0.0 ? frameMs : smoothedMs + (frameMs - smoothedMs) * 0.2; // Exponential moving average
+
+        if (cooldown > 0)
+        {
+            cooldown--;
+            return false;
+        }
+
+        if (smoothedMs > settings.targetMs * settings.downThreshold)
+        {
+            overBudgetFrames++;
+            underBudgetFrames = 0;
+        }
+        else if (smoothedMs < settings.targetMs * settings.upThreshold)
+        {
+            underBudgetFrames++;
+            overBudgetFrames = 0;
+        }
+        else
+        {
+            overBudgetFrames = underBudgetFrames = 0; // Inside the band: keep the current size
+        }
+
+        if (overBudgetFrames < settings.framesBeforeChange && underBudgetFrames < settings.framesBeforeChange)
+            return false;
+
+        // Cost is roughly proportional to the pixel count (scale^2), so aim straight for the scale that fits the budget.
+        // Going up we aim for the middle of the band and take one step at most, it's cheaper to be a bit too small than to overshoot
+        double ratio = settings.targetMs / smoothedMs;
+        if (underBudgetFrames > 0)
+            ratio *= 0.5 * (settings.downThreshold + settings.upThreshold);
+        float wanted = currentScale * (float)std::sqrt(ratio);
+        if (underBudgetFrames > 0 && wanted > currentScale + settings.scaleStep)
+            wanted = currentScale + settings.scaleStep;
+        float next = snap(wanted, overBudgetFrames > 0);
+
+        overBudgetFrames = underBudgetFrames = 0;
+        if (next == currentScale)
+            return false;
+        currentScale = next;
+        cooldown = settings.cooldownFrames;
+        smoothedMs = -1.0; // Old measurements were made at the old size
+        return true;
+    }
+
+    float scale() const { return currentScale; }
+    double smoothedFrameMs() const { return smoothedMs; }
+    const DynamicResolutionSettings& config() const { return settings; }
+
+private:
+    DynamicResolutionSettings settings;
+    float currentScale;
+    double smoothedMs = -1.0;
+    int overBudgetFrames = 0;
+    int underBudgetFrames = 0;
+    int cooldown = 0;
+
+    // Going down we round down as well, so the new size really fits the budget
+    float snap(float value, bool roundDown) const
+    {
+        if (settings.scaleStep > 0.0f)
+            value = std::floor(value / settings.scaleStep + (roundDown ? 0.001f : 0.5f)) * settings.scaleStep;
+        if (value < settings.minScale)
+            value = settings.minScale;
+        if (value > settings.maxScale)
+            value = settings.maxScale;
+        return value;
+    }
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+// Frame timing for the render loop:
+// - FixedTimestep: runs the simulation in fixed steps (accumulator) no matter how fast we render, and gives the
+//   interpolation factor between the last two simulation states for rendering
+// - FrameLimiter: how the loop is paced (vsync, uncapped, sleep+spin to a target rate, adaptive vsync)
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <thread>
+
+class FixedTimestep
+{
+public:
+    explicit FixedTimestep(double stepSeconds, double maxFrameSeconds = 0.25)
+        : stepSeconds(stepSeconds), maxFrameSeconds(maxFrameSeconds) {}
+
+    // Restart the clock without catching up on the time that passed (after the window was hidden, after loading ...)
+    // ------------------------------------------------------------------------
+    void reset(double now)
+    {
+        lastTime = now;
+        accumulator = 0.0;
+        started = true;
+    }
+
+    // Feed the time of the new frame. Frame time is clamped so a long stall can't make us simulate forever (spiral of death)
+    // ------------------------------------------------------------------------
+    void beginFrame(double now)
+    {
+        if (!started)
+            reset(now);
+        double frameTime = now - lastTime;
+        if (frameTime > maxFrameSeconds)
+            frameTime = maxFrameSeconds;
+        if (frameTime < 0.0)
+            frameTime = 0.0;
+        lastTime = now;
+        accumulator += frameTime;
+    }
+
+    // while (timestep.step()) { previous = current; simulate(current, timestep.dt()); }
+    // ------------------------------------------------------------------------
+    bool step()
+    {
+        if (accumulator < stepSeconds)
+            return false;
+        accumulator -= stepSeconds;
+        return true;
+    }
+
+    // How far we are between the previous and the current simulation state [0, 1)
+    float alpha() const { return (float)(accumulator / stepSeconds); }
+    float dt() const { return (float)stepSeconds; }
+
+private:
+    double stepSeconds;
+    double maxFrameSeconds;
+    double lastTime = 0.0;
+    double accumulator = 0.0;
+    bool started = false;
+};
+
+
+enum class FrameLimitMode
+{
+    VSync,      // Swap interval 1: the driver blocks in glfwSwapBuffers until the next vblank
+    Unlimited,  // Swap interval 0: no pacing at all (benchmarking)
+    Target,     // Swap interval 0 + sleep most of the remaining frame time and spin the last bit for precision
+    Adaptive    // Swap interval -1 (EXT_swap_control_tear): vsync while we make the rate, tear instead of halving when we miss it
+};
+
+class FrameLimiter
+{
+public:
+    FrameLimiter(FrameLimitMode mode, double targetFps = 60.0) : mode(mode)
+    {
+        setTargetFps(targetFps);
+    }
+
+    // Apply the swap interval for the mode. Needs the context current on this thread
+    // ------------------------------------------------------------------------
+    void apply()
+    {
+        switch (mode)
+        {
+        case FrameLimitMode::VSync:
+            glfwSwapInterval(1);
+            break;
+        case FrameLimitMode::Unlimited:
+        case FrameLimitMode::Target:
+            glfwSwapInterval(0);
+            break;
+        case FrameLimitMode::Adaptive:
+            if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+                glfwSwapInterval(-1);
+            else
+                glfwSwapInterval(1); // Plain vsync is the closest thing we have
+            break;
+        }
+        frameStart = Clock::now();
+    }
+
+    void setTargetFps(double fps)
+    {
+        targetFrame = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / (fps > 1.0 ? fps : 1.0)));
+    }
+
+    // Call once per frame after glfwSwapBuffers. Only the Target mode waits here
+    // ------------------------------------------------------------------------
+    void endFrame()
+    {
+        if (mode == FrameLimitMode::Target)
+        {
+            Clock::time_point deadline = frameStart + targetFrame;
+
+            // Sleep while we're safely far from the deadline. The margin follows how late sleep_for wakes us up
+            // (OS timer granularity), so we spin as little as possible
+            Clock::time_point now = Clock::now();
+            if (deadline - now > spinMargin)
+            {
+                Clock::duration requested = deadline - now - spinMargin;
+                std::this_thread::sleep_for(requested);
+                Clock::duration overshoot = (Clock::now() - now) - requested;
+                if (overshoot < Clock::duration::zero())
+                    overshoot = Clock::duration::zero();
+                spinMargin = (spinMargin * 7 + overshoot * 2) / 8; // Lean towards the worst recent overshoot
+                if (spinMargin < MIN_SPIN_MARGIN)
+                    spinMargin = MIN_SPIN_MARGIN;
+            }
+            while (Clock::now() < deadline)
+                std::this_thread::yield();
+
+            // Schedule from the deadline (not from 'now') so the average rate stays exact, unless we're far behind
+            frameStart = Clock::now() - deadline > targetFrame ? Clock::now() : deadline;
+        }
+        else
+        {
+            frameStart = Clock::now();
+        }
+    }
+
+    FrameLimitMode getMode() const { return mode; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    const Clock::duration MIN_SPIN_MARGIN = std::chrono::microseconds(200);
+
+    FrameLimitMode mode;
+    Clock::duration targetFrame;
+    Clock::duration spinMargin = std::chrono::milliseconds(2);
+    Clock::time_point frameStart = Clock::now();
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+// Extensions above our GLAD profile (3.3 core, no extensions). Entry points and enums are declared here and loaded at
+// runtime through the same loader GLAD used, so the project builds against the plain 3.3 GLAD and only uses the
+// faster paths where the driver has them. Call initGLExtensions() right after gladLoadGLLoader()
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <set>
+#include <string>
+
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#endif
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
+
+typedef void (APIENTRYP PFN_glMaxShaderCompilerThreads)(GLuint count);
+typedef void (APIENTRYP PFN_glTexStorage2D)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+
+struct GLExtensions
+{
+    std::set<std::string> names;
+    GLADloadproc loader = NULL;
+
+    // GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile
+    bool parallelShaderCompile = false;
+    PFN_glMaxShaderCompilerThreads glMaxShaderCompilerThreads = NULL;
+
+    // GL_ARB_texture_storage (core in 4.2): immutable texture storage, see texture_objects.h
+    bool textureStorage = false;
+    PFN_glTexStorage2D glTexStorage2D = NULL;
+
+    // GL_EXT_texture_filter_anisotropic / GL_ARB_texture_filter_anisotropic (core in 4.6): just enums, no entry points
+    bool textureFilterAnisotropic = false;
+    float maxTextureAnisotropy = 1.0f; // Highest GL_TEXTURE_MAX_ANISOTROPY_EXT the driver takes
+};
+
+inline GLExtensions& glExtensions()
+{
+    static GLExtensions extensions;
+    return extensions;
+}
+
+inline bool hasGLExtension(const char* name)
+{
+    return glExtensions().names.count(name) != 0;
+}
+
+// Query the extension list once (core profile: glGetStringi) and resolve the optional entry points
+// ------------------------------------------------------------------------
+inline void initGLExtensions(GLADloadproc loader)
+{
+    GLExtensions& ext = glExtensions();
+    ext.loader = loader;
+
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const GLubyte* name = glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (name != NULL)
+            ext.names.insert((const char*)name);
+    }
+
+    if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+        ext.glMaxShaderCompilerThreads = (PFN_glMaxShaderCompilerThreads)loader("glMaxShaderCompilerThreadsKHR");
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+        ext.glMaxShaderCompilerThreads = (PFN_glMaxShaderCompilerThreads)loader("glMaxShaderCompilerThreadsARB");
+    ext.parallelShaderCompile = ext.glMaxShaderCompilerThreads != NULL;
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (hasGLExtension("GL_ARB_texture_storage") || major > 4 || (major == 4 && minor >= 2))
+        ext.glTexStorage2D = (PFN_glTexStorage2D)loader("glTexStorage2D"); // Same name in the extension and in core
+    ext.textureStorage = ext.glTexStorage2D != NULL;
+
+    ext.textureFilterAnisotropic = hasGLExtension("GL_EXT_texture_filter_anisotropic") || hasGLExtension("GL_ARB_texture_filter_anisotropic")
+        || major > 4 || (major == 4 && minor >= 6);
+    if (ext.textureFilterAnisotropic)
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &ext.maxTextureAnisotropy);
+}
+
+#endif
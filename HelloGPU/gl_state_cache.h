@@ -0,0 +1,213 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+// Shadow copy of the GL bindings we change most (program, textures & samplers per unit, VAO, blend mode). Binding what is already
+// bound is skipped before it reaches the driver, and every real switch is counted so we can see what a frame costs.
+// Only valid if all binds go through it: call invalidate() after code that binds behind its back
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+const unsigned int STATE_CACHE_TEXTURE_UNITS = 16;
+
+// How a draw's color reaches the target. Textures hold premultiplied alpha (see premultiplyAlpha() in texture_master.h), so
+// one blend function covers every translucent draw:
+//   Opaque              blending off, depth writes on: the cheapest fill, and later draws behind it fail the early depth test
+//   PremultipliedAlpha  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA), depth writes off (tested, not written: what is behind
+//                       a translucent surface still has to draw). Draw back to front, after the opaque ones
+enum class BlendMode : uint8_t
+{
+    Opaque,
+    PremultipliedAlpha
+};
+
+// Set 'mode' on the GL state, without a cache
+inline void applyBlendMode(BlendMode mode)
+{
+    if (mode == BlendMode::Opaque)
+    {
+        glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+        return;
+    }
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+}
+
+struct GLStateCounters
+{
+    unsigned int programSwitches = 0;
+    unsigned int textureSwitches = 0;
+    unsigned int samplerSwitches = 0;
+    unsigned int vertexArraySwitches = 0;
+    unsigned int blendSwitches = 0;
+    unsigned int redundantSkipped = 0;
+
+    unsigned int total() const { return programSwitches + textureSwitches + samplerSwitches + vertexArraySwitches + blendSwitches; }
+};
+
+// What is bound right now (0xFFFFFFFF = unknown). Also used on its own to count switches of a draw order without issuing GL calls
+// ------------------------------------------------------------------------
+struct BoundState
+{
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    GLuint textures[STATE_CACHE_TEXTURE_UNITS];
+    GLenum textureTargets[STATE_CACHE_TEXTURE_UNITS];
+    GLuint samplers[STATE_CACHE_TEXTURE_UNITS];
+    GLuint activeUnit = UNKNOWN;
+    int blendMode = -1; // A BlendMode, -1 = unknown
+
+    BoundState() { reset(); }
+
+    void reset()
+    {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        activeUnit = UNKNOWN;
+        blendMode = -1;
+        for (unsigned int i = 0; i < STATE_CACHE_TEXTURE_UNITS; i++)
+        {
+            textures[i] = UNKNOWN;
+            textureTargets[i] = 0;
+            samplers[i] = UNKNOWN;
+        }
+    }
+
+    // Each returns true if the binding actually changes
+    bool setProgram(GLuint value)
+    {
+        if (program == value)
+            return false;
+        program = value;
+        return true;
+    }
+    bool setVertexArray(GLuint value)
+    {
+        if (vertexArray == value)
+            return false;
+        vertexArray = value;
+        return true;
+    }
+    bool setTexture(GLuint unit, GLenum target, GLuint value)
+    {
+        if (unit >= STATE_CACHE_TEXTURE_UNITS)
+            return true; // Not tracked, always bind
+        if (textures[unit] == value && textureTargets[unit] == target)
+            return false;
+        textures[unit] = value;
+        textureTargets[unit] = target;
+        return true;
+    }
+    bool setSampler(GLuint unit, GLuint value)
+    {
+        if (unit >= STATE_CACHE_TEXTURE_UNITS)
+            return true;
+        if (samplers[unit] == value)
+            return false;
+        samplers[unit] = value;
+        return true;
+    }
+    bool setBlendMode(BlendMode value)
+    {
+        if (blendMode == (int)value)
+            return false;
+        blendMode = (int)value;
+        return true;
+    }
+};
+
+
+class GLStateCache
+{
+public:
+    void useProgram(GLuint program)
+    {
+        if (!bound.setProgram(program))
+        {
+            counters.redundantSkipped++;
+            return;
+        }
+        glUseProgram(program);
+        counters.programSwitches++;
+    }
+
+    void bindTexture(GLuint unit, GLenum target, GLuint texture)
+    {
+        if (!bound.setTexture(unit, target, texture))
+        {
+            counters.redundantSkipped++;
+            return;
+        }
+        if (bound.activeUnit != unit)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            bound.activeUnit = unit;
+        }
+        glBindTexture(target, texture);
+        counters.textureSwitches++;
+    }
+
+    // Bind a texture to change it: glTexParameteri, glTexImage2D, glTexSubImage2D ... act on the active unit, so 'unit' is
+    // made active even when the bind itself is skipped (bindTexture() alone leaves whatever unit was active last)
+    void bindTextureForEdit(GLuint unit, GLenum target, GLuint texture)
+    {
+        bindTexture(unit, target, texture);
+        if (bound.activeUnit != unit)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            bound.activeUnit = unit;
+        }
+    }
+
+    // Sampler objects are bound by unit directly, no active unit switch. 0 = the texture's own parameters
+    void bindSampler(GLuint unit, GLuint sampler)
+    {
+        if (!bound.setSampler(unit, sampler))
+        {
+            counters.redundantSkipped++;
+            return;
+        }
+        glBindSampler(unit, sampler);
+        counters.samplerSwitches++;
+    }
+
+    void setBlendMode(BlendMode mode)
+    {
+        if (!bound.setBlendMode(mode))
+        {
+            counters.redundantSkipped++;
+            return;
+        }
+        applyBlendMode(mode);
+        counters.blendSwitches++;
+    }
+
+    void bindVertexArray(GLuint vertexArray)
+    {
+        if (!bound.setVertexArray(vertexArray))
+        {
+            counters.redundantSkipped++;
+            return;
+        }
+        glBindVertexArray(vertexArray);
+        counters.vertexArraySwitches++;
+    }
+
+    // Forget everything (someone else touched the bindings, or a texture/program was deleted and its name may be reused)
+    void invalidate() { bound.reset(); }
+
+    // Per-frame statistics
+    const GLStateCounters& frameCounters() const { return counters; }
+    void resetCounters() { counters = GLStateCounters(); }
+
+private:
+    BoundState bound;
+    GLStateCounters counters;
+};
+
+#endif
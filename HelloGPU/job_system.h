@@ -0,0 +1,375 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+// Work-stealing job system shared by everything that wants parallelism (texture decode, scene updates, culling, command
+// recording), instead of every subsystem spawning its own threads:
+// - Every worker has its own Chase-Lev deque: it pushes and pops jobs at the bottom (LIFO, cache-warm, no contention),
+//   idle workers steal from the top of the others'. Threads that aren't workers (main, render) submit through a shared queue
+// - A JobCounter counts the unfinished jobs of a group. wait(counter) doesn't block while there's work: the waiting thread
+//   runs jobs itself until the counter drops to zero ("help while waiting"), so waiting inside a job can't deadlock the pool
+// - runAfter(dependency, ...) starts a job only when every job of another counter is done (simple dependencies)
+//
+//     JobCounter decoded;
+//     for (...) JobSystem::get().run([=]() { ...decode image i... }, &decoded);
+//     ...other work...
+//     JobSystem::get().wait(decoded);
+//
+//     JobSystem::get().parallelFor(objects.size(), 1024, [&](size_t begin, size_t end) { ...update objects[begin, end)... });
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+
+// Unfinished jobs of a group + the jobs waiting for the group to finish
+// ------------------------------------------------------------------------
+class JobCounter
+{
+public:
+    JobCounter() {}
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> pending{ 0 };
+    std::mutex continuationMutex;
+    std::vector<Job*> continuations;
+};
+
+struct Job
+{
+    std::function<void()> function;
+    JobCounter* counter; // May be NULL (fire and forget)
+};
+
+
+// Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli 2013, fixed capacity).
+// push/pop: owner thread only, at the bottom. steal: any thread, at the top
+// ------------------------------------------------------------------------
+template <size_t Capacity>
+class ChaseLevDeque
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(Job* job)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= (int64_t)Capacity)
+            return false; // Full: the caller runs the job itself
+        slots[b & (Capacity - 1)].store(job, std::memory_order_release); // Release: a thief that reads the slot sees the whole job
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    Job* pop()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed); // Was empty
+            return NULL;
+        }
+        Job* job = slots[b & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // Last job: race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = NULL;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job* steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return NULL;
+        Job* job = slots[t & (Capacity - 1)].load(std::memory_order_acquire);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return NULL; // Lost to another thief or the owner
+        return job;
+    }
+
+private:
+    // Thieves hammer 'top', the owner 'bottom': keep them on separate cache lines. Padding instead of alignas because
+    // the deques are heap allocated and C++14 new doesn't honor over-alignment
+    std::atomic<int64_t> top{ 0 };
+    char topPadding[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> bottom{ 0 };
+    char bottomPadding[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<Job*> slots[Capacity];
+};
+
+
+class JobSystem
+{
+public:
+    static const size_t DEQUE_CAPACITY = 4096;
+
+    // Shared pool: one worker per core, minus the calling thread (it helps whenever it waits)
+    static JobSystem& get()
+    {
+        static JobSystem instance(defaultWorkerCount());
+        return instance;
+    }
+
+    // Own pool with a fixed number of workers (benchmarks). 0 workers = every job runs on the thread that waits for it
+    explicit JobSystem(unsigned int workerCount)
+    {
+        for (unsigned int i = 0; i < workerCount; i++)
+            deques.push_back(std::unique_ptr<ChaseLevDeque<DEQUE_CAPACITY>>(new ChaseLevDeque<DEQUE_CAPACITY>()));
+        for (unsigned int i = 0; i < workerCount; i++)
+            workers.push_back(std::thread([this, i]() { workerLoop((int)i); }));
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            quit = true;
+        }
+        wakeWorkers.notify_all();
+        for (size_t i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int workerCount() const { return (unsigned int)workers.size(); }
+
+    // Queue a job. 'counter' (optional) is increased now and decreased when the job has run
+    // ------------------------------------------------------------------------
+    void run(std::function<void()> function, JobCounter* counter = NULL)
+    {
+        if (counter)
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        Job* job = new Job;
+        job->function = std::move(function);
+        job->counter = counter;
+        schedule(job);
+    }
+
+    // Queue a job that only starts once every job counted by 'dependency' has finished
+    // ------------------------------------------------------------------------
+    void runAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter = NULL)
+    {
+        if (counter)
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        Job* job = new Job;
+        job->function = std::move(function);
+        job->counter = counter;
+        {
+            std::lock_guard<std::mutex> lock(dependency.continuationMutex);
+            if (!dependency.done())
+            {
+                dependency.continuations.push_back(job);
+                return;
+            }
+        }
+        schedule(job);
+    }
+
+    // Run jobs on this thread until every job of 'counter' is done
+    // ------------------------------------------------------------------------
+    void wait(JobCounter& counter)
+    {
+        int self = workerIndex();
+        unsigned int idleRounds = 0;
+        while (!counter.done())
+        {
+            Job* job = findJob(self);
+            if (job)
+            {
+                execute(job);
+                idleRounds = 0;
+                continue;
+            }
+            // Nothing to take: the last jobs are running elsewhere
+            if (++idleRounds < 64)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        // The last job drops the counter to zero while holding this lock: once we get it, nobody touches the counter
+        // anymore and the caller may destroy it
+        std::lock_guard<std::mutex> lock(counter.continuationMutex);
+    }
+
+    // Split [0, count) into ranges of 'grain' items, run them as jobs and wait (helping). The body runs on several threads at once
+    // ------------------------------------------------------------------------
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+    {
+        if (count == 0)
+            return;
+        grain = std::max<size_t>(grain, 1);
+        if (count <= grain || workers.empty())
+        {
+            body(0, count);
+            return;
+        }
+        JobCounter counter;
+        for (size_t begin = grain; begin < count; begin += grain) // The first range is ours
+        {
+            size_t end = std::min(begin + grain, count);
+            run([&body, begin, end]() { body(begin, end); }, &counter);
+        }
+        body(0, std::min(grain, count));
+        wait(counter);
+    }
+
+private:
+    std::vector<std::unique_ptr<ChaseLevDeque<DEQUE_CAPACITY>>> deques; // One per worker
+    std::vector<std::thread> workers;
+    std::mutex injectionMutex;
+    std::deque<Job*> injectionQueue; // Jobs submitted by threads that aren't workers of this pool
+
+    std::atomic<int> queuedJobs{ 0 }; // Jobs sitting in a queue (not taken yet): workers sleep while it's 0
+    std::mutex sleepMutex;
+    std::condition_variable wakeWorkers;
+    bool quit = false;
+
+    static unsigned int defaultWorkerCount()
+    {
+        unsigned int threads = std::thread::hardware_concurrency();
+        return threads > 1 ? threads - 1 : 0;
+    }
+
+    // Index of the calling thread in this pool, -1 for outside threads
+    int workerIndex() const
+    {
+        return currentPool() == this ? currentWorker() : -1;
+    }
+    static const JobSystem*& currentPool()
+    {
+        static thread_local const JobSystem* pool = NULL;
+        return pool;
+    }
+    static int& currentWorker()
+    {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    void schedule(Job* job)
+    {
+        int self = workerIndex();
+        if (workers.empty())
+        {
+            execute(job); // No workers: jobs run right away on the submitting thread
+            return;
+        }
+        queuedJobs.fetch_add(1, std::memory_order_release);
+        if (self >= 0)
+        {
+            if (!deques[self]->push(job))
+            {
+                queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                execute(job); // Deque full: run it now rather than grow
+                return;
+            }
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(injectionMutex);
+            injectionQueue.push_back(job);
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex); // Pairs with the sleeping worker's check so the wakeup isn't lost
+        }
+        wakeWorkers.notify_one();
+    }
+
+    // Own deque first (newest job, still in cache), then the shared queue, then steal the oldest job of another worker
+    Job* findJob(int self)
+    {
+        Job* job = NULL;
+        if (self >= 0)
+            job = deques[self]->pop();
+        if (!job)
+        {
+            std::lock_guard<std::mutex> lock(injectionMutex);
+            if (!injectionQueue.empty())
+            {
+                job = injectionQueue.front();
+                injectionQueue.pop_front();
+            }
+        }
+        if (!job && !deques.empty()) // No workers (single core machine): nothing to steal, jobs ran inline in schedule()
+        {
+            size_t count = deques.size();
+            size_t start = self >= 0 ? (size_t)self + 1 : (size_t)(std::hash<std::thread::id>()(std::this_thread::get_id()) % count);
+            for (size_t i = 0; i < count && !job; i++)
+            {
+                size_t victim = (start + i) % count;
+                if ((int)victim != self)
+                    job = deques[victim]->steal();
+            }
+        }
+        if (job)
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    void execute(Job* job)
+    {
+        job->function();
+        JobCounter* counter = job->counter;
+        delete job;
+        if (!counter)
+            return;
+
+        std::vector<Job*> ready;
+        {
+            // Under the continuation lock so runAfter can't see the counter at 1 and register too late
+            std::lock_guard<std::mutex> lock(counter->continuationMutex);
+            if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                ready.swap(counter->continuations);
+        }
+        for (size_t i = 0; i < ready.size(); i++)
+            schedule(ready[i]);
+    }
+
+    void workerLoop(int index)
+    {
+        currentPool() = this;
+        currentWorker() = index;
+        while (true)
+        {
+            Job* job = findJob(index);
+            if (job)
+            {
+                execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeWorkers.wait(lock, [this]() { return quit || queuedJobs.load(std::memory_order_acquire) > 0; });
+            if (quit)
+                return;
+        }
+    }
+};
+
+#endif
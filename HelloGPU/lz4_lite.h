@@ -0,0 +1,198 @@
+#ifndef LZ4_LITE_H
+#define LZ4_LITE_H
+
+// Minimal LZ4 *block* format codec (no frame format, no dictionary). Output is compatible with LZ4_decompress_safe()
+// so packs written here can be inspected with the reference library. The compressor is the simple greedy one
+// (one hash probe per position): packing is offline so ratio/speed tuning doesn't matter, decompression is what runs at startup
+
+#include <cstring>
+#include <cstdint>
+
+namespace lz4
+{
+    const int MIN_MATCH = 4;
+    const int LAST_LITERALS = 5;   // The last 5 bytes of a block are always literals
+    const int MF_LIMIT = 12;       // A match can't start in the last 12 bytes of a block
+    const int HASH_LOG = 12;
+    const int MAX_DISTANCE = 65535;
+
+    // Worst case size of compress() output for an input of inputSize bytes
+    // ------------------------------------------------------------------------
+    inline int compressBound(int inputSize)
+    {
+        return inputSize + inputSize / 255 + 16;
+    }
+
+    inline uint32_t read32(const unsigned char* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t hashSequence(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HASH_LOG);
+    }
+
+    inline unsigned char* writeLength(unsigned char* out, int length)
+    {
+        while (length >= 255)
+        {
+            *out++ = 255;
+            length -= 255;
+        }
+        *out++ = (unsigned char)length;
+        return out;
+    }
+
+    // Compress src into dst (dstCapacity should be >= compressBound(srcSize)). Returns the compressed size or 0 on failure
+    // ------------------------------------------------------------------------
+    inline int compress(const unsigned char* src, int srcSize, unsigned char* dst, int dstCapacity)
+    {
+        if (dstCapacity < compressBound(srcSize))
+            return 0;
+
+        unsigned char* out = dst;
+        const unsigned char* anchor = src;
+        const unsigned char* const end = src + srcSize;
+
+        if (srcSize >= MF_LIMIT + 1)
+        {
+            int table[1 << HASH_LOG];
+            for (int i = 0; i < (1 << HASH_LOG); i++)
+                table[i] = -1;
+
+            const unsigned char* const matchLimit = end - LAST_LITERALS;
+            const unsigned char* const searchLimit = end - MF_LIMIT;
+            const unsigned char* ip = src;
+
+            while (ip < searchLimit)
+            {
+                uint32_t sequence = read32(ip);
+                uint32_t hash = hashSequence(sequence);
+                int candidate = table[hash];
+                table[hash] = (int)(ip - src);
+
+                if (candidate < 0 || (ip - src) - candidate > MAX_DISTANCE || read32(src + candidate) != sequence)
+                {
+                    ip++;
+                    continue;
+                }
+
+                // Extend the match forward (never into the trailing literals)
+                const unsigned char* match = src + candidate;
+                const unsigned char* matchEnd = ip + MIN_MATCH;
+                const unsigned char* ref = match + MIN_MATCH;
+                while (matchEnd < matchLimit && *matchEnd == *ref)
+                {
+                    matchEnd++;
+                    ref++;
+                }
+
+                int literalLength = (int)(ip - anchor);
+                int matchLength = (int)(matchEnd - ip) - MIN_MATCH;
+                unsigned char* token = out++;
+                *token = (unsigned char)((literalLength >= 15 ? 15 : literalLength) << 4);
+                if (literalLength >= 15)
+                    out = writeLength(out, literalLength - 15);
+                std::memcpy(out, anchor, literalLength);
+                out += literalLength;
+
+                int offset = (int)(ip - match);
+                *out++ = (unsigned char)(offset & 0xFF);
+                *out++ = (unsigned char)(offset >> 8);
+
+                *token |= (unsigned char)(matchLength >= 15 ? 15 : matchLength);
+                if (matchLength >= 15)
+                    out = writeLength(out, matchLength - 15);
+
+                ip = matchEnd;
+                anchor = ip;
+            }
+        }
+
+        // Last sequence: literals only
+        int literalLength = (int)(end - anchor);
+        unsigned char* token = out++;
+        *token = (unsigned char)((literalLength >= 15 ? 15 : literalLength) << 4);
+        if (literalLength >= 15)
+            out = writeLength(out, literalLength - 15);
+        std::memcpy(out, anchor, literalLength);
+        out += literalLength;
+
+        return (int)(out - dst);
+    }
+
+    // Decompress exactly dstSize bytes. Every read/write is bounds-checked so a corrupt pack can't overrun the buffers.
+    // Returns dstSize on success and -1 on malformed input
+    // ------------------------------------------------------------------------
+    inline int decompress(const unsigned char* src, int srcSize, unsigned char* dst, int dstSize)
+    {
+        const unsigned char* ip = src;
+        const unsigned char* const ipEnd = src + srcSize;
+        unsigned char* op = dst;
+        unsigned char* const opEnd = dst + dstSize;
+
+        while (ip < ipEnd)
+        {
+            unsigned token = *ip++;
+
+            // Literals
+            size_t literalLength = token >> 4;
+            if (literalLength == 15)
+            {
+                unsigned char extra;
+                do
+                {
+                    if (ip >= ipEnd)
+                        return -1;
+                    extra = *ip++;
+                    literalLength += extra;
+                } while (extra == 255);
+            }
+            if (literalLength > (size_t)(ipEnd - ip) || literalLength > (size_t)(opEnd - op))
+                return -1;
+            std::memcpy(op, ip, literalLength);
+            ip += literalLength;
+            op += literalLength;
+
+            if (ip == ipEnd) // The last sequence has no match part
+                break;
+
+            // Match
+            if (ipEnd - ip < 2)
+                return -1;
+            size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+            ip += 2;
+            if (offset == 0 || offset > (size_t)(op - dst))
+                return -1;
+
+            size_t matchLength = token & 15;
+            if (matchLength == 15)
+            {
+                unsigned char extra;
+                do
+                {
+                    if (ip >= ipEnd)
+                        return -1;
+                    extra = *ip++;
+                    matchLength += extra;
+                } while (extra == 255);
+            }
+            matchLength += MIN_MATCH;
+            if (matchLength > (size_t)(opEnd - op))
+                return -1;
+
+            // Byte copy on purpose: matches may overlap their own output (offset < length encodes runs)
+            const unsigned char* ref = op - offset;
+            for (size_t i = 0; i < matchLength; i++)
+                op[i] = ref[i];
+            op += matchLength;
+        }
+
+        return op == opEnd ? dstSize : -1;
+    }
+}
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+// Read-only memory mapped file. The OS pages the file in on demand, so opening an asset costs one open() + one mmap()
+// and no copy into a user buffer. Used by the asset pack (asset_pack.h) and the loose-file fallback of virtual_fs.h
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+
+    // Move-only: the mapping has exactly one owner
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) { takeFrom(other); }
+    MappedFile& operator=(MappedFile&& other)
+    {
+        if (this != &other)
+        {
+            close();
+            takeFrom(other);
+        }
+        return *this;
+    }
+
+    // Map the whole file read-only. Returns false if the file is missing or can't be mapped
+    // ------------------------------------------------------------------------
+    bool open(const std::string& path)
+    {
+        close();
+#ifdef _WIN32
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize))
+        {
+            close();
+            return false;
+        }
+        mappedSize = (size_t)fileSize.QuadPart;
+        isOpen = true;
+        if (mappedSize == 0) // Empty files are valid but can't be mapped
+            return true;
+        mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mappingHandle == NULL)
+        {
+            close();
+            return false;
+        }
+        mappedData = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (mappedData == NULL)
+        {
+            close();
+            return false;
+        }
+#else
+        fileDescriptor = ::open(path.c_str(), O_RDONLY);
+        if (fileDescriptor < 0)
+            return false;
+        struct stat fileStat;
+        if (fstat(fileDescriptor, &fileStat) != 0)
+        {
+            close();
+            return false;
+        }
+        mappedSize = (size_t)fileStat.st_size;
+        isOpen = true;
+        if (mappedSize == 0)
+            return true;
+        void* address = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (address == MAP_FAILED)
+        {
+            close();
+            return false;
+        }
+        mappedData = (const unsigned char*)address;
+#endif
+        return true;
+    }
+
+    // Hint the OS to start paging in a range we are about to read (the pack index, a blob). Useful on network mounts
+    // where every page fault is a round trip
+    // ------------------------------------------------------------------------
+    void willNeed(size_t offset, size_t length) const
+    {
+#ifndef _WIN32
+        if (mappedData == NULL || offset >= mappedSize)
+            return;
+        long pageSize = sysconf(_SC_PAGESIZE);
+        size_t alignedOffset = offset - (offset % (size_t)pageSize);
+        size_t end = length < mappedSize - offset ? offset + length : mappedSize;
+        madvise((void*)(mappedData + alignedOffset), end - alignedOffset, MADV_WILLNEED);
+#else
+        (void)offset;
+        (void)length;
+#endif
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (mappedData != NULL)
+            UnmapViewOfFile(mappedData);
+        if (mappingHandle != NULL)
+            CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE)
+            CloseHandle(fileHandle);
+        mappingHandle = NULL;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (mappedData != NULL)
+            munmap((void*)mappedData, mappedSize);
+        if (fileDescriptor >= 0)
+            ::close(fileDescriptor);
+        fileDescriptor = -1;
+#endif
+        mappedData = NULL;
+        mappedSize = 0;
+        isOpen = false;
+    }
+
+    const unsigned char* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+    bool valid() const { return isOpen; }
+
+private:
+    const unsigned char* mappedData = NULL;
+    size_t mappedSize = 0;
+    bool isOpen = false;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = NULL;
+#else
+    int fileDescriptor = -1;
+#endif
+
+    void takeFrom(MappedFile& other)
+    {
+        mappedData = other.mappedData;
+        mappedSize = other.mappedSize;
+        isOpen = other.isOpen;
+#ifdef _WIN32
+        fileHandle = other.fileHandle;
+        mappingHandle = other.mappingHandle;
+        other.fileHandle = INVALID_HANDLE_VALUE;
+        other.mappingHandle = NULL;
+#else
+        fileDescriptor = other.fileDescriptor;
+        other.fileDescriptor = -1;
+#endif
+        other.mappedData = NULL;
+        other.mappedSize = 0;
+        other.isOpen = false;
+    }
+};
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef MESH_FORMAT_H
+#define MESH_FORMAT_H
+
+// Cooked mesh (.hgmesh): geometry already in the exact bytes the GPU wants, so loading is a map of the file (through the
+// VFS) and one glBufferData per buffer, no text parsing at runtime. Source meshes (OBJ, glTF) are turned into this by
+// Tools/mesh_cooker.cpp
+//
+// Layout:
+//   MeshFileHeader                        (80 bytes)
+//   MeshFileAttribute[attributeCount]     (16 bytes each: where each vertex attribute sits in the interleaved vertex)
+//   MeshFileLod[lodCount]                 (16 bytes each: the index range of each level of detail, finest first)
+//   vertex data                           (vertexCount * vertexStride bytes, interleaved, starts on MESH_DATA_ALIGNMENT)
+//   index data                            (indexCount triangle list indices of indexType, starts on MESH_DATA_ALIGNMENT)
+//
+// The levels of detail share the vertex data: a coarser level is just fewer triangles over a subset of the same vertices
+// (see mesh_simplify.h), so the index data holds every level one after the other
+//
+// All integers are little endian. Type fields hold the GL enum values themselves (GL_FLOAT, GL_UNSIGNED_SHORT ...) so they
+// go straight to glVertexAttribPointer / glDrawElements; this header doesn't need GL so the tools can use it
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const char MESH_MAGIC[4] = { 'H', 'G', 'M', 'S' };
+const uint32_t MESH_VERSION = 2; // 2: LOD table
+const uint32_t MESH_DATA_ALIGNMENT = 16;
+const uint32_t MESH_MAX_ATTRIBUTES = 8;
+const uint32_t MESH_MAX_LODS = 8;
+
+// Component / index types (same values as the GL enums)
+const uint32_t MESH_TYPE_UNSIGNED_BYTE = 0x1401;
+const uint32_t MESH_TYPE_UNSIGNED_SHORT = 0x1403;
+const uint32_t MESH_TYPE_UNSIGNED_INT = 0x1405;
+const uint32_t MESH_TYPE_FLOAT = 0x1406;
+
+// Attribute locations the cooker writes, matching the "layout (location = N)" of our scene shaders.
+// 4..7 are taken by the per-instance world matrix
+const uint32_t MESH_LOCATION_POSITION = 0;
+const uint32_t MESH_LOCATION_COLOR = 1;
+const uint32_t MESH_LOCATION_TEXCOORD0 = 2;
+const uint32_t MESH_LOCATION_TEXCOORD1 = 3;
+const uint32_t MESH_LOCATION_NORMAL = 8;
+
+struct MeshFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t vertexStride;     // Bytes per vertex
+    uint32_t attributeCount;
+    uint32_t indexType;        // MESH_TYPE_UNSIGNED_SHORT or MESH_TYPE_UNSIGNED_INT
+    uint32_t flags;            // None yet
+    uint64_t vertexOffset;     // From the start of the file
+    uint64_t indexOffset;
+    float boundsMin[3];        // Axis aligned box of the positions
+    float boundsMax[3];
+    float boundingRadius;      // Sphere around the mesh origin (what the culling uses at scale 1)
+    uint32_t lodCount;         // 1..MESH_MAX_LODS
+};
+
+struct MeshFileAttribute
+{
+    uint32_t location;         // Shader attribute location
+    uint32_t componentType;    // MESH_TYPE_*
+    uint16_t componentCount;   // 1..4
+    uint16_t normalized;       // Integer types only: 1 = mapped to [0, 1]
+    uint32_t offset;           // Byte offset inside the vertex
+};
+
+struct MeshFileLod
+{
+    uint32_t firstIndex;       // Into the index data
+    uint32_t indexCount;
+    float error;               // How far (mesh units) this level may be from the full mesh's surface; 0 for the full mesh
+    uint32_t reserved;
+};
+
+static_assert(sizeof(MeshFileHeader) == 80, "MeshFileHeader layout is part of the file format");
+static_assert(sizeof(MeshFileAttribute) == 16, "MeshFileAttribute layout is part of the file format");
+static_assert(sizeof(MeshFileLod) == 16, "MeshFileLod layout is part of the file format");
+
+inline uint32_t meshIndexSize(uint32_t indexType) { return indexType == MESH_TYPE_UNSIGNED_SHORT ? 2u : 4u; }
+
+
+// Read side: checks a cooked mesh in memory and points into it (nothing is copied, the bytes must stay alive)
+// ------------------------------------------------------------------------
+struct MeshView
+{
+    MeshFileHeader header = {};
+    const MeshFileAttribute* attributes = NULL;
+    const MeshFileLod* lods = NULL;
+    const unsigned char* vertices = NULL;
+    const unsigned char* indices = NULL;
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+};
+
+inline bool parseMeshFile(const unsigned char* data, size_t size, const std::string& name, MeshView& view)
+{
+    if (data == NULL || size < sizeof(MeshFileHeader))
+    {
+        std::cout << "ERROR::MESH::TRUNCATED_HEADER: " << name << std::endl;
+        return false;
+    }
+    std::memcpy(&view.header, data, sizeof(MeshFileHeader));
+    const MeshFileHeader& header = view.header;
+    if (std::memcmp(header.magic, MESH_MAGIC, 4) != 0 || header.version != MESH_VERSION)
+    {
+        std::cout << "ERROR::MESH::BAD_MAGIC_OR_VERSION: " << name << std::endl;
+        return false;
+    }
+    if (header.attributeCount == 0 || header.attributeCount > MESH_MAX_ATTRIBUTES || header.lodCount == 0 || header.lodCount > MESH_MAX_LODS || header.vertexStride == 0
+        || (header.indexType != MESH_TYPE_UNSIGNED_SHORT && header.indexType != MESH_TYPE_UNSIGNED_INT) || header.indexCount % 3 != 0)
+    {
+        std::cout << "ERROR::MESH::BAD_HEADER: " << name << std::endl;
+        return false;
+    }
+    // 32 bit counts times 32 bit sizes fit 64 bits. Offsets come straight from the file: compare them (and then the bytes)
+    // against what is left, never offset + bytes, which a crafted header can wrap around
+    uint64_t vertexBytes = (uint64_t)header.vertexCount * header.vertexStride;
+    uint64_t indexBytes = (uint64_t)header.indexCount * meshIndexSize(header.indexType);
+    if (sizeof(MeshFileHeader) + header.attributeCount * sizeof(MeshFileAttribute) + header.lodCount * sizeof(MeshFileLod) > size
+        || header.vertexOffset > size || vertexBytes > size - header.vertexOffset || header.indexOffset > size || indexBytes > size - header.indexOffset)
+    {
+        std::cout << "ERROR::MESH::TRUNCATED_DATA: " << name << std::endl;
+        return false;
+    }
+    view.vertexBytes = (size_t)vertexBytes;
+    view.indexBytes = (size_t)indexBytes;
+    view.attributes = (const MeshFileAttribute*)(data + sizeof(MeshFileHeader));
+    for (uint32_t a = 0; a < header.attributeCount; a++)
+    {
+        const MeshFileAttribute& attribute = view.attributes[a];
+        uint32_t componentSize = attribute.componentType == MESH_TYPE_UNSIGNED_BYTE ? 1u : attribute.componentType == MESH_TYPE_UNSIGNED_SHORT ? 2u : 4u;
+        if (attribute.componentCount < 1 || attribute.componentCount > 4 || (uint64_t)attribute.offset + attribute.componentCount * componentSize > header.vertexStride)
+        {
+            std::cout << "ERROR::MESH::BAD_ATTRIBUTE: " << name << " (location " << attribute.location << ")" << std::endl;
+            return false;
+        }
+    }
+    view.lods = (const MeshFileLod*)(data + sizeof(MeshFileHeader) + header.attributeCount * sizeof(MeshFileAttribute));
+    for (uint32_t l = 0; l < header.lodCount; l++)
+    {
+        const MeshFileLod& lod = view.lods[l];
+        if (lod.indexCount == 0 || lod.indexCount % 3 != 0 || (uint64_t)lod.firstIndex + lod.indexCount > header.indexCount)
+        {
+            std::cout << "ERROR::MESH::BAD_LOD: " << name << " (level " << l << ")" << std::endl;
+            return false;
+        }
+    }
+    view.vertices = data + header.vertexOffset;
+    view.indices = data + header.indexOffset;
+    return true;
+}
+
+
+// Write side: used by the offline cooker (Tools/mesh_cooker.cpp). The attribute at MESH_LOCATION_POSITION must be 3 floats
+// (bounds are computed from it). Indices are stored as 16 bit whenever the vertex count allows it. 'lods' index into
+// 'indices'; empty means one level: all of them
+// ------------------------------------------------------------------------
+inline bool writeMeshFile(const std::string& path, const std::vector<MeshFileAttribute>& attributes, uint32_t vertexStride,
+    const std::vector<unsigned char>& vertexData, const std::vector<uint32_t>& indices, std::vector<MeshFileLod> lods = std::vector<MeshFileLod>())
+{
+    if (lods.empty())
+    {
+        MeshFileLod all = { 0, (uint32_t)indices.size(), 0.0f, 0 };
+        lods.push_back(all);
+    }
+    const MeshFileAttribute* position = NULL;
+    for (size_t a = 0; a < attributes.size(); a++)
+        if (attributes[a].location == MESH_LOCATION_POSITION && attributes[a].componentType == MESH_TYPE_FLOAT && attributes[a].componentCount == 3)
+            position = &attributes[a];
+    bool lodsValid = lods.size() <= MESH_MAX_LODS;
+    for (size_t l = 0; l < lods.size(); l++)
+        lodsValid = lodsValid && lods[l].indexCount > 0 && lods[l].indexCount % 3 == 0 && (uint64_t)lods[l].firstIndex + lods[l].indexCount <= indices.size();
+    if (position == NULL || attributes.size() > MESH_MAX_ATTRIBUTES || !lodsValid || vertexStride == 0 || vertexData.size() % vertexStride != 0 || indices.size() % 3 != 0)
+    {
+        std::cout << "ERROR::MESH::BAD_COOK_INPUT: " << path << std::endl;
+        return false;
+    }
+
+    MeshFileHeader header = {};
+    std::memcpy(header.magic, MESH_MAGIC, 4);
+    header.version = MESH_VERSION;
+    header.vertexCount = (uint32_t)(vertexData.size() / vertexStride);
+    header.indexCount = (uint32_t)indices.size();
+    header.vertexStride = vertexStride;
+    header.attributeCount = (uint32_t)attributes.size();
+    header.lodCount = (uint32_t)lods.size();
+    header.indexType = header.vertexCount <= 65536 ? MESH_TYPE_UNSIGNED_SHORT : MESH_TYPE_UNSIGNED_INT;
+
+    for (int c = 0; c < 3; c++)
+    {
+        header.boundsMin[c] = header.vertexCount ? 1e30f : 0.0f;
+        header.boundsMax[c] = header.vertexCount ? -1e30f : 0.0f;
+    }
+    float radiusSquared = 0.0f;
+    for (uint32_t v = 0; v < header.vertexCount; v++)
+    {
+        float p[3];
+        std::memcpy(p, vertexData.data() + (size_t)v * vertexStride + position->offset, sizeof(p));
+        for (int c = 0; c < 3; c++)
+        {
+            header.boundsMin[c] = p[c] < header.boundsMin[c] ? p[c] : header.boundsMin[c];
+            header.boundsMax[c] = p[c] > header.boundsMax[c] ? p[c] : header.boundsMax[c];
+        }
+        float d = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+        radiusSquared = d > radiusSquared ? d : radiusSquared;
+    }
+    header.boundingRadius = std::sqrt(radiusSquared);
+
+    auto align = [](uint64_t offset) { return (offset + MESH_DATA_ALIGNMENT - 1) & ~(uint64_t)(MESH_DATA_ALIGNMENT - 1); };
+    header.vertexOffset = align(sizeof(MeshFileHeader) + attributes.size() * sizeof(MeshFileAttribute) + lods.size() * sizeof(MeshFileLod));
+    header.indexOffset = align(header.vertexOffset + vertexData.size());
+
+    std::vector<unsigned char> indexData(indices.size() * meshIndexSize(header.indexType));
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        if (header.indexType == MESH_TYPE_UNSIGNED_SHORT)
+        {
+            uint16_t index = (uint16_t)indices[i];
+            std::memcpy(indexData.data() + i * 2, &index, 2);
+        }
+        else
+            std::memcpy(indexData.data() + i * 4, &indices[i], 4);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR::MESH::CANNOT_CREATE: " << path << std::endl;
+        return false;
+    }
+    const char padding[MESH_DATA_ALIGNMENT] = {};
+    uint64_t written = 0;
+    auto writeBytes = [&](const void* bytes, size_t count)
+    {
+        file.write((const char*)bytes, (std::streamsize)count);
+        written += count;
+    };
+    writeBytes(&header, sizeof(header));
+    if (!attributes.empty())
+        writeBytes(attributes.data(), attributes.size() * sizeof(MeshFileAttribute));
+    writeBytes(lods.data(), lods.size() * sizeof(MeshFileLod));
+    writeBytes(padding, (size_t)(header.vertexOffset - written));
+    if (!vertexData.empty())
+        writeBytes(vertexData.data(), vertexData.size());
+    writeBytes(padding, (size_t)(header.indexOffset - written));
+    if (!indexData.empty())
+        writeBytes(indexData.data(), indexData.size());
+    if (!file)
+    {
+        std::cout << "ERROR::MESH::WRITE_FAILED: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif
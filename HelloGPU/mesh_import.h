@@ -0,0 +1,1023 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+// Source mesh importers used by the offline cooker (Tools/mesh_cooker.cpp), never at runtime: Wavefront OBJ and glTF 2.0
+// (.gltf with .bin files or base64 data URIs, or binary .glb). Both read straight from the mapped file: numbers are parsed
+// in place (no iostreams, no per-line strings, no locale lookups like strtod), the glTF JSON goes into one flat node array,
+// and the only growing allocations are the output arrays themselves
+//
+// What is kept: positions, normals, two texture coordinate sets, vertex colors (rgb) and a triangle list. glTF node
+// transforms of the default scene are baked into the vertices. Texture coordinates follow the GL convention (v = 0 at the
+// bottom of the image, which is how our textures are uploaded): glTF's v is flipped on import, OBJ's already matches
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "simd_math.h"
+
+struct ImportedMesh
+{
+    std::vector<float> positions;   // xyz per vertex
+    std::vector<float> normals;     // xyz per vertex, or empty
+    std::vector<float> texcoords0;  // uv per vertex, or empty
+    std::vector<float> texcoords1;  // uv per vertex, or empty
+    std::vector<float> colors;      // rgb per vertex, or empty
+    std::vector<uint32_t> indices;  // Triangle list
+
+    size_t vertexCount() const { return positions.size() / 3; }
+};
+
+namespace mesh_import_detail
+{
+    inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    inline const char* skipSpaces(const char* p, const char* end)
+    {
+        while (p < end && isSpace(*p))
+            p++;
+        return p;
+    }
+
+    inline const char* skipLine(const char* p, const char* end)
+    {
+        while (p < end && *p != '\n')
+            p++;
+        return p < end ? p + 1 : end;
+    }
+
+    // Decimal float: [sign] digits [. digits] [e [sign] digits]. Returns p unchanged if there is no number
+    inline const char* parseFloat(const char* p, const char* end, float& out)
+    {
+        static const double powersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16,
+            1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        const char* start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        uint64_t mantissa = 0;
+        int exponent = 0, digits = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+        {
+            if (mantissa < 1000000000000000000ull)
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            else
+                exponent++; // Digits beyond what the mantissa holds only scale it
+        }
+        if (p < end && *p == '.')
+        {
+            for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+            {
+                if (mantissa < 1000000000000000000ull)
+                {
+                    mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                    exponent--;
+                }
+            }
+        }
+        if (digits == 0)
+            return start;
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char* exponentStart = p++;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+'))
+                negativeExponent = *p++ == '-';
+            int value = 0;
+            const char* exponentDigits = p;
+            for (; p < end && *p >= '0' && *p <= '9'; p++)
+                value = value < 10000 ? value * 10 + (*p - '0') : value;
+            if (p == exponentDigits)
+                p = exponentStart; // "1e" is the number 1 followed by garbage
+            else
+                exponent += negativeExponent ? -value : value;
+        }
+        double result = (double)mantissa;
+        if (exponent >= -22 && exponent <= 22)
+            result = exponent < 0 ? result / powersOf10[-exponent] : result * powersOf10[exponent];
+        else
+            result *= std::pow(10.0, (double)exponent);
+        out = (float)(negative ? -result : result);
+        return p;
+    }
+
+    inline const char* parseInt(const char* p, const char* end, int& out)
+    {
+        const char* start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        const char* digits = p;
+        long long value = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            value = value < 0x7FFFFFFF ? value * 10 + (*p - '0') : value;
+        if (p == digits)
+            return start;
+        out = (int)(negative ? -value : value);
+        return p;
+    }
+
+    // Open addressing map from an OBJ corner (position / texcoord / normal indices) to the output vertex
+    class CornerMap
+    {
+    public:
+        uint32_t findOrAdd(int position, int texcoord, int normal, uint32_t newIndex, bool& added)
+        {
+            if ((count + 1) * 2 > slots.size())
+                grow();
+            size_t mask = slots.size() - 1;
+            size_t i = hash(position, texcoord, normal) & mask;
+            while (true)
+            {
+                Slot& slot = slots[i];
+                if (slot.vertex == EMPTY)
+                {
+                    slot.position = position;
+                    slot.texcoord = texcoord;
+                    slot.normal = normal;
+                    slot.vertex = newIndex;
+                    count++;
+                    added = true;
+                    return newIndex;
+                }
+                if (slot.position == position && slot.texcoord == texcoord && slot.normal == normal)
+                {
+                    added = false;
+                    return slot.vertex;
+                }
+                i = (i + 1) & mask;
+            }
+        }
+
+    private:
+        static const uint32_t EMPTY = 0xFFFFFFFFu;
+        struct Slot
+        {
+            int position, texcoord, normal;
+            uint32_t vertex;
+        };
+        std::vector<Slot> slots;
+        size_t count = 0;
+
+        static size_t hash(int a, int b, int c)
+        {
+            uint64_t h = (uint64_t)(uint32_t)a * 0x9E3779B97F4A7C15ull;
+            h ^= (uint64_t)(uint32_t)b * 0xC2B2AE3D27D4EB4Full + (h >> 29);
+            h ^= (uint64_t)(uint32_t)c * 0x165667B19E3779F9ull + (h >> 31);
+            return (size_t)(h ^ (h >> 32));
+        }
+
+        void grow()
+        {
+            std::vector<Slot> old;
+            old.swap(slots);
+            Slot empty = { 0, 0, 0, EMPTY };
+            slots.assign(old.empty() ? 1024 : old.size() * 2, empty);
+            count = 0;
+            for (size_t i = 0; i < old.size(); i++)
+            {
+                if (old[i].vertex == EMPTY)
+                    continue;
+                bool added;
+                findOrAdd(old[i].position, old[i].texcoord, old[i].normal, old[i].vertex, added);
+            }
+        }
+    };
+}
+
+
+// Wavefront OBJ: v (with optional r g b after x y z), vt, vn and f (any polygon, fan triangulated, negative indices
+// allowed). Corners sharing the same v/vt/vn triple become one vertex. Everything else (o, g, s, usemtl ...) is skipped
+// ------------------------------------------------------------------------
+inline bool importObj(const unsigned char* data, size_t size, const std::string& name, ImportedMesh& mesh)
+{
+    using namespace mesh_import_detail;
+    const char* p = (const char*)data;
+    const char* end = p + size;
+
+    std::vector<float> positions, colors, texcoords, normals;
+    bool hasColors = false, usesTexcoords = false, usesNormals = false;
+    CornerMap corners;
+    std::vector<uint32_t> polygon;
+    struct Corner { int position, texcoord, normal; };
+    std::vector<Corner> usedCorners; // Per output vertex, to fill the attributes once all of v / vt / vn are known
+    size_t lineNumber = 0;
+
+    while (p < end)
+    {
+        lineNumber++;
+        p = skipSpaces(p, end);
+        if (p + 1 < end && p[0] == 'v' && isSpace(p[1]))
+        {
+            float v[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+            int count = 0;
+            p += 1;
+            while (count < 6)
+            {
+                const char* next = parseFloat(skipSpaces(p, end), end, v[count]);
+                if (next == skipSpaces(p, end))
+                    break;
+                p = next;
+                count++;
+            }
+            if (count < 3)
+            {
+                std::cout << "ERROR::MESH_IMPORT::OBJ_BAD_VERTEX: " << name << " line " << lineNumber << std::endl;
+                return false;
+            }
+            positions.insert(positions.end(), v, v + 3);
+            colors.insert(colors.end(), v + 3, v + 6);
+            hasColors = hasColors || count == 6;
+        }
+        else if (p + 2 < end && p[0] == 'v' && p[1] == 't' && isSpace(p[2]))
+        {
+            float uv[2] = { 0.0f, 0.0f };
+            p += 2;
+            for (int c = 0; c < 2; c++)
+                p = parseFloat(skipSpaces(p, end), end, uv[c]);
+            texcoords.insert(texcoords.end(), uv, uv + 2);
+        }
+        else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+        {
+            float n[3] = { 0.0f, 0.0f, 0.0f };
+            p += 2;
+            for (int c = 0; c < 3; c++)
+                p = parseFloat(skipSpaces(p, end), end, n[c]);
+            normals.insert(normals.end(), n, n + 3);
+        }
+        else if (p + 1 < end && p[0] == 'f' && isSpace(p[1]))
+        {
+            p += 1;
+            polygon.clear();
+            while (true)
+            {
+                p = skipSpaces(p, end);
+                if (p >= end || *p == '\n' || *p == '#')
+                    break;
+                // v, v/vt, v//vn or v/vt/vn; OBJ indices start at 1, negative ones count back from the last element
+                int indices[3] = { 0, 0, 0 };
+                const char* next = parseInt(p, end, indices[0]);
+                if (next == p)
+                {
+                    std::cout << "ERROR::MESH_IMPORT::OBJ_BAD_FACE: " << name << " line " << lineNumber << std::endl;
+                    return false;
+                }
+                p = next;
+                for (int k = 1; k < 3 && p < end && *p == '/'; k++)
+                    p = parseInt(p + 1, end, indices[k]);
+                const size_t counts[3] = { positions.size() / 3, texcoords.size() / 2, normals.size() / 3 };
+                for (int k = 0; k < 3; k++)
+                {
+                    if (indices[k] < 0)
+                        indices[k] += (int)counts[k] + 1;
+                    if ((k == 0 && indices[k] == 0) || indices[k] < 0 || indices[k] > (int)counts[k])
+                    {
+                        std::cout << "ERROR::MESH_IMPORT::OBJ_INDEX_OUT_OF_RANGE: " << name << " line " << lineNumber << std::endl;
+                        return false;
+                    }
+                }
+                usesTexcoords = usesTexcoords || indices[1] != 0;
+                usesNormals = usesNormals || indices[2] != 0;
+                bool added;
+                uint32_t vertex = corners.findOrAdd(indices[0], indices[1], indices[2], (uint32_t)usedCorners.size(), added);
+                if (added)
+                {
+                    Corner corner = { indices[0] - 1, indices[1] - 1, indices[2] - 1 };
+                    usedCorners.push_back(corner);
+                }
+                polygon.push_back(vertex);
+            }
+            for (size_t i = 2; i < polygon.size(); i++)
+            {
+                mesh.indices.push_back(polygon[0]);
+                mesh.indices.push_back(polygon[i - 1]);
+                mesh.indices.push_back(polygon[i]);
+            }
+        }
+        p = skipLine(p, end);
+    }
+
+    size_t vertexCount = usedCorners.size();
+    mesh.positions.resize(vertexCount * 3);
+    if (hasColors)
+        mesh.colors.resize(vertexCount * 3);
+    if (usesTexcoords)
+        mesh.texcoords0.assign(vertexCount * 2, 0.0f);
+    if (usesNormals)
+        mesh.normals.assign(vertexCount * 3, 0.0f);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        const Corner& corner = usedCorners[v];
+        std::memcpy(&mesh.positions[v * 3], &positions[corner.position * 3], 3 * sizeof(float));
+        if (hasColors)
+            std::memcpy(&mesh.colors[v * 3], &colors[corner.position * 3], 3 * sizeof(float));
+        if (usesTexcoords && corner.texcoord >= 0)
+            std::memcpy(&mesh.texcoords0[v * 2], &texcoords[corner.texcoord * 2], 2 * sizeof(float));
+        if (usesNormals && corner.normal >= 0)
+            std::memcpy(&mesh.normals[v * 3], &normals[corner.normal * 3], 3 * sizeof(float));
+    }
+    return true;
+}
+
+
+// Minimal JSON reader for glTF: the whole document becomes one array of nodes that point into the source text
+// (strings are not unescaped: glTF keys and the URIs we need don't use escapes)
+// ------------------------------------------------------------------------
+class JsonDocument
+{
+public:
+    enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+    bool parse(const char* text, size_t size)
+    {
+        source = text;
+        cursor = text;
+        sourceEnd = text + size;
+        nodes.clear();
+        nodes.reserve(size / 8 + 16);
+        return parseValue(0) >= 0 && (skipWhitespace(), cursor == sourceEnd);
+    }
+
+    static const int ROOT = 0;
+
+    Type type(int node) const { return node < 0 ? JSON_NULL : nodes[node].type; }
+
+    // Member of an object by key, -1 if missing
+    int member(int node, const char* key) const
+    {
+        if (type(node) != JSON_OBJECT)
+            return -1;
+        size_t keyLength = std::strlen(key);
+        for (int child = nodes[node].firstChild; child >= 0; child = nodes[child].nextSibling)
+            if (nodes[child].keyLength == keyLength && std::memcmp(source + nodes[child].keyBegin, key, keyLength) == 0)
+                return child;
+        return -1;
+    }
+
+    // Element of an array, -1 if out of range
+    int element(int node, size_t index) const
+    {
+        if (type(node) != JSON_ARRAY)
+            return -1;
+        int child = nodes[node].firstChild;
+        for (size_t i = 0; i < index && child >= 0; i++)
+            child = nodes[child].nextSibling;
+        return child;
+    }
+
+    size_t count(int node) const
+    {
+        if (type(node) != JSON_ARRAY && type(node) != JSON_OBJECT)
+            return 0;
+        size_t result = 0;
+        for (int child = nodes[node].firstChild; child >= 0; child = nodes[child].nextSibling)
+            result++;
+        return result;
+    }
+
+    double number(int node, double fallback) const { return type(node) == JSON_NUMBER ? nodes[node].number : fallback; }
+    int integer(int node, int fallback) const
+    {
+        if (type(node) != JSON_NUMBER || !(nodes[node].number >= -2147483648.0 && nodes[node].number <= 2147483647.0))
+            return fallback; // Out of range (or NaN) doesn't convert
+        return (int)nodes[node].number;
+    }
+    // A count / byte offset / stride: false unless it's a whole, non-negative number that fits a size_t. Missing = 'fallback'
+    bool size(int node, size_t fallback, size_t& out) const
+    {
+        if (node < 0)
+        {
+            out = fallback;
+            return true;
+        }
+        double value = number(node, -1.0);
+        if (!(value >= 0.0) || value != std::floor(value) || value >= 9007199254740992.0 || value > (double)SIZE_MAX) // 2^53: doubles skip integers above
+            return false;
+        out = (size_t)value;
+        return true;
+    }
+    std::string string(int node) const { return type(node) == JSON_STRING ? std::string(source + nodes[node].textBegin, nodes[node].textLength) : std::string(); }
+    int firstChild(int node) const { return node < 0 ? -1 : nodes[node].firstChild; }
+    int nextSibling(int node) const { return node < 0 ? -1 : nodes[node].nextSibling; }
+    std::string key(int node) const { return std::string(source + nodes[node].keyBegin, nodes[node].keyLength); }
+
+    size_t errorOffset() const { return (size_t)(cursor - source); }
+
+private:
+    struct Node
+    {
+        Type type;
+        double number;
+        uint32_t textBegin, textLength; // String contents
+        uint32_t keyBegin, keyLength;   // Key when the node is an object member
+        int firstChild, nextSibling;    // -1 = none
+    };
+    std::vector<Node> nodes;
+    const char* source = NULL;
+    const char* cursor = NULL;
+    const char* sourceEnd = NULL;
+
+    void skipWhitespace()
+    {
+        while (cursor < sourceEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+            cursor++;
+    }
+
+    bool parseString(uint32_t& begin, uint32_t& length)
+    {
+        if (cursor >= sourceEnd || *cursor != '"')
+            return false;
+        const char* start = ++cursor;
+        while (cursor < sourceEnd && *cursor != '"')
+            cursor += (*cursor == '\\' && cursor + 1 < sourceEnd) ? 2 : 1;
+        if (cursor >= sourceEnd)
+            return false;
+        begin = (uint32_t)(start - source);
+        length = (uint32_t)(cursor - start);
+        cursor++;
+        return true;
+    }
+
+    bool matchWord(const char* word)
+    {
+        size_t length = std::strlen(word);
+        if ((size_t)(sourceEnd - cursor) < length || std::memcmp(cursor, word, length) != 0)
+            return false;
+        cursor += length;
+        return true;
+    }
+
+    // Returns the new node, or -1 on a syntax error (cursor left at the error)
+    int parseValue(int depth)
+    {
+        if (depth > 64)
+            return -1;
+        skipWhitespace();
+        if (cursor >= sourceEnd)
+            return -1;
+        int index = (int)nodes.size();
+        Node node = { JSON_NULL, 0.0, 0, 0, 0, 0, -1, -1 };
+        nodes.push_back(node);
+        char c = *cursor;
+        if (c == '{' || c == '[')
+        {
+            bool isObject = c == '{';
+            nodes[index].type = isObject ? JSON_OBJECT : JSON_ARRAY;
+            cursor++;
+            skipWhitespace();
+            int previous = -1;
+            if (cursor < sourceEnd && *cursor == (isObject ? '}' : ']'))
+            {
+                cursor++;
+                return index;
+            }
+            while (true)
+            {
+                uint32_t keyBegin = 0, keyLength = 0;
+                if (isObject)
+                {
+                    skipWhitespace();
+                    if (!parseString(keyBegin, keyLength))
+                        return -1;
+                    skipWhitespace();
+                    if (cursor >= sourceEnd || *cursor != ':')
+                        return -1;
+                    cursor++;
+                }
+                int child = parseValue(depth + 1);
+                if (child < 0)
+                    return -1;
+                nodes[child].keyBegin = keyBegin;
+                nodes[child].keyLength = keyLength;
+                if (previous < 0)
+                    nodes[index].firstChild = child;
+                else
+                    nodes[previous].nextSibling = child;
+                previous = child;
+                skipWhitespace();
+                if (cursor < sourceEnd && *cursor == ',')
+                {
+                    cursor++;
+                    continue;
+                }
+                if (cursor < sourceEnd && *cursor == (isObject ? '}' : ']'))
+                {
+                    cursor++;
+                    return index;
+                }
+                return -1;
+            }
+        }
+        if (c == '"')
+        {
+            nodes[index].type = JSON_STRING;
+            uint32_t begin, length;
+            if (!parseString(begin, length))
+                return -1;
+            nodes[index].textBegin = begin;
+            nodes[index].textLength = length;
+            return index;
+        }
+        if (matchWord("true"))
+        {
+            nodes[index].type = JSON_BOOL;
+            nodes[index].number = 1.0;
+            return index;
+        }
+        if (matchWord("false"))
+        {
+            nodes[index].type = JSON_BOOL;
+            return index;
+        }
+        if (matchWord("null"))
+            return index;
+        float value;
+        const char* next = mesh_import_detail::parseFloat(cursor, sourceEnd, value);
+        if (next == cursor)
+            return -1;
+        // Integers (indices, byte offsets, enums) have to stay exact: parseFloat's float would round them above 2^24
+        int integer = 0;
+        const char* integerEnd = mesh_import_detail::parseInt(cursor, sourceEnd, integer);
+        nodes[index].type = JSON_NUMBER;
+        nodes[index].number = integerEnd == next ? (double)integer : (double)value;
+        cursor = next;
+        return index;
+    }
+};
+
+
+namespace mesh_import_detail
+{
+    inline bool decodeBase64(const char* text, size_t length, std::vector<unsigned char>& out)
+    {
+        out.clear();
+        out.reserve(length / 4 * 3);
+        uint32_t bits = 0;
+        int bitCount = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            char c = text[i];
+            int value;
+            if (c >= 'A' && c <= 'Z') value = c - 'A';
+            else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') value = c - '0' + 52;
+            else if (c == '+' || c == '-') value = 62;
+            else if (c == '/' || c == '_') value = 63;
+            else if (c == '=') break;
+            else return false;
+            bits = (bits << 6) | (uint32_t)value;
+            bitCount += 6;
+            if (bitCount >= 8)
+            {
+                bitCount -= 8;
+                out.push_back((unsigned char)((bits >> bitCount) & 0xFF));
+            }
+        }
+        return true;
+    }
+
+    inline bool readFileBytes(const std::string& path, std::vector<unsigned char>& bytes)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+        std::streamsize size = file.tellg();
+        file.seekg(0, std::ios::beg);
+        bytes.resize((size_t)size);
+        return size == 0 || (bool)file.read((char*)bytes.data(), size);
+    }
+
+    struct GltfBuffer
+    {
+        const unsigned char* data = NULL;
+        size_t size = 0;
+        std::vector<unsigned char> owned;
+    };
+
+    struct GltfContext
+    {
+        const JsonDocument* json;
+        std::vector<GltfBuffer> buffers;
+        std::string name;
+    };
+
+    inline int componentCountOf(const std::string& type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0;
+    }
+
+    inline int componentSizeOf(int componentType)
+    {
+        switch (componentType)
+        {
+        case 5120: case 5121: return 1; // BYTE, UNSIGNED_BYTE
+        case 5122: case 5123: return 2; // SHORT, UNSIGNED_SHORT
+        case 5125: case 5126: return 4; // UNSIGNED_INT, FLOAT
+        default: return 0;
+        }
+    }
+
+    // Locate the bytes of an accessor: first element, stride, element count, component type / count
+    struct AccessorView
+    {
+        const unsigned char* data = NULL;
+        size_t stride = 0;
+        size_t count = 0;
+        int componentType = 0;
+        int components = 0;
+        bool normalized = false;
+    };
+
+    inline bool viewAccessor(const GltfContext& context, int accessorIndex, AccessorView& view)
+    {
+        const JsonDocument& json = *context.json;
+        int accessor = json.element(json.member(JsonDocument::ROOT, "accessors"), (size_t)accessorIndex);
+        if (accessor < 0 || json.member(accessor, "sparse") >= 0)
+        {
+            std::cout << "ERROR::MESH_IMPORT::GLTF_UNSUPPORTED_ACCESSOR: " << context.name << " (accessor " << accessorIndex << ")" << std::endl;
+            return false;
+        }
+        view.componentType = json.integer(json.member(accessor, "componentType"), 0);
+        view.components = componentCountOf(json.string(json.member(accessor, "type")));
+        view.normalized = json.type(json.member(accessor, "normalized")) == JsonDocument::JSON_BOOL && json.number(json.member(accessor, "normalized"), 0.0) != 0.0;
+        int elementSize = componentSizeOf(view.componentType) * view.components;
+        int bufferViewIndex = json.integer(json.member(accessor, "bufferView"), -1);
+        int bufferView = json.element(json.member(JsonDocument::ROOT, "bufferViews"), (size_t)bufferViewIndex);
+        size_t viewOffset = 0, accessorOffset = 0;
+        if (elementSize == 0 || bufferView < 0 || !json.size(json.member(accessor, "count"), 0, view.count)
+            || !json.size(json.member(bufferView, "byteOffset"), 0, viewOffset) || !json.size(json.member(accessor, "byteOffset"), 0, accessorOffset)
+            || !json.size(json.member(bufferView, "byteStride"), (size_t)elementSize, view.stride) || view.stride < (size_t)elementSize)
+        {
+            std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_ACCESSOR: " << context.name << " (accessor " << accessorIndex << ")" << std::endl;
+            return false;
+        }
+        // Every step compares against what is left of the buffer, so a crafted count or offset can't wrap around
+        size_t bufferIndex = (size_t)json.integer(json.member(bufferView, "buffer"), -1);
+        size_t bufferSize = bufferIndex < context.buffers.size() ? context.buffers[bufferIndex].size : 0;
+        size_t offset = viewOffset + accessorOffset;
+        if (bufferIndex >= context.buffers.size() || viewOffset > bufferSize || accessorOffset > bufferSize - viewOffset
+            || (view.count > 0 && ((size_t)elementSize > bufferSize - offset || view.count - 1 > (bufferSize - offset - elementSize) / view.stride)))
+        {
+            std::cout << "ERROR::MESH_IMPORT::GLTF_ACCESSOR_OUT_OF_BOUNDS: " << context.name << " (accessor " << accessorIndex << ")" << std::endl;
+            return false;
+        }
+        view.data = context.buffers[bufferIndex].data + offset;
+        return true;
+    }
+
+    inline float readComponent(const unsigned char* p, int componentType, bool normalized)
+    {
+        switch (componentType)
+        {
+        case 5126: { float v; std::memcpy(&v, p, 4); return v; }
+        case 5121: return normalized ? (float)p[0] / 255.0f : (float)p[0];
+        case 5123: { uint16_t v; std::memcpy(&v, p, 2); return normalized ? (float)v / 65535.0f : (float)v; }
+        case 5120: { int8_t v = (int8_t)p[0]; return normalized ? std::fmax((float)v / 127.0f, -1.0f) : (float)v; }
+        case 5122: { int16_t v; std::memcpy(&v, p, 2); return normalized ? std::fmax((float)v / 32767.0f, -1.0f) : (float)v; }
+        case 5125: { uint32_t v; std::memcpy(&v, p, 4); return (float)v; }
+        default: return 0.0f;
+        }
+    }
+
+    // Read 'components' floats per element (extra source components are dropped, missing ones filled with 'fill')
+    inline bool readFloats(const GltfContext& context, int accessorIndex, int components, float fill, std::vector<float>& out, size_t& count)
+    {
+        AccessorView view;
+        if (!viewAccessor(context, accessorIndex, view))
+            return false;
+        int componentSize = componentSizeOf(view.componentType);
+        count = view.count;
+        size_t base = out.size();
+        out.resize(base + view.count * components, fill);
+        for (size_t i = 0; i < view.count; i++)
+        {
+            const unsigned char* element = view.data + i * view.stride;
+            for (int c = 0; c < components && c < view.components; c++)
+                out[base + i * components + c] = readComponent(element + c * componentSize, view.componentType, view.normalized);
+        }
+        return true;
+    }
+
+    inline bool readIndices(const GltfContext& context, int accessorIndex, uint32_t firstVertex, size_t vertexCount, std::vector<uint32_t>& out)
+    {
+        AccessorView view;
+        if (!viewAccessor(context, accessorIndex, view))
+            return false;
+        if (view.components != 1 || (view.componentType != 5121 && view.componentType != 5123 && view.componentType != 5125))
+        {
+            std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_INDICES: " << context.name << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < view.count; i++)
+        {
+            uint32_t index = (uint32_t)readComponent(view.data + i * view.stride, view.componentType, false);
+            if (index >= vertexCount)
+            {
+                std::cout << "ERROR::MESH_IMPORT::GLTF_INDEX_OUT_OF_RANGE: " << context.name << std::endl;
+                return false;
+            }
+            out.push_back(firstVertex + index);
+        }
+        return true;
+    }
+
+    // A stream that some primitives have and others don't: pad with 'fill' so it stays in step with the positions
+    inline void padStream(std::vector<float>& stream, bool primitiveHasIt, size_t verticesBefore, size_t verticesAfter, int components, float fill)
+    {
+        if (!primitiveHasIt && stream.empty())
+            return;
+        if (primitiveHasIt && stream.size() < verticesBefore * components)
+        {
+            // First primitive with this stream: fill in everything before it
+            std::vector<float> padded(verticesBefore * components, fill);
+            padded.insert(padded.end(), stream.begin(), stream.end());
+            stream.swap(padded);
+        }
+        stream.resize(verticesAfter * components, fill);
+    }
+
+    inline Mat4 nodeLocalMatrix(const JsonDocument& json, int node)
+    {
+        int matrix = json.member(node, "matrix");
+        if (json.count(matrix) == 16)
+        {
+            Mat4 result;
+            for (int i = 0; i < 16; i++)
+                result.m[i] = (float)json.number(json.element(matrix, (size_t)i), 0.0); // glTF matrices are column major too
+            return result;
+        }
+        int t = json.member(node, "translation"), r = json.member(node, "rotation"), s = json.member(node, "scale");
+        Vec3 translation = vec3((float)json.number(json.element(t, 0), 0.0), (float)json.number(json.element(t, 1), 0.0), (float)json.number(json.element(t, 2), 0.0));
+        Quat rotation = { (float)json.number(json.element(r, 0), 0.0), (float)json.number(json.element(r, 1), 0.0), (float)json.number(json.element(r, 2), 0.0), (float)json.number(json.element(r, 3), 1.0) };
+        Vec3 scale = vec3((float)json.number(json.element(s, 0), 1.0), (float)json.number(json.element(s, 1), 1.0), (float)json.number(json.element(s, 2), 1.0));
+        return mat4FromTRS(translation, rotation, scale);
+    }
+
+    inline bool importGltfMesh(const GltfContext& context, int meshIndex, const Mat4& world, ImportedMesh& mesh)
+    {
+        const JsonDocument& json = *context.json;
+        int meshNode = json.element(json.member(JsonDocument::ROOT, "meshes"), (size_t)meshIndex);
+        if (meshNode < 0)
+        {
+            std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_MESH: " << context.name << " (mesh " << meshIndex << ")" << std::endl;
+            return false;
+        }
+        int primitives = json.member(meshNode, "primitives");
+        for (int primitive = json.firstChild(primitives); primitive >= 0; primitive = json.nextSibling(primitive))
+        {
+            if (json.integer(json.member(primitive, "mode"), 4) != 4)
+            {
+                std::cout << "MeshImport: skipping a non triangle-list primitive of mesh " << meshIndex << " in " << context.name << std::endl;
+                continue;
+            }
+            int attributes = json.member(primitive, "attributes");
+            int position = json.member(attributes, "POSITION");
+            if (position < 0)
+                continue;
+            size_t firstVertex = mesh.vertexCount();
+            size_t count = 0;
+            if (!readFloats(context, json.integer(position, -1), 3, 0.0f, mesh.positions, count))
+                return false;
+            for (size_t v = firstVertex; v < firstVertex + count; v++)
+            {
+                Vec3 p = transformPoint(world, vec3(mesh.positions[v * 3], mesh.positions[v * 3 + 1], mesh.positions[v * 3 + 2]));
+                mesh.positions[v * 3] = p.x;
+                mesh.positions[v * 3 + 1] = p.y;
+                mesh.positions[v * 3 + 2] = p.z;
+            }
+
+            // Optional streams, read at the end of their arrays then padded so every array covers the same vertices
+            struct Stream { const char* semantic; std::vector<float>* out; int components; float fill; };
+            Stream streams[4] = {
+                { "NORMAL", &mesh.normals, 3, 0.0f },
+                { "TEXCOORD_0", &mesh.texcoords0, 2, 0.0f },
+                { "TEXCOORD_1", &mesh.texcoords1, 2, 0.0f },
+                { "COLOR_0", &mesh.colors, 3, 1.0f }
+            };
+            for (int s = 0; s < 4; s++)
+            {
+                int accessor = json.member(attributes, streams[s].semantic);
+                std::vector<float>& out = *streams[s].out;
+                padStream(out, accessor >= 0, firstVertex, firstVertex, streams[s].components, streams[s].fill);
+                size_t streamCount = 0;
+                if (accessor >= 0 && (!readFloats(context, json.integer(accessor, -1), streams[s].components, streams[s].fill, out, streamCount) || streamCount != count))
+                {
+                    std::cout << "ERROR::MESH_IMPORT::GLTF_ATTRIBUTE_COUNT_MISMATCH: " << context.name << " (" << streams[s].semantic << ")" << std::endl;
+                    return false;
+                }
+                padStream(out, accessor >= 0, firstVertex, firstVertex + count, streams[s].components, streams[s].fill);
+            }
+            for (size_t v = firstVertex; v < firstVertex + count && !mesh.normals.empty(); v++)
+            {
+                // Upper 3x3 of the node matrix then renormalize: right for rotations and uniform scales
+                Vec4 n = world * Vec4{ mesh.normals[v * 3], mesh.normals[v * 3 + 1], mesh.normals[v * 3 + 2], 0.0f };
+                Vec3 normal = normalize(vec3(n.x, n.y, n.z));
+                mesh.normals[v * 3] = normal.x;
+                mesh.normals[v * 3 + 1] = normal.y;
+                mesh.normals[v * 3 + 2] = normal.z;
+            }
+            for (size_t v = firstVertex; v < firstVertex + count; v++) // glTF UVs start at the top of the image, ours at the bottom
+            {
+                if (!mesh.texcoords0.empty())
+                    mesh.texcoords0[v * 2 + 1] = 1.0f - mesh.texcoords0[v * 2 + 1];
+                if (!mesh.texcoords1.empty())
+                    mesh.texcoords1[v * 2 + 1] = 1.0f - mesh.texcoords1[v * 2 + 1];
+            }
+
+            int indices = json.member(primitive, "indices");
+            size_t firstIndex = mesh.indices.size();
+            if (indices >= 0)
+            {
+                if (!readIndices(context, json.integer(indices, -1), (uint32_t)firstVertex, count, mesh.indices))
+                    return false;
+                mesh.indices.resize(firstIndex + (mesh.indices.size() - firstIndex) / 3 * 3);
+            }
+            else
+            {
+                for (size_t v = 0; v + 2 < count; v += 3)
+                    for (int k = 0; k < 3; k++)
+                        mesh.indices.push_back((uint32_t)(firstVertex + v + k));
+            }
+            // A negative determinant (mirroring node) flips the winding: swap two corners to keep triangles front facing
+            float determinant = world.m[0] * (world.m[5] * world.m[10] - world.m[9] * world.m[6]) - world.m[4] * (world.m[1] * world.m[10] - world.m[9] * world.m[2])
+                + world.m[8] * (world.m[1] * world.m[6] - world.m[5] * world.m[2]);
+            if (determinant < 0.0f)
+                for (size_t i = firstIndex; i + 2 < mesh.indices.size(); i += 3)
+                    std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+        }
+        return true;
+    }
+
+    inline bool importGltfNode(const GltfContext& context, int nodeIndex, const Mat4& parentWorld, int depth, ImportedMesh& mesh)
+    {
+        const JsonDocument& json = *context.json;
+        int node = json.element(json.member(JsonDocument::ROOT, "nodes"), (size_t)nodeIndex);
+        if (node < 0 || depth > 64)
+        {
+            std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_NODE: " << context.name << " (node " << nodeIndex << ")" << std::endl;
+            return false;
+        }
+        Mat4 world = parentWorld * nodeLocalMatrix(json, node);
+        int meshIndex = json.integer(json.member(node, "mesh"), -1);
+        if (meshIndex >= 0 && !importGltfMesh(context, meshIndex, world, mesh))
+            return false;
+        int children = json.member(node, "children");
+        for (int child = json.firstChild(children); child >= 0; child = json.nextSibling(child))
+            if (!importGltfNode(context, json.integer(child, -1), world, depth + 1, mesh))
+                return false;
+        return true;
+    }
+}
+
+
+// glTF 2.0 (.gltf or .glb). 'path' locates external .bin files. Draco / meshopt compressed files are refused
+// ------------------------------------------------------------------------
+inline bool importGltf(const unsigned char* data, size_t size, const std::string& path, ImportedMesh& mesh)
+{
+    using namespace mesh_import_detail;
+    const char* jsonText = (const char*)data;
+    size_t jsonSize = size;
+    const unsigned char* binChunk = NULL;
+    size_t binSize = 0;
+
+    // GLB: 12 byte header ("glTF", version, length) then chunks (length, type, bytes): JSON first, optional BIN second
+    if (size >= 12 && std::memcmp(data, "glTF", 4) == 0)
+    {
+        uint32_t chunkLength = 0, chunkType = 0;
+        if (size >= 20)
+        {
+            std::memcpy(&chunkLength, data + 12, 4);
+            std::memcpy(&chunkType, data + 16, 4);
+        }
+        if (size < 20 || chunkType != 0x4E4F534A || (size_t)chunkLength > size - 20)
+        {
+            std::cout << "ERROR::MESH_IMPORT::GLB_BAD_JSON_CHUNK: " << path << std::endl;
+            return false;
+        }
+        jsonText = (const char*)data + 20;
+        jsonSize = chunkLength;
+        size_t binHeader = 20 + (size_t)chunkLength;
+        if (binHeader + 8 <= size)
+        {
+            std::memcpy(&chunkLength, data + binHeader, 4);
+            std::memcpy(&chunkType, data + binHeader + 4, 4);
+            if (chunkType == 0x004E4942 && (size_t)chunkLength <= size - binHeader - 8)
+            {
+                binChunk = data + binHeader + 8;
+                binSize = chunkLength;
+            }
+        }
+    }
+
+    JsonDocument json;
+    if (!json.parse(jsonText, jsonSize))
+    {
+        std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_JSON: " << path << " (at byte " << json.errorOffset() << ")" << std::endl;
+        return false;
+    }
+    if (json.count(json.member(JsonDocument::ROOT, "extensionsRequired")) > 0)
+    {
+        std::cout << "ERROR::MESH_IMPORT::GLTF_REQUIRED_EXTENSION: " << path << std::endl;
+        return false;
+    }
+
+    GltfContext context;
+    context.json = &json;
+    context.name = path;
+    std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+    int buffers = json.member(JsonDocument::ROOT, "buffers");
+    for (int buffer = json.firstChild(buffers); buffer >= 0; buffer = json.nextSibling(buffer))
+    {
+        context.buffers.push_back(GltfBuffer());
+        GltfBuffer& bytes = context.buffers.back();
+        std::string uri = json.string(json.member(buffer, "uri"));
+        if (uri.empty())
+        {
+            bytes.data = binChunk; // The GLB's own BIN chunk
+            bytes.size = binSize;
+        }
+        else if (uri.compare(0, 5, "data:") == 0)
+        {
+            size_t comma = uri.find(',');
+            if (comma == std::string::npos || uri.find(";base64") > comma || !decodeBase64(uri.data() + comma + 1, uri.size() - comma - 1, bytes.owned))
+            {
+                std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_DATA_URI: " << path << std::endl;
+                return false;
+            }
+        }
+        else if (!readFileBytes(directory + uri, bytes.owned))
+        {
+            std::cout << "ERROR::MESH_IMPORT::GLTF_BUFFER_NOT_FOUND: " << directory + uri << std::endl;
+            return false;
+        }
+        if (!bytes.owned.empty())
+        {
+            bytes.data = bytes.owned.data();
+            bytes.size = bytes.owned.size();
+        }
+    }
+
+    // Default scene (or the first), walked from its roots. Files without scenes: every mesh as is
+    int scenes = json.member(JsonDocument::ROOT, "scenes");
+    int scene = json.element(scenes, (size_t)json.integer(json.member(JsonDocument::ROOT, "scene"), 0));
+    if (scene >= 0)
+    {
+        int roots = json.member(scene, "nodes");
+        for (int root = json.firstChild(roots); root >= 0; root = json.nextSibling(root))
+            if (!importGltfNode(context, json.integer(root, -1), mat4Identity(), 0, mesh))
+                return false;
+    }
+    else
+    {
+        size_t meshCount = json.count(json.member(JsonDocument::ROOT, "meshes"));
+        for (size_t m = 0; m < meshCount; m++)
+            if (!importGltfMesh(context, (int)m, mat4Identity(), mesh))
+                return false;
+    }
+    return true;
+}
+
+
+// By extension: .obj, .gltf or .glb
+// ------------------------------------------------------------------------
+inline bool importMesh(const std::string& path, ImportedMesh& mesh)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        std::cout << "ERROR::MESH_IMPORT::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    for (size_t i = 0; i < extension.size(); i++)
+        extension[i] = (char)std::tolower((unsigned char)extension[i]);
+    bool imported;
+    if (extension == "obj")
+        imported = importObj(file.data(), file.size(), path, mesh);
+    else if (extension == "gltf" || extension == "glb")
+        imported = importGltf(file.data(), file.size(), path, mesh);
+    else
+    {
+        std::cout << "ERROR::MESH_IMPORT::UNKNOWN_FORMAT: " << path << std::endl;
+        return false;
+    }
+    if (imported && mesh.indices.empty())
+    {
+        std::cout << "ERROR::MESH_IMPORT::NO_TRIANGLES: " << path << std::endl;
+        return false;
+    }
+    return imported;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+// Level of detail selection for cooked meshes (their LOD chains come from Tools/mesh_cooker.cpp, see mesh_simplify.h).
+//
+// Every level stores how far it may be from the full mesh, in mesh units. How many pixels that is depends on the projected
+// size of the instance: error * (instance scale) * (pixels per world unit where the instance is). The coarsest level whose
+// error stays under a pixel budget is drawn, so a far away / small instance gets few triangles and a close one all of them.
+//
+// Hysteresis: an instance only moves to a coarser level once that level is comfortably under the budget, and only goes back
+// to a finer one once its current level is clearly over it. In between it keeps what it had, so an instance sitting right
+// at a threshold (or a camera shaking a little) doesn't pop back and forth every frame
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+#include "simd_math.h"
+
+// One level of a loaded mesh (filled by uploadMesh in mesh_master.h): an index range of its element buffer
+struct MeshLod
+{
+    GLsizei indexCount = 0;
+    uintptr_t indexOffset = 0;  // Bytes into the element buffer, for glDrawElements
+    float error = 0.0f;         // About how far (mesh units) from the full mesh's surface (0 for level 0)
+};
+
+// Pixels one world unit covers at a point, for a viewport 'viewportHeight' pixels tall. From the projection alone: the y
+// scale of the projection over the clip w of the point (its view depth for a perspective camera, 1 for an orthographic one)
+// ------------------------------------------------------------------------
+inline float pixelsPerWorldUnit(const Mat4& projection, const Mat4& viewProjection, float x, float y, float z, float viewportHeight)
+{
+    float w = viewProjection.m[3] * x + viewProjection.m[7] * y + viewProjection.m[11] * z + viewProjection.m[15];
+    if (w < 1e-4f)
+        w = 1e-4f; // At or behind the eye: as close as it gets
+    return projection.m[5] * 0.5f * viewportHeight / w;
+}
+
+// Pick the level to draw. 'lods' are the mesh's levels, finest (0) first; 'pixelsPerMeshUnit' is pixelsPerWorldUnit times
+// the instance's scale; 'current' is the level drawn last frame. 'pixelError' is the budget, 'hysteresis' the fraction of
+// it either side where nothing changes (0.25: coarser only under 0.75 x budget, finer only over 1.25 x budget)
+// ------------------------------------------------------------------------
+inline uint32_t selectLod(const MeshLod* lods, uint32_t lodCount, float pixelsPerMeshUnit, uint32_t current, float pixelError, float hysteresis)
+{
+    if (lodCount <= 1)
+        return 0;
+    if (current >= lodCount)
+        current = lodCount - 1;
+
+    // Too coarse: the coarsest that fits the budget, there's no waiting when detail is missing
+    if (lods[current].error * pixelsPerMeshUnit > pixelError * (1.0f + hysteresis))
+    {
+        uint32_t lod = current;
+        while (lod > 0 && lods[lod].error * pixelsPerMeshUnit > pixelError)
+            lod--;
+        return lod;
+    }
+    // Maybe coarser, only with room to spare
+    uint32_t lod = current;
+    while (lod + 1 < lodCount && lods[lod + 1].error * pixelsPerMeshUnit <= pixelError * (1.0f - hysteresis))
+        lod++;
+    return lod;
+}
+
+#endif
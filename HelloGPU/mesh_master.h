@@ -0,0 +1,190 @@
+#ifndef MESH_MASTER_H
+#define MESH_MASTER_H
+
+// Loads cooked meshes (.hgmesh, see mesh_format.h) through the VFS and puts them on the GPU: the vertex and index bytes
+// are handed to glBufferData straight from the mapping, and the VAO is set up from the attribute table of the header.
+// Every level of detail sits in the same buffers, a level is just an index range (see mesh_lod.h to pick one).
+// Meshes of at least MESHLET_MIN_TRIANGLES triangles also get their full level cut into meshlets at load, for drawing
+// only the clusters that face the camera and are on screen (meshlet.h, drawMeshlets below)
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <iostream>
+
+#include "mesh_format.h"
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "virtual_fs.h" // Meshes are read through the VFS so they can come from an asset pack
+
+const uint32_t MESHLET_MIN_TRIANGLES = 4096; // Smaller meshes cost less to draw whole than to cull
+
+struct GpuMesh
+{
+    GLuint vertexArray = 0;
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    GLsizei vertexCount = 0;
+    float boundingRadius = 0.0f; // Around the mesh origin
+    float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+    float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+    float meshUnitsPerTexcoord = 0.0f; // How much of the mesh one texture repeat covers, on average (0: no texcoords). For mip streaming
+    MeshLod lods[MESH_MAX_LODS];
+    uint32_t lodCount = 0;
+
+    // Kept to build more VAOs over the same buffers (createMeshVertexArray)
+    MeshFileAttribute attributes[MESH_MAX_ATTRIBUTES];
+    uint32_t attributeCount = 0;
+    GLsizei vertexStride = 0;
+
+    MeshletSet meshlets; // Of level 0; empty for small meshes
+};
+
+// A new VAO reading the mesh's buffers, for when different draws of one mesh need different extra attributes (e.g. one
+// instance buffer per level of detail). Leaves it bound so those can be added; the caller owns it
+// ------------------------------------------------------------------------
+inline GLuint createMeshVertexArray(const GpuMesh& mesh)
+{
+    GLuint vertexArray;
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer); // Recorded in the VAO
+    for (uint32_t a = 0; a < mesh.attributeCount; a++)
+    {
+        const MeshFileAttribute& attribute = mesh.attributes[a];
+        glVertexAttribPointer(attribute.location, attribute.componentCount, attribute.componentType, attribute.normalized ? GL_TRUE : GL_FALSE,
+            mesh.vertexStride, (void*)(uintptr_t)attribute.offset);
+        glEnableVertexAttribArray(attribute.location);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return vertexArray;
+}
+
+// Upload a parsed mesh. Leaves the VAO unbound
+// ------------------------------------------------------------------------
+inline void uploadMesh(const MeshView& view, GpuMesh& mesh)
+{
+    glGenBuffers(1, &mesh.vertexBuffer);
+    glGenBuffers(1, &mesh.indexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)view.vertexBytes, view.vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    mesh.attributeCount = view.header.attributeCount;
+    mesh.vertexStride = (GLsizei)view.header.vertexStride;
+    for (uint32_t a = 0; a < view.header.attributeCount; a++)
+        mesh.attributes[a] = view.attributes[a];
+
+    // The VAO records the attribute setup and the element buffer bound while it is bound
+    mesh.vertexArray = createMeshVertexArray(mesh);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)view.indexBytes, view.indices, GL_STATIC_DRAW);
+
+    // Unbind the VAO first: unbinding the EBO while it is bound would remove the EBO from it
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    mesh.lodCount = view.header.lodCount;
+    for (uint32_t l = 0; l < view.header.lodCount; l++)
+    {
+        mesh.lods[l].indexCount = (GLsizei)view.lods[l].indexCount;
+        mesh.lods[l].indexOffset = (uintptr_t)view.lods[l].firstIndex * meshIndexSize(view.header.indexType);
+        mesh.lods[l].error = view.lods[l].error;
+    }
+    mesh.indexCount = mesh.lods[0].indexCount; // The full mesh
+
+    // The full level's indices, for what is measured on the triangles
+    std::vector<uint32_t> indices(mesh.indexCount);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        if (view.header.indexType == MESH_TYPE_UNSIGNED_SHORT)
+        {
+            uint16_t index;
+            std::memcpy(&index, view.indices + i * 2, 2);
+            indices[i] = index;
+        }
+        else
+            std::memcpy(&indices[i], view.indices + i * 4, 4);
+    }
+    const MeshFileAttribute* position = NULL;
+    const MeshFileAttribute* texcoord = NULL;
+    for (uint32_t a = 0; a < mesh.attributeCount; a++)
+    {
+        if (mesh.attributes[a].location == MESH_LOCATION_POSITION)
+            position = &mesh.attributes[a];
+        if (mesh.attributes[a].location == MESH_LOCATION_TEXCOORD0 && mesh.attributes[a].componentType == MESH_TYPE_FLOAT && mesh.attributes[a].componentCount == 2)
+            texcoord = &mesh.attributes[a];
+    }
+
+    // Texcoord density: sqrt(surface area / texcoord area), so the mesh's on screen size tells how many texels a draw can use
+    if (position && texcoord)
+    {
+        double surfaceArea = 0.0, texcoordArea = 0.0;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            float p[3][3], uv[3][2];
+            for (int k = 0; k < 3; k++)
+            {
+                const unsigned char* vertex = view.vertices + (size_t)indices[t + k] * view.header.vertexStride;
+                std::memcpy(p[k], vertex + position->offset, sizeof(p[k]));
+                std::memcpy(uv[k], vertex + texcoord->offset, sizeof(uv[k]));
+            }
+            float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+            float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            surfaceArea += 0.5 * std::sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+            texcoordArea += 0.5 * std::fabs((double)(uv[1][0] - uv[0][0]) * (uv[2][1] - uv[0][1]) - (double)(uv[2][0] - uv[0][0]) * (uv[1][1] - uv[0][1]));
+        }
+        if (texcoordArea > 0.0)
+            mesh.meshUnitsPerTexcoord = (float)std::sqrt(surfaceArea / texcoordArea);
+    }
+
+    if ((uint32_t)mesh.indexCount / 3 >= MESHLET_MIN_TRIANGLES && position)
+        mesh.meshlets.build(indices.data(), indices.size(), view.vertices, view.header.vertexCount, view.header.vertexStride, position->offset);
+    mesh.indexType = view.header.indexType;
+    mesh.vertexCount = (GLsizei)view.header.vertexCount;
+    mesh.boundingRadius = view.header.boundingRadius;
+    for (int c = 0; c < 3; c++)
+    {
+        mesh.boundsMin[c] = view.header.boundsMin[c];
+        mesh.boundsMax[c] = view.header.boundsMax[c];
+    }
+}
+
+// Map + upload a cooked mesh. Returns false (and prints why) if it is missing or broken
+// ------------------------------------------------------------------------
+inline bool loadMesh(const char* path, GpuMesh& mesh)
+{
+    AssetBlob blob = VirtualFS::get().open(path);
+    if (!blob.valid())
+    {
+        std::cout << "ERROR::MESH::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+    MeshView view;
+    if (!parseMeshFile(blob.data(), blob.size(), path, view))
+        return false;
+    uploadMesh(view, mesh);
+    return true; // The blob (mapping) goes away here: GL has its own copy
+}
+
+// Draw what MeshletSet::cull() left of the full level (one glMultiDrawElements, GL 3.3 has no indirect draws). The mesh's VAO
+// (or one from createMeshVertexArray) must be bound
+// ------------------------------------------------------------------------
+inline void drawMeshlets(const GpuMesh& mesh, const MeshletDrawList& list)
+{
+    if (!list.counts.empty())
+        glMultiDrawElements(GL_TRIANGLES, list.counts.data(), mesh.indexType, list.offsets.data(), (GLsizei)list.counts.size());
+}
+
+inline void releaseMesh(GpuMesh& mesh)
+{
+    glDeleteVertexArrays(1, &mesh.vertexArray);
+    glDeleteBuffers(1, &mesh.vertexBuffer);
+    glDeleteBuffers(1, &mesh.indexBuffer);
+    mesh = GpuMesh();
+}
+
+#endif
@@ -0,0 +1,452 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+// Index / vertex order optimization for the mesh cooker (Tools/mesh_cooker.cpp). The exporter's triangle order is
+// usually bad for the GPU; the stages below, run in this order, fix it without changing what is drawn:
+//
+//   1. remapDuplicateVertices   byte-identical vertices become one (exporters often split vertices for nothing)
+//   2. optimizeVertexCache      Tipsify (Sander, Nehab, Barczak 2007): triangles ordered so that the post-transform vertex
+//                               cache hits as much as possible (fewer vertex shader runs)
+//   3. optimizeOverdraw         the Tipsify output cut into clusters, the clusters sorted so that outward facing ones on
+//                               the outside of the mesh are drawn first (early depth test rejects more of what comes after)
+//   4. optimizeVertexFetch      vertices reordered by first use, so the vertex buffer is read front to back
+//
+// analyze*() give the numbers the cooker reports:
+//   ACMR       average cache miss ratio: vertex shader runs per triangle (0.5 is the ideal for big regular meshes, 3 the worst)
+//   ATVR       average transformed vertex ratio: vertex shader runs per vertex (1 is the ideal)
+//   overdraw   fragments shaded / pixels covered over 6 axis views, back faces culled (1 is the ideal)
+//   overfetch  bytes read from the vertex buffer / its size (1 is the ideal)
+//
+// All of it works on plain arrays: 32-bit triangle list indices and interleaved vertex bytes, no GL
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+const unsigned int MESH_VERTEX_CACHE_SIZE = 16; // FIFO post-transform cache we optimize for and simulate
+
+struct VertexCacheStats
+{
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+namespace mesh_optimizer_detail
+{
+    // Vertex -> triangles that use it (counting sort into one array)
+    struct Adjacency
+    {
+        std::vector<uint32_t> offsets; // vertexCount + 1
+        std::vector<uint32_t> triangles;
+
+        void build(const std::vector<uint32_t>& indices, size_t vertexCount)
+        {
+            offsets.assign(vertexCount + 1, 0);
+            for (size_t i = 0; i < indices.size(); i++)
+                offsets[indices[i] + 1]++;
+            for (size_t v = 0; v < vertexCount; v++)
+                offsets[v + 1] += offsets[v];
+            triangles.resize(indices.size());
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+                triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+    };
+
+    // FIFO cache simulation: number of misses for a range of triangles, starting from an empty cache
+    inline size_t countCacheMisses(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize, std::vector<uint32_t>& timestamps)
+    {
+        timestamps.assign(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+        size_t misses = 0;
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            uint32_t v = indices[i];
+            if (time - timestamps[v] > cacheSize)
+            {
+                timestamps[v] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+    inline float readFloat(const unsigned char* p)
+    {
+        float value;
+        std::memcpy(&value, p, sizeof(float));
+        return value;
+    }
+}
+
+
+// Stats
+// ------------------------------------------------------------------------
+inline VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize = MESH_VERTEX_CACHE_SIZE)
+{
+    VertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0)
+        return stats;
+    std::vector<uint32_t> timestamps;
+    size_t misses = mesh_optimizer_detail::countCacheMisses(indices.data(), indices.size(), vertexCount, cacheSize, timestamps);
+    stats.acmr = (float)misses / (float)(indices.size() / 3);
+    stats.atvr = (float)misses / (float)vertexCount;
+    return stats;
+}
+
+// Vertex buffer bytes read through 64-byte lines and a small direct mapped cache, over the buffer size
+inline float analyzeVertexFetch(const std::vector<uint32_t>& indices, size_t vertexCount, size_t vertexStride)
+{
+    const size_t lineSize = 64, cacheLines = 256; // 16KB
+    if (indices.empty() || vertexCount == 0)
+        return 0.0f;
+    std::vector<size_t> cache(cacheLines, (size_t)-1);
+    size_t fetched = 0;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        size_t first = indices[i] * vertexStride / lineSize, last = (indices[i] * vertexStride + vertexStride - 1) / lineSize;
+        for (size_t line = first; line <= last; line++)
+        {
+            if (cache[line % cacheLines] != line)
+            {
+                cache[line % cacheLines] = line;
+                fetched += lineSize;
+            }
+        }
+    }
+    return (float)fetched / (float)(vertexCount * vertexStride);
+}
+
+// Rasterize the mesh from the 6 axis directions into a small depth buffer and count the fragments that pass the depth
+// test against the pixels covered: what an early-z GPU would shade. Back faces (clockwise) are culled, as for any closed mesh
+inline float analyzeOverdraw(const std::vector<uint32_t>& indices, const unsigned char* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset)
+{
+    using mesh_optimizer_detail::readFloat;
+    const int size = 256;
+    if (indices.empty() || vertexCount == 0)
+        return 0.0f;
+    float minimum[3] = { 1e30f, 1e30f, 1e30f }, maximum[3] = { -1e30f, -1e30f, -1e30f };
+    for (size_t v = 0; v < vertexCount; v++)
+        for (int c = 0; c < 3; c++)
+        {
+            float value = readFloat(vertices + v * vertexStride + positionOffset + c * 4);
+            minimum[c] = std::min(minimum[c], value);
+            maximum[c] = std::max(maximum[c], value);
+        }
+    float extent = std::max(std::max(maximum[0] - minimum[0], maximum[1] - minimum[1]), std::max(maximum[2] - minimum[2], 1e-20f));
+
+    std::vector<float> depth(size * size);
+    size_t shaded = 0, covered = 0;
+    for (int view = 0; view < 6; view++)
+    {
+        // Looking down axis view / 2, from its positive or negative side: screen x, y are the other two axes
+        int axis = view / 2, u = (axis + 1) % 3, w = (axis + 2) % 3;
+        float direction = (view & 1) ? -1.0f : 1.0f;
+        std::fill(depth.begin(), depth.end(), 1e30f);
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            float x[3], y[3], z[3];
+            for (int k = 0; k < 3; k++)
+            {
+                const unsigned char* p = vertices + indices[t + k] * vertexStride + positionOffset;
+                x[k] = (readFloat(p + u * 4) - minimum[u]) / extent * (size - 1);
+                y[k] = (readFloat(p + w * 4) - minimum[w]) / extent * (size - 1);
+                z[k] = (readFloat(p + axis * 4) - minimum[axis]) * direction;
+            }
+            // Back faces are culled: the viewer is on the -direction side, so counter-clockwise triangles face it when the
+            // screen area has the opposite sign of 'direction'
+            float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+            if (area * direction >= 0.0f)
+                continue;
+            int minX = std::max(0, (int)std::floor(std::min(x[0], std::min(x[1], x[2])))), maxX = std::min(size - 1, (int)std::ceil(std::max(x[0], std::max(x[1], x[2]))));
+            int minY = std::max(0, (int)std::floor(std::min(y[0], std::min(y[1], y[2])))), maxY = std::min(size - 1, (int)std::ceil(std::max(y[0], std::max(y[1], y[2]))));
+            for (int py = minY; py <= maxY; py++)
+            {
+                for (int px = minX; px <= maxX; px++)
+                {
+                    float cx = (float)px + 0.5f, cy = (float)py + 0.5f;
+                    float w0 = ((x[1] - cx) * (y[2] - cy) - (x[2] - cx) * (y[1] - cy)) / area;
+                    float w1 = ((x[2] - cx) * (y[0] - cy) - (x[0] - cx) * (y[2] - cy)) / area;
+                    float w2 = 1.0f - w0 - w1;
+                    if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                        continue;
+                    float fragmentDepth = w0 * z[0] + w1 * z[1] + w2 * z[2];
+                    float& stored = depth[py * size + px];
+                    if (fragmentDepth < stored)
+                    {
+                        if (stored == 1e30f)
+                            covered++;
+                        stored = fragmentDepth;
+                        shaded++;
+                    }
+                }
+            }
+        }
+    }
+    return covered ? (float)shaded / (float)covered : 0.0f;
+}
+
+
+// 1. Merge byte-identical vertices. Compacts 'vertices' in place and rewrites 'indices'. Returns the new vertex count
+// ------------------------------------------------------------------------
+inline size_t remapDuplicateVertices(std::vector<unsigned char>& vertices, size_t vertexStride, std::vector<uint32_t>& indices)
+{
+    size_t vertexCount = vertices.size() / vertexStride;
+    size_t tableSize = 1;
+    while (tableSize < vertexCount * 2)
+        tableSize *= 2;
+    const uint32_t EMPTY = 0xFFFFFFFFu;
+    std::vector<uint32_t> table(tableSize, EMPTY); // Holds new vertex indices
+    std::vector<uint32_t> remap(vertexCount);
+    size_t unique = 0;
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        const unsigned char* vertex = vertices.data() + v * vertexStride;
+        uint64_t hash = 14695981039346656037ull; // FNV-1a 64 over the vertex bytes
+        for (size_t b = 0; b < vertexStride; b++)
+        {
+            hash ^= vertex[b];
+            hash *= 1099511628211ull;
+        }
+        size_t slot = (size_t)(hash ^ (hash >> 32)) & (tableSize - 1);
+        while (table[slot] != EMPTY && std::memcmp(vertices.data() + table[slot] * vertexStride, vertex, vertexStride) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+        if (table[slot] == EMPTY)
+        {
+            // New vertex: move it down to its compacted place (never overwrites one not yet read, unique <= v)
+            if (unique != v)
+                std::memmove(vertices.data() + unique * vertexStride, vertex, vertexStride);
+            table[slot] = (uint32_t)unique++;
+        }
+        remap[v] = table[slot];
+    }
+    vertices.resize(unique * vertexStride);
+    for (size_t i = 0; i < indices.size(); i++)
+        indices[i] = remap[indices[i]];
+    return unique;
+}
+
+
+// 2. Tipsify: fan around a vertex, emit all its remaining triangles, then continue with the vertex that is still in the
+// cache with the most remaining use. When nothing good is in the cache, jump (dead end); those jumps are where the cache
+// is effectively flushed, and their triangle positions go to 'hardBoundaries' (for optimizeOverdraw)
+// ------------------------------------------------------------------------
+inline void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize = MESH_VERTEX_CACHE_SIZE,
+    std::vector<uint32_t>* hardBoundaries = NULL)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+    mesh_optimizer_detail::Adjacency adjacency;
+    adjacency.build(indices, vertexCount);
+
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnds; // Recently used vertices, tried before scanning for any vertex with triangles left
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    if (hardBoundaries)
+        hardBoundaries->assign(1, 0);
+
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+    int64_t fanning = indices[0];
+    while (fanning >= 0)
+    {
+        candidates.clear();
+        for (uint32_t a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++)
+        {
+            uint32_t triangle = adjacency.triangles[a];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = 1;
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (time - timestamps[v] > cacheSize)
+                    timestamps[v] = time++;
+            }
+        }
+
+        // Best candidate still in the cache: the one that stays in it longest while its remaining triangles are emitted
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for (size_t c = 0; c < candidates.size(); c++)
+        {
+            uint32_t v = candidates[c];
+            if (liveTriangles[v] == 0)
+                continue;
+            int64_t priority = 0;
+            if ((int64_t)time - timestamps[v] + 2 * (int64_t)liveTriangles[v] <= (int64_t)cacheSize)
+                priority = (int64_t)time - timestamps[v];
+            if (priority > bestPriority)
+            {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+        if (best < 0)
+        {
+            // Dead end: most recent vertex that still has triangles, else the next one in input order
+            while (!deadEnds.empty() && best < 0)
+            {
+                uint32_t v = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[v] > 0)
+                    best = v;
+            }
+            while (best < 0 && cursor < vertexCount)
+            {
+                if (liveTriangles[cursor] > 0)
+                    best = (int64_t)cursor;
+                cursor++;
+            }
+            if (best >= 0 && hardBoundaries && result.size() / 3 < triangleCount)
+                hardBoundaries->push_back((uint32_t)(result.size() / 3));
+        }
+        fanning = best;
+    }
+    indices.swap(result);
+}
+
+
+// 3. Overdraw: cut the (cache optimized) triangle list into clusters - at the hard boundaries, and inside them wherever the
+// cluster so far has a cache miss ratio within 'threshold' of the whole cluster's (so the cut costs little ACMR) - then
+// draw the clusters facing away from the mesh center first. 'threshold' 1.05 allows ~5% worse ACMR
+// ------------------------------------------------------------------------
+inline void optimizeOverdraw(std::vector<uint32_t>& indices, const unsigned char* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+    const std::vector<uint32_t>& hardBoundaries, float threshold = 1.05f, unsigned int cacheSize = MESH_VERTEX_CACHE_SIZE)
+{
+    using mesh_optimizer_detail::readFloat;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Soft boundaries
+    std::vector<uint32_t> clusters; // First triangle of each cluster
+    std::vector<uint32_t> timestamps;
+    for (size_t h = 0; h < hardBoundaries.size(); h++)
+    {
+        size_t begin = hardBoundaries[h], end = h + 1 < hardBoundaries.size() ? hardBoundaries[h + 1] : triangleCount;
+        if (begin >= end)
+            continue;
+        size_t wholeMisses = mesh_optimizer_detail::countCacheMisses(indices.data() + begin * 3, (end - begin) * 3, vertexCount, cacheSize, timestamps);
+        float target = (float)wholeMisses / (float)(end - begin) * threshold;
+
+        clusters.push_back((uint32_t)begin);
+        std::fill(timestamps.begin(), timestamps.end(), 0);
+        uint32_t time = cacheSize + 1;
+        size_t misses = 0, clusterStart = begin;
+        for (size_t t = begin; t < end; t++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t v = indices[t * 3 + k];
+                if (time - timestamps[v] > cacheSize)
+                {
+                    timestamps[v] = time++;
+                    misses++;
+                }
+            }
+            if (t + 1 < end && (float)misses <= target * (float)(t + 1 - clusterStart))
+            {
+                clusters.push_back((uint32_t)(t + 1));
+                clusterStart = t + 1;
+                misses = 0;
+                time += cacheSize + 1; // Start the next cluster with a cold cache, like the sort may put it anywhere
+            }
+        }
+    }
+
+    // Mesh centroid, then per cluster: area weighted centroid and normal -> sort key
+    double center[3] = { 0.0, 0.0, 0.0 };
+    for (size_t v = 0; v < vertexCount; v++)
+        for (int c = 0; c < 3; c++)
+            center[c] += readFloat(vertices + v * vertexStride + positionOffset + c * 4);
+    for (int c = 0; c < 3; c++)
+        center[c] /= (double)vertexCount;
+
+    struct ClusterKey
+    {
+        float key;
+        uint32_t cluster;
+    };
+    std::vector<ClusterKey> keys(clusters.size());
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        size_t begin = clusters[c], end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        float centroid[3] = { 0.0f, 0.0f, 0.0f }, normal[3] = { 0.0f, 0.0f, 0.0f }, totalArea = 0.0f;
+        for (size_t t = begin; t < end; t++)
+        {
+            float p[3][3];
+            for (int k = 0; k < 3; k++)
+                for (int a = 0; a < 3; a++)
+                    p[k][a] = readFloat(vertices + indices[t * 3 + k] * vertexStride + positionOffset + a * 4);
+            float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+            float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] }; // Length = 2 * area
+            float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int a = 0; a < 3; a++)
+            {
+                centroid[a] += (p[0][a] + p[1][a] + p[2][a]) / 3.0f * area;
+                normal[a] += n[a];
+            }
+            totalArea += area;
+        }
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float key = 0.0f;
+        if (totalArea > 0.0f && length > 0.0f)
+            for (int a = 0; a < 3; a++)
+                key += (centroid[a] / totalArea - (float)center[a]) * normal[a] / length;
+        keys[c].key = key;
+        keys[c].cluster = (uint32_t)c;
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const ClusterKey& a, const ClusterKey& b) { return a.key > b.key; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (size_t k = 0; k < keys.size(); k++)
+    {
+        size_t c = keys[k].cluster;
+        size_t begin = clusters[c], end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+    }
+    indices.swap(result);
+}
+
+
+// 4. Reorder the vertices by first use in the index buffer (unused ones are dropped). Returns the new vertex count
+// ------------------------------------------------------------------------
+inline size_t optimizeVertexFetch(std::vector<unsigned char>& vertices, size_t vertexStride, std::vector<uint32_t>& indices)
+{
+    size_t vertexCount = vertices.size() / vertexStride;
+    const uint32_t UNUSED = 0xFFFFFFFFu;
+    std::vector<uint32_t> remap(vertexCount, UNUSED);
+    std::vector<unsigned char> reordered;
+    reordered.reserve(vertices.size());
+    uint32_t next = 0;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        uint32_t& newIndex = remap[indices[i]];
+        if (newIndex == UNUSED)
+        {
+            newIndex = next++;
+            reordered.insert(reordered.end(), vertices.begin() + indices[i] * vertexStride, vertices.begin() + (indices[i] + 1) * vertexStride);
+        }
+        indices[i] = newIndex;
+    }
+    vertices.swap(reordered);
+    return next;
+}
+
+#endif
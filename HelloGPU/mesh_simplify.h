@@ -0,0 +1,258 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+// Mesh simplification for the LOD chain the cooker writes (Tools/mesh_cooker.cpp): quadric error metric edge collapse
+// (Garland & Heckbert 1997), as half-edge collapses, so a simplified mesh only ever uses vertices of the original one and
+// every level of detail can share one vertex buffer.
+//
+// Every vertex carries a quadric: the (area weighted) sum of the planes of the triangles around it, which gives the
+// squared distance from any point to those planes. Collapsing vertex a onto its neighbour b costs the quadric of both
+// evaluated at b, and b inherits the sum, so the error keeps measuring the distance to the original surface as collapses
+// pile up. Each pass sorts the possible collapses by cost and does the cheap ones that don't touch each other, until the
+// triangle target is reached or nothing can go any more.
+//
+// Kept as they are (never collapsed away): vertices on a mesh border (open edges), so holes and outlines don't shrink,
+// and vertices on attribute seams (same position, different texcoords / normals / colors), so textures don't tear.
+// Collapses that would flip a triangle are refused
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace mesh_simplify_detail
+{
+    // Symmetric 4x4 matrix of a sum of plane equations (a, b, c, d), with the total weight to normalize it
+    struct Quadric
+    {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+        double weight = 0;
+
+        void addPlane(double a, double b, double c, double d, double w)
+        {
+            a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+            b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+            c2 += w * c * c; cd += w * c * d;
+            d2 += w * d * d;
+            weight += w;
+        }
+        void add(const Quadric& q)
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+            weight += q.weight;
+        }
+        // Weighted mean squared distance from (x, y, z) to the planes
+        double error(double x, double y, double z) const
+        {
+            double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                + c2 * z * z + 2 * cd * z + d2;
+            return weight > 0 ? std::fabs(e) / weight : 0.0;
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    inline void triangleNormal(const float* p0, const float* p1, const float* p2, float* n)
+    {
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+}
+
+// Simplify a triangle list down to about 'targetIndexCount' indices. Vertices are interleaved, 3 floats of position at
+// 'positionOffset'. Returns the new index list (into the same vertices); 'resultError' gets how far the result may be
+// from the original surface, in mesh units. Stops early (with more indices than asked) when only locked vertices remain
+// ------------------------------------------------------------------------
+inline std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t>& sourceIndices, const unsigned char* vertices, size_t vertexCount, size_t vertexStride,
+    size_t positionOffset, size_t targetIndexCount, float* resultError = NULL)
+{
+    using namespace mesh_simplify_detail;
+    std::vector<uint32_t> indices = sourceIndices;
+    if (resultError)
+        *resultError = 0.0f;
+    if (indices.size() <= targetIndexCount || vertexCount == 0)
+        return indices;
+
+    std::vector<float> positions(vertexCount * 3);
+    for (size_t v = 0; v < vertexCount; v++)
+        std::memcpy(&positions[v * 3], vertices + v * vertexStride + positionOffset, 3 * sizeof(float));
+
+    // Vertices with the same position share one id (wedges of a seam), for the quadrics and the border / seam tests
+    std::vector<uint32_t> positionId(vertexCount);
+    std::vector<uint32_t> wedgeCount(vertexCount, 0);
+    {
+        struct PositionHash
+        {
+            const float* positions;
+            size_t operator()(uint32_t v) const
+            {
+                uint32_t bits[3];
+                std::memcpy(bits, positions + v * 3, sizeof(bits));
+                return (size_t)((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u));
+            }
+        };
+        struct PositionEqual
+        {
+            const float* positions;
+            bool operator()(uint32_t a, uint32_t b) const { return std::memcmp(positions + a * 3, positions + b * 3, 3 * sizeof(float)) == 0; }
+        };
+        std::unordered_set<uint32_t, PositionHash, PositionEqual> unique(vertexCount * 2, PositionHash{ positions.data() }, PositionEqual{ positions.data() });
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            positionId[v] = *unique.insert(v).first;
+            wedgeCount[positionId[v]]++;
+        }
+    }
+
+    // Border edges: a directed edge (by position) whose opposite doesn't exist
+    std::vector<uint8_t> locked(vertexCount, 0);
+    {
+        std::unordered_set<uint64_t> edges(indices.size() * 2);
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            uint32_t a = positionId[indices[i]], b = positionId[indices[i - i % 3 + (i + 1) % 3]];
+            edges.insert((uint64_t)a << 32 | b);
+        }
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            uint32_t a = positionId[indices[i]], b = positionId[indices[i - i % 3 + (i + 1) % 3]];
+            if (edges.find((uint64_t)b << 32 | a) == edges.end())
+                locked[a] = locked[b] = 1;
+        }
+    }
+    for (uint32_t v = 0; v < vertexCount; v++)
+        if (locked[positionId[v]] || wedgeCount[positionId[v]] > 1)
+            locked[v] = 1;
+
+    std::vector<Quadric> quadrics(vertexCount); // Indexed by position id
+    for (size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        const float* p0 = &positions[indices[t] * 3];
+        float n[3];
+        triangleNormal(p0, &positions[indices[t + 1] * 3], &positions[indices[t + 2] * 3], n);
+        double length = std::sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+        if (length <= 0.0)
+            continue;
+        double a = n[0] / length, b = n[1] / length, c = n[2] / length, d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+        for (int k = 0; k < 3; k++)
+            quadrics[positionId[indices[t + k]]].addPlane(a, b, c, d, length * 0.5);
+    }
+
+    double maxCost = 0.0;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1), adjacency;
+    std::vector<Collapse> collapses;
+    while (indices.size() > targetIndexCount)
+    {
+        // Triangles around each vertex
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacencyOffsets[indices[i] + 1]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        adjacency.resize(indices.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+                adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+
+        // Every edge, both ways (each direction comes from one of its two triangles)
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            uint32_t from = indices[i], to = indices[i - i % 3 + (i + 1) % 3];
+            if (locked[from] || positionId[from] == positionId[to])
+                continue;
+            Quadric q = quadrics[positionId[from]];
+            q.add(quadrics[positionId[to]]);
+            Collapse collapse = { from, to, q.error(positions[to * 3], positions[to * 3 + 1], positions[to * 3 + 2]) };
+            collapses.push_back(collapse);
+        }
+        if (collapses.empty())
+            break;
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        // Cheapest first, none sharing a triangle with another in the same pass (so the flip test sees final positions).
+        // A collapse removes about 2 triangles; only the cheaper half of the candidates are taken per pass so the
+        // expensive ones get re-priced after their neighbourhood changed
+        for (uint32_t v = 0; v < vertexCount; v++)
+            remap[v] = v;
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t trianglesLeft = indices.size() / 3, targetTriangles = targetIndexCount / 3;
+        size_t limit = std::max<size_t>(1, collapses.size() / 2), done = 0;
+        for (size_t c = 0; c < limit && trianglesLeft > targetTriangles; c++)
+        {
+            const Collapse& collapse = collapses[c];
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+            bool flips = false;
+            size_t removed = 0;
+            const float* target = &positions[collapse.to * 3];
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; a++)
+            {
+                const uint32_t* triangle = &indices[adjacency[a] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    removed++;
+                    continue;
+                }
+                const float* p[3];
+                float before[3], after[3];
+                for (int k = 0; k < 3; k++)
+                    p[k] = &positions[triangle[k] * 3];
+                triangleNormal(p[0], p[1], p[2], before);
+                for (int k = 0; k < 3; k++)
+                    p[k] = triangle[k] == collapse.from ? target : p[k];
+                triangleNormal(p[0], p[1], p[2], after);
+                flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0f;
+            }
+            if (flips)
+                continue;
+
+            // The whole fan is touched: its triangles change shape, so its vertices wait for the next pass
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+                for (int k = 0; k < 3; k++)
+                    touched[indices[adjacency[a] * 3 + k]] = 1;
+            remap[collapse.from] = collapse.to;
+            quadrics[positionId[collapse.to]].add(quadrics[positionId[collapse.from]]);
+            maxCost = std::max(maxCost, collapse.cost);
+            trianglesLeft -= std::min(trianglesLeft, removed);
+            done++;
+        }
+        if (done == 0)
+            break;
+
+        // Apply, dropping the triangles that collapsed to a line
+        size_t write = 0;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            uint32_t a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+            if (positionId[a] == positionId[b] || positionId[b] == positionId[c] || positionId[a] == positionId[c])
+                continue;
+            indices[write++] = a;
+            indices[write++] = b;
+            indices[write++] = c;
+        }
+        indices.resize(write);
+    }
+
+    if (resultError)
+        *resultError = (float)std::sqrt(maxCost);
+    return indices;
+}
+
+#endif
@@ -0,0 +1,380 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+// Meshlets: a big mesh cut into small clusters of triangles (at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES
+// triangles each), every one with a bounding sphere and a normal cone. GL 3.3 has no mesh / task shaders to cull them on the
+// GPU, so MeshletSet::cull() does it on the CPU, 8 (AVX) or 4 (SSE) clusters at a time, per draw of the mesh:
+// - off-screen: the sphere against the 6 frustum planes
+// - backfacing: every triangle of the cluster faces away from the camera (the cone test below)
+// and writes what survives as a list of index ranges for one glMultiDrawElements (drawMeshlets in mesh_master.h).
+//
+// The clusters are consecutive runs of triangles of the index buffer as it is, so nothing is copied or rewritten: a
+// cluster is just (first index, index count), and neighbouring visible clusters merge into one range. This works well on
+// meshes cooked by Tools/mesh_cooker.cpp, whose triangle order already keeps neighbours together (mesh_optimizer.h).
+//
+// Normal cone: an axis and the sine of the largest angle between it and a triangle normal (the cutoff). Seen from camera
+// c, the cluster is all backfacing when dot(center - c, axis) >= cutoff * |center - c| + radius (Barczak's derivation,
+// as in meshoptimizer). Clusters whose normals spread over 90 degrees or more get a cutoff nothing passes.
+//
+// Everything is tested in the mesh's own space: the frustum planes and the camera position come out of its
+// model-view-projection matrix, for perspective and orthographic cameras alike (where the camera is a direction)
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "culling.h" // Frustum, and the CULLING_AVX / CULLING_SSE choice
+
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+const float MESHLET_SPLIT_COSINE = 0.5f; // A triangle more than 60 degrees off a cluster's mean normal starts a new one
+
+// Index ranges to draw, ready for glMultiDrawElements (counts are GLsizei, offsets are byte offsets into the element buffer)
+struct MeshletDrawList
+{
+    std::vector<int> counts;
+    std::vector<const void*> offsets;
+    size_t clustersVisible = 0;
+    size_t clustersFrustumCulled = 0;
+    size_t clustersBackfaceCulled = 0;
+
+    void clear()
+    {
+        counts.clear();
+        offsets.clear();
+        clustersVisible = clustersFrustumCulled = clustersBackfaceCulled = 0;
+    }
+};
+
+class MeshletSet
+{
+public:
+    static const size_t LANES = 8; // Arrays are padded to a multiple of this so SIMD loops never need a scalar tail
+
+    size_t size() const { return count; }
+    size_t paddedSize() const { return radius.size(); }
+
+    // Cluster the first 'indexCount' indices (a triangle list). Positions are 3 floats at 'positionOffset' in each vertex
+    // ------------------------------------------------------------------------
+    void build(const uint32_t* indices, size_t indexCount, const unsigned char* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+        uint32_t maxVertices = MESHLET_MAX_VERTICES, uint32_t maxTriangles = MESHLET_MAX_TRIANGLES)
+    {
+        clearArrays();
+        std::vector<uint32_t> lastCluster(vertexCount, 0xFFFFFFFFu); // Which cluster a vertex was last counted in
+        uint32_t clusterVertices = 0, clusterTriangles = 0, clusterFirst = 0;
+        float normalSum[3] = { 0.0f, 0.0f, 0.0f };
+        for (size_t t = 0; t + 2 < indexCount; t += 3)
+        {
+            uint32_t fresh = 0;
+            for (int k = 0; k < 3; k++)
+                fresh += lastCluster[indices[t + k]] != count ? 1u : 0u;
+
+            // A triangle turned too far from the cluster's normals would open its cone (and the cone test fails for wide
+            // cones), so past a minimum size it starts a new cluster
+            float normal[3];
+            triangleNormal(indices + t, vertices, vertexStride, positionOffset, normal);
+            float sumLength = std::sqrt(normalSum[0] * normalSum[0] + normalSum[1] * normalSum[1] + normalSum[2] * normalSum[2]);
+            bool turned = clusterTriangles >= maxTriangles / 4 && sumLength > 0.0f
+                && (normal[0] * normalSum[0] + normal[1] * normalSum[1] + normal[2] * normalSum[2]) < MESHLET_SPLIT_COSINE * sumLength;
+
+            if (clusterTriangles > 0 && (clusterVertices + fresh > maxVertices || clusterTriangles + 1 > maxTriangles || turned))
+            {
+                finishCluster(indices, clusterFirst, (uint32_t)t - clusterFirst, vertices, vertexStride, positionOffset);
+                clusterFirst = (uint32_t)t;
+                clusterVertices = clusterTriangles = 0;
+                normalSum[0] = normalSum[1] = normalSum[2] = 0.0f;
+            }
+            for (int c = 0; c < 3; c++)
+                normalSum[c] += normal[c];
+            for (int k = 0; k < 3; k++)
+            {
+                if (lastCluster[indices[t + k]] != count)
+                {
+                    lastCluster[indices[t + k]] = (uint32_t)count;
+                    clusterVertices++;
+                }
+            }
+            clusterTriangles++;
+        }
+        if (clusterTriangles > 0)
+            finishCluster(indices, clusterFirst, (uint32_t)(indexCount / 3 * 3) - clusterFirst, vertices, vertexStride, positionOffset);
+        pad();
+    }
+
+    // Cull for one draw of the mesh with this model-view-projection matrix, appending the visible index ranges to 'list'
+    // (offsets in bytes for indices of 'indexSize' bytes). Returns how many clusters are visible
+    // ------------------------------------------------------------------------
+    size_t cull(const float* modelViewProjection, uint32_t indexSize, MeshletDrawList& list) const
+    {
+        Frustum frustum = Frustum::fromMatrix(modelViewProjection);
+        float camera[4];
+        cameraInMeshSpace(modelViewProjection, camera);
+
+        const float* xs = centerX.data();
+        const float* ys = centerY.data();
+        const float* zs = centerZ.data();
+        const float* rs = radius.data();
+        const float* axs = coneX.data();
+        const float* ays = coneY.data();
+        const float* azs = coneZ.data();
+        const float* cutoffs = coneCutoff.data();
+        const size_t padded = paddedSize();
+        size_t visibleBefore = list.clustersVisible;
+
+#if defined(CULLING_AVX)
+        __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (int p = 0; p < 6; p++)
+        {
+            planeX[p] = _mm256_set1_ps(frustum.planes[p][0]);
+            planeY[p] = _mm256_set1_ps(frustum.planes[p][1]);
+            planeZ[p] = _mm256_set1_ps(frustum.planes[p][2]);
+            planeW[p] = _mm256_set1_ps(frustum.planes[p][3]);
+        }
+        const __m256 cameraX = _mm256_set1_ps(camera[0]), cameraY = _mm256_set1_ps(camera[1]), cameraZ = _mm256_set1_ps(camera[2]), cameraW = _mm256_set1_ps(camera[3]);
+        const __m256 zero = _mm256_setzero_ps();
+        for (size_t i = 0; i < padded; i += 8)
+        {
+            __m256 x = _mm256_loadu_ps(xs + i);
+            __m256 y = _mm256_loadu_ps(ys + i);
+            __m256 z = _mm256_loadu_ps(zs + i);
+            __m256 r = _mm256_loadu_ps(rs + i);
+            __m256 negativeRadius = _mm256_sub_ps(zero, r);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < 6; p++)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, planeX[p]), _mm256_mul_ps(y, planeY[p])),
+                    _mm256_add_ps(_mm256_mul_ps(z, planeZ[p]), planeW[p]));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GT_OQ));
+            }
+            __m256 dx = _mm256_sub_ps(_mm256_mul_ps(x, cameraW), cameraX);
+            __m256 dy = _mm256_sub_ps(_mm256_mul_ps(y, cameraW), cameraY);
+            __m256 dz = _mm256_sub_ps(_mm256_mul_ps(z, cameraW), cameraZ);
+            __m256 along = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, _mm256_loadu_ps(axs + i)), _mm256_mul_ps(dy, _mm256_loadu_ps(ays + i))),
+                _mm256_mul_ps(dz, _mm256_loadu_ps(azs + i)));
+            __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+            __m256 limit = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(cutoffs + i), length), _mm256_mul_ps(r, cameraW));
+            __m256 backfacing = _mm256_cmp_ps(along, limit, _CMP_GE_OQ);
+            emit((unsigned int)_mm256_movemask_ps(inside), (unsigned int)_mm256_movemask_ps(backfacing), i, 8, indexSize, list);
+        }
+#elif defined(CULLING_SSE)
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (int p = 0; p < 6; p++)
+        {
+            planeX[p] = _mm_set1_ps(frustum.planes[p][0]);
+            planeY[p] = _mm_set1_ps(frustum.planes[p][1]);
+            planeZ[p] = _mm_set1_ps(frustum.planes[p][2]);
+            planeW[p] = _mm_set1_ps(frustum.planes[p][3]);
+        }
+        const __m128 cameraX = _mm_set1_ps(camera[0]), cameraY = _mm_set1_ps(camera[1]), cameraZ = _mm_set1_ps(camera[2]), cameraW = _mm_set1_ps(camera[3]);
+        const __m128 zero = _mm_setzero_ps();
+        for (size_t i = 0; i < padded; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(xs + i);
+            __m128 y = _mm_loadu_ps(ys + i);
+            __m128 z = _mm_loadu_ps(zs + i);
+            __m128 r = _mm_loadu_ps(rs + i);
+            __m128 negativeRadius = _mm_sub_ps(zero, r);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; p++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])),
+                    _mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+                inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negativeRadius));
+            }
+            __m128 dx = _mm_sub_ps(_mm_mul_ps(x, cameraW), cameraX);
+            __m128 dy = _mm_sub_ps(_mm_mul_ps(y, cameraW), cameraY);
+            __m128 dz = _mm_sub_ps(_mm_mul_ps(z, cameraW), cameraZ);
+            __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(axs + i)), _mm_mul_ps(dy, _mm_loadu_ps(ays + i))), _mm_mul_ps(dz, _mm_loadu_ps(azs + i)));
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+            __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(cutoffs + i), length), _mm_mul_ps(r, cameraW));
+            __m128 backfacing = _mm_cmpge_ps(along, limit);
+            emit((unsigned int)_mm_movemask_ps(inside), (unsigned int)_mm_movemask_ps(backfacing), i, 4, indexSize, list);
+        }
+#else
+        for (size_t i = 0; i < padded; i++)
+        {
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; p++)
+                inside = xs[i] * frustum.planes[p][0] + ys[i] * frustum.planes[p][1] + zs[i] * frustum.planes[p][2] + frustum.planes[p][3] > -rs[i];
+            float dx = xs[i] * camera[3] - camera[0], dy = ys[i] * camera[3] - camera[1], dz = zs[i] * camera[3] - camera[2];
+            bool backfacing = dx * axs[i] + dy * ays[i] + dz * azs[i] >= cutoffs[i] * std::sqrt(dx * dx + dy * dy + dz * dz) + rs[i] * camera[3];
+            emit(inside ? 1u : 0u, backfacing ? 1u : 0u, i, 1, indexSize, list);
+        }
+#endif
+        return list.clustersVisible - visibleBefore;
+    }
+
+private:
+    // Per cluster (structure of arrays, padded: padding clusters have a hugely negative radius and fail every plane test)
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<float> coneX, coneY, coneZ, coneCutoff;
+    std::vector<uint32_t> firstIndex, indexCount;
+    size_t count = 0;
+
+    void clearArrays()
+    {
+        centerX.clear(); centerY.clear(); centerZ.clear(); radius.clear();
+        coneX.clear(); coneY.clear(); coneZ.clear(); coneCutoff.clear();
+        firstIndex.clear(); indexCount.clear();
+        count = 0;
+    }
+
+    void pad()
+    {
+        size_t padded = (count + LANES - 1) / LANES * LANES;
+        centerX.resize(padded, 0.0f); centerY.resize(padded, 0.0f); centerZ.resize(padded, 0.0f); radius.resize(padded, -1e30f);
+        coneX.resize(padded, 0.0f); coneY.resize(padded, 0.0f); coneZ.resize(padded, 0.0f); coneCutoff.resize(padded, 2.0f);
+        firstIndex.resize(padded, 0); indexCount.resize(padded, 0);
+    }
+
+    void finishCluster(const uint32_t* indices, uint32_t first, uint32_t indexTotal, const unsigned char* vertices, size_t vertexStride, size_t positionOffset)
+    {
+        auto position = [&](uint32_t index, float* p) { std::memcpy(p, vertices + (size_t)index * vertexStride + positionOffset, 3 * sizeof(float)); };
+
+        // Sphere: around the box center, through the farthest vertex
+        float minimum[3] = { 1e30f, 1e30f, 1e30f }, maximum[3] = { -1e30f, -1e30f, -1e30f };
+        for (uint32_t i = first; i < first + indexTotal; i++)
+        {
+            float p[3];
+            position(indices[i], p);
+            for (int c = 0; c < 3; c++)
+            {
+                minimum[c] = std::min(minimum[c], p[c]);
+                maximum[c] = std::max(maximum[c], p[c]);
+            }
+        }
+        float center[3] = { (minimum[0] + maximum[0]) * 0.5f, (minimum[1] + maximum[1]) * 0.5f, (minimum[2] + maximum[2]) * 0.5f };
+        float radiusSquared = 0.0f;
+        for (uint32_t i = first; i < first + indexTotal; i++)
+        {
+            float p[3];
+            position(indices[i], p);
+            float dx = p[0] - center[0], dy = p[1] - center[1], dz = p[2] - center[2];
+            radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+        }
+
+        // Cone: the mean of the triangle normals, opened to the one farthest from it
+        std::vector<float>& normals = scratchNormals;
+        normals.clear();
+        float axis[3] = { 0.0f, 0.0f, 0.0f };
+        for (uint32_t i = first; i + 2 < first + indexTotal; i += 3)
+        {
+            float p0[3], p1[3], p2[3];
+            position(indices[i], p0);
+            position(indices[i + 1], p1);
+            position(indices[i + 2], p2);
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] }, e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length <= 0.0f)
+                continue; // Degenerate triangles don't draw, they don't widen the cone either
+            for (int c = 0; c < 3; c++)
+            {
+                normals.push_back(n[c] / length);
+                axis[c] += n[c] / length;
+            }
+        }
+        float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        float cutoff = 2.0f; // Never backfacing
+        if (axisLength > 0.0f)
+        {
+            for (int c = 0; c < 3; c++)
+                axis[c] /= axisLength;
+            float minimumDot = 1.0f;
+            for (size_t n = 0; n < normals.size(); n += 3)
+                minimumDot = std::min(minimumDot, normals[n] * axis[0] + normals[n + 1] * axis[1] + normals[n + 2] * axis[2]);
+            if (minimumDot > 0.0f)
+                cutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+        }
+
+        centerX.push_back(center[0]); centerY.push_back(center[1]); centerZ.push_back(center[2]); radius.push_back(std::sqrt(radiusSquared));
+        coneX.push_back(axis[0]); coneY.push_back(axis[1]); coneZ.push_back(axis[2]); coneCutoff.push_back(cutoff);
+        firstIndex.push_back(first); indexCount.push_back(indexTotal);
+        count++;
+    }
+    std::vector<float> scratchNormals;
+
+    // Unit normal of one triangle (zero when it is degenerate)
+    static void triangleNormal(const uint32_t* triangle, const unsigned char* vertices, size_t vertexStride, size_t positionOffset, float* normal)
+    {
+        float p[3][3];
+        for (int k = 0; k < 3; k++)
+            std::memcpy(p[k], vertices + (size_t)triangle[k] * vertexStride + positionOffset, 3 * sizeof(float));
+        float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] }, e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+        normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int c = 0; c < 3; c++)
+            normal[c] = length > 0.0f ? normal[c] / length : 0.0f;
+    }
+
+    // The camera in the mesh's space, as a homogeneous point: the one point every clip x, y and w plane goes through (the
+    // null vector of those 3 rows of the matrix). Scaled to w = 1 for a perspective camera (its position); for an
+    // orthographic one w = 0 and xyz is the unit direction it looks away from, so center * w - xyz always points from the
+    // camera to the center
+    static void cameraInMeshSpace(const float* m, float camera[4])
+    {
+        float r[3][4];
+        const int rows[3] = { 0, 1, 3 };
+        for (int i = 0; i < 3; i++)
+            for (int c = 0; c < 4; c++)
+                r[i][c] = m[c * 4 + rows[i]];
+        auto minor = [&](int a, int b, int c)
+        {
+            return r[0][a] * (r[1][b] * r[2][c] - r[1][c] * r[2][b]) - r[0][b] * (r[1][a] * r[2][c] - r[1][c] * r[2][a]) + r[0][c] * (r[1][a] * r[2][b] - r[1][b] * r[2][a]);
+        };
+        camera[0] = minor(1, 2, 3);
+        camera[1] = -minor(0, 2, 3);
+        camera[2] = minor(0, 1, 3);
+        camera[3] = -minor(0, 1, 2);
+        float xyzLength = std::sqrt(camera[0] * camera[0] + camera[1] * camera[1] + camera[2] * camera[2]);
+        if (std::fabs(camera[3]) > 1e-6f * xyzLength)
+        {
+            float inverseW = 1.0f / camera[3];
+            for (int c = 0; c < 4; c++)
+                camera[c] *= inverseW;
+            return;
+        }
+        // Orthographic: -xyz must be the direction of view, the one along which clip z grows (GL depth goes away from the camera)
+        float depthAlong = m[2] * camera[0] + m[6] * camera[1] + m[10] * camera[2];
+        float scale = (depthAlong > 0.0f ? -1.0f : 1.0f) / (xyzLength > 0.0f ? xyzLength : 1.0f);
+        for (int c = 0; c < 3; c++)
+            camera[c] *= scale;
+        camera[3] = 0.0f;
+    }
+
+    void emit(unsigned int insideMask, unsigned int backfacingMask, size_t base, unsigned int lanes, uint32_t indexSize, MeshletDrawList& list) const
+    {
+        for (unsigned int lane = 0; lane < lanes; lane++)
+        {
+            size_t cluster = base + lane;
+            if (cluster >= count)
+                return;
+            if (!(insideMask & (1u << lane)))
+            {
+                list.clustersFrustumCulled++;
+                continue;
+            }
+            if (backfacingMask & (1u << lane))
+            {
+                list.clustersBackfaceCulled++;
+                continue;
+            }
+            list.clustersVisible++;
+            // Continues the previous range: grow it instead of adding a draw
+            uintptr_t offset = (uintptr_t)firstIndex[cluster] * indexSize;
+            if (!list.counts.empty() && (uintptr_t)list.offsets.back() + (uintptr_t)list.counts.back() * indexSize == offset)
+                list.counts.back() += (int)indexCount[cluster];
+            else
+            {
+                list.counts.push_back((int)indexCount[cluster]);
+                list.offsets.push_back((const void*)offset);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef REDRAW_TRACKER_H
+#define REDRAW_TRACKER_H
+
+// Dirty tracking for render-on-demand. Anything that changes what's on screen asks for a redraw (input that changed the
+// simulation state, framebuffer_size_callback, a texture that finished streaming ...); while nothing is pending the
+// loop blocks in glfwWaitEventsTimeout instead of redrawing the same frame
+//
+// Two levels:
+// - render:  the image changed, draw a new frame
+// - present: the image didn't change but the window contents were damaged (refresh callback), so put the last frame back
+//            on screen without re-rendering it: the render graph runs only its present pass from the sceneColor texture
+//            (the front buffer can't be read back, its contents are undefined after a swap on most compositors and drivers)
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+
+class RedrawTracker
+{
+public:
+    static RedrawTracker& get()
+    {
+        static RedrawTracker instance;
+        return instance;
+    }
+
+    // Safe from any thread (streaming/loading workers): wakes the main loop if it is blocked waiting for events
+    // ------------------------------------------------------------------------
+    void requestRender()
+    {
+        renderPending.store(true);
+        glfwPostEmptyEvent();
+    }
+    void requestPresent()
+    {
+        presentPending.store(true);
+        glfwPostEmptyEvent();
+    }
+
+    bool isRenderPending() const { return renderPending.load(); }
+    bool isPresentPending() const { return presentPending.load(); }
+
+    // Called by the loop when it takes care of the request
+    bool consumeRender()
+    {
+        presentPending.store(false); // A new frame also covers any pending re-present
+        return renderPending.exchange(false);
+    }
+    bool consumePresent() { return presentPending.exchange(false); }
+
+private:
+    RedrawTracker() {}
+    std::atomic<bool> renderPending{ true }; // The first frame always has to be drawn
+    std::atomic<bool> presentPending{ false };
+};
+
+#endif
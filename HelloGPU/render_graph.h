@@ -0,0 +1,461 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+// Declarative render graph. Passes say which textures they read and write; compile() then
+//  1. culls passes whose output nobody uses (only passes that end up in an imported target - the window - survive),
+//  2. keeps the declaration order for the rest (a pass can only read what an earlier pass wrote, so it's a valid order),
+//  3. computes the lifetime (first/last pass) of every transient texture and lets textures with the same description
+//     and non-overlapping lifetimes share one GL texture (aliasing), so intermediate targets cost as little VRAM as possible,
+//  4. creates one FBO per pass from its written textures.
+// execute() binds each pass's FBO + viewport and runs its callback, executePass() does that for one pass
+//
+// An aliased texture starts every frame with whatever the previous user left in it: a pass must clear or fully
+// overwrite what it writes
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "texture_objects.h"
+
+typedef int RGResource;
+const RGResource RG_INVALID = -1;
+
+struct RGTextureDesc
+{
+    GLenum internalFormat = GL_RGBA8;
+    float scale = 1.0f;      // Size relative to the window framebuffer (used when width/height are 0)
+    int width = 0;           // Fixed size (shadow maps ...)
+    int height = 0;
+    GLenum filter = GL_LINEAR;
+};
+
+class RenderGraph;
+
+// Handed to a pass's execute callback
+// ------------------------------------------------------------------------
+struct RGPassContext
+{
+    const RenderGraph* graph;
+    int width;   // Size of the pass's render target
+    int height;
+
+    GLuint texture(RGResource resource) const;
+};
+
+class RenderGraph
+{
+public:
+    ~RenderGraph() { releaseGL(); }
+
+    // Declaration
+    // ------------------------------------------------------------------------
+    RGResource createTexture(const std::string& name, const RGTextureDesc& desc)
+    {
+        Resource resource;
+        resource.name = name;
+        resource.desc = desc;
+        resources.push_back(resource);
+        return (RGResource)resources.size() - 1;
+    }
+
+    // The default framebuffer (the window). Writing it is what keeps a pass alive
+    RGResource importBackbuffer(const std::string& name)
+    {
+        Resource resource;
+        resource.name = name;
+        resource.imported = true;
+        resources.push_back(resource);
+        return (RGResource)resources.size() - 1;
+    }
+
+    int addPass(const std::string& name, const std::vector<RGResource>& reads, const std::vector<RGResource>& writes, std::function<void(const RGPassContext&)> execute)
+    {
+        Pass pass;
+        pass.name = name;
+        pass.reads = reads;
+        pass.writes = writes;
+        pass.execute = execute;
+        passes.push_back(pass);
+        compiled = false;
+        return (int)passes.size() - 1;
+    }
+
+    // Change a texture description (dynamic resolution ...). Takes effect at the next compile
+    void setTextureDesc(RGResource resource, const RGTextureDesc& desc)
+    {
+        resources[resource].desc = desc;
+        compiled = false;
+    }
+
+    // Compile for a backbuffer size. Cheap to call every frame: it only does work when the size or the graph changed
+    // ------------------------------------------------------------------------
+    bool compile(int backbufferWidth, int backbufferHeight)
+    {
+        if (compiled && backbufferWidth == compiledWidth && backbufferHeight == compiledHeight)
+            return true;
+        compiledWidth = backbufferWidth;
+        compiledHeight = backbufferHeight;
+
+        if (!validate())
+            return false;
+        cullPasses();
+        computeLifetimes();
+        assignPhysicalTextures();
+        createFramebuffers();
+        compiled = true;
+        return true;
+    }
+
+    void execute() const
+    {
+        for (size_t p = 0; p < passes.size(); p++)
+        {
+            const Pass& pass = passes[p];
+            if (pass.culled)
+                continue;
+            glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+            glViewport(0, 0, pass.width, pass.height);
+            RGPassContext context = { this, pass.width, pass.height };
+            pass.execute(context);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Run a single live pass, e.g. only "present" to put the last frame's scene texture back on the window. Its inputs hold
+    // what they held at the end of the last execute(): fine for textures nothing aliases after their last read. Returns
+    // false if there is no such pass or it was culled (or the graph isn't compiled)
+    bool executePass(const std::string& name) const
+    {
+        if (!compiled)
+            return false;
+        for (size_t p = 0; p < passes.size(); p++)
+        {
+            const Pass& pass = passes[p];
+            if (pass.name != name || pass.culled)
+                continue;
+            glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+            glViewport(0, 0, pass.width, pass.height);
+            RGPassContext context = { this, pass.width, pass.height };
+            pass.execute(context);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            return true;
+        }
+        return false;
+    }
+
+    // GL texture behind a resource (valid after compile)
+    GLuint texture(RGResource resource) const
+    {
+        const Resource& r = resources[resource];
+        return r.physical >= 0 ? physicalTextures[r.physical].texture : 0;
+    }
+
+    // Delete the GL objects while the context is still current (the destructor may run too late, after glfwTerminate)
+    void release() { releaseGL(); }
+
+    // Summary of the last compile: live passes, transient textures and how many GL textures they really needed
+    void printSummary() const
+    {
+        int livePasses = 0, transient = 0;
+        size_t bytes = 0;
+        for (size_t p = 0; p < passes.size(); p++)
+            livePasses += passes[p].culled ? 0 : 1;
+        for (size_t r = 0; r < resources.size(); r++)
+            transient += (!resources[r].imported && resources[r].physical >= 0) ? 1 : 0;
+        for (size_t t = 0; t < physicalTextures.size(); t++)
+            bytes += (size_t)physicalTextures[t].width * physicalTextures[t].height * bytesPerPixel(physicalTextures[t].desc.internalFormat);
+        std::cout << "RenderGraph: " << livePasses << "/" << passes.size() << " passes live, " << transient << " transient textures in "
+            << physicalTextures.size() << " GL textures (" << bytes / 1024 << " KB) at " << compiledWidth << "x" << compiledHeight << std::endl;
+    }
+
+private:
+    struct Resource
+    {
+        std::string name;
+        RGTextureDesc desc;
+        bool imported = false;
+        int firstUse = -1;
+        int lastUse = -1;
+        int physical = -1;
+    };
+    struct Pass
+    {
+        std::string name;
+        std::vector<RGResource> reads;
+        std::vector<RGResource> writes;
+        std::function<void(const RGPassContext&)> execute;
+        bool culled = false;
+        GLuint framebuffer = 0;
+        int width = 0;
+        int height = 0;
+    };
+    struct PhysicalTexture
+    {
+        RGTextureDesc desc;
+        int width = 0;
+        int height = 0;
+        GLuint texture = 0;
+        int busyUntil = -1; // Last pass index of the resource currently living in it
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<PhysicalTexture> physicalTextures;
+    std::vector<GLuint> framebuffers;
+    bool compiled = false;
+    int compiledWidth = 0;
+    int compiledHeight = 0;
+
+    // Every read must have been written by an earlier pass (or be imported)
+    bool validate() const
+    {
+        std::vector<bool> written(resources.size(), false);
+        for (size_t p = 0; p < passes.size(); p++)
+        {
+            for (size_t i = 0; i < passes[p].reads.size(); i++)
+            {
+                RGResource r = passes[p].reads[i];
+                if (!resources[r].imported && !written[r])
+                {
+                    std::cout << "ERROR::RENDER_GRAPH::READ_BEFORE_WRITE: pass " << passes[p].name << " reads " << resources[r].name << std::endl;
+                    return false;
+                }
+            }
+            for (size_t i = 0; i < passes[p].writes.size(); i++)
+                written[passes[p].writes[i]] = true;
+        }
+        return true;
+    }
+
+    // Walk backwards from the imported targets: a pass is needed if it writes something a needed pass (or the window) uses
+    void cullPasses()
+    {
+        std::vector<bool> needed(resources.size(), false);
+        for (size_t r = 0; r < resources.size(); r++)
+            needed[r] = resources[r].imported;
+
+        for (size_t p = passes.size(); p-- > 0;)
+        {
+            Pass& pass = passes[p];
+            pass.culled = true;
+            for (size_t i = 0; i < pass.writes.size(); i++)
+                if (needed[pass.writes[i]])
+                    pass.culled = false;
+            if (pass.culled)
+                continue;
+            for (size_t i = 0; i < pass.reads.size(); i++)
+                needed[pass.reads[i]] = true;
+        }
+    }
+
+    void computeLifetimes()
+    {
+        for (size_t r = 0; r < resources.size(); r++)
+        {
+            resources[r].firstUse = -1;
+            resources[r].lastUse = -1;
+        }
+        for (size_t p = 0; p < passes.size(); p++)
+        {
+            if (passes[p].culled)
+                continue;
+            touch(passes[p].reads, (int)p);
+            touch(passes[p].writes, (int)p);
+        }
+    }
+
+    void touch(const std::vector<RGResource>& list, int passIndex)
+    {
+        for (size_t i = 0; i < list.size(); i++)
+        {
+            Resource& r = resources[list[i]];
+            if (r.firstUse < 0)
+                r.firstUse = passIndex;
+            r.lastUse = passIndex;
+        }
+    }
+
+    // Greedy interval packing: in order of first use, reuse a GL texture of the same size/format whose current user is done
+    void assignPhysicalTextures()
+    {
+        std::vector<PhysicalTexture> previous;
+        previous.swap(physicalTextures);
+
+        std::vector<RGResource> order;
+        for (size_t r = 0; r < resources.size(); r++)
+        {
+            resources[r].physical = -1;
+            if (!resources[r].imported && resources[r].firstUse >= 0)
+                order.push_back((RGResource)r);
+        }
+        std::stable_sort(order.begin(), order.end(), [this](RGResource a, RGResource b) { return resources[a].firstUse < resources[b].firstUse; });
+
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            Resource& r = resources[order[i]];
+            int width, height;
+            resolveSize(r.desc, width, height);
+
+            int slot = -1;
+            for (size_t t = 0; t < physicalTextures.size() && slot < 0; t++)
+            {
+                const PhysicalTexture& candidate = physicalTextures[t];
+                if (candidate.busyUntil < r.firstUse && candidate.width == width && candidate.height == height &&
+                    candidate.desc.internalFormat == r.desc.internalFormat && candidate.desc.filter == r.desc.filter)
+                    slot = (int)t;
+            }
+            if (slot < 0)
+            {
+                PhysicalTexture created;
+                created.desc = r.desc;
+                created.width = width;
+                created.height = height;
+                physicalTextures.push_back(created);
+                slot = (int)physicalTextures.size() - 1;
+            }
+            physicalTextures[slot].busyUntil = r.lastUse;
+            r.physical = slot;
+        }
+
+        // Keep GL textures from the last compile that still match a slot, delete the rest
+        for (size_t t = 0; t < physicalTextures.size(); t++)
+        {
+            PhysicalTexture& slot = physicalTextures[t];
+            for (size_t old = 0; old < previous.size() && slot.texture == 0; old++)
+            {
+                if (previous[old].texture != 0 && previous[old].width == slot.width && previous[old].height == slot.height &&
+                    previous[old].desc.internalFormat == slot.desc.internalFormat && previous[old].desc.filter == slot.desc.filter)
+                {
+                    slot.texture = previous[old].texture;
+                    previous[old].texture = 0;
+                }
+            }
+            if (slot.texture == 0)
+                slot.texture = createTexture(slot);
+        }
+        for (size_t old = 0; old < previous.size(); old++)
+            if (previous[old].texture != 0)
+                glDeleteTextures(1, &previous[old].texture);
+    }
+
+    void createFramebuffers()
+    {
+        if (!framebuffers.empty())
+            glDeleteFramebuffers((GLsizei)framebuffers.size(), framebuffers.data());
+        framebuffers.clear();
+
+        for (size_t p = 0; p < passes.size(); p++)
+        {
+            Pass& pass = passes[p];
+            pass.framebuffer = 0;
+            pass.width = compiledWidth;
+            pass.height = compiledHeight;
+            if (pass.culled)
+                continue;
+
+            bool writesBackbuffer = false;
+            for (size_t i = 0; i < pass.writes.size(); i++)
+                writesBackbuffer |= resources[pass.writes[i]].imported;
+            if (writesBackbuffer)
+                continue; // FBO 0
+
+            GLuint framebuffer;
+            glGenFramebuffers(1, &framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            std::vector<GLenum> drawBuffers;
+            for (size_t i = 0; i < pass.writes.size(); i++)
+            {
+                const Resource& r = resources[pass.writes[i]];
+                const PhysicalTexture& target = physicalTextures[r.physical];
+                GLenum attachment = isDepthFormat(r.desc.internalFormat) ? GL_DEPTH_ATTACHMENT : GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, target.texture, 0);
+                if (attachment != GL_DEPTH_ATTACHMENT)
+                    drawBuffers.push_back(attachment);
+                if (i == 0)
+                {
+                    pass.width = target.width;
+                    pass.height = target.height;
+                }
+                else if (target.width != pass.width || target.height != pass.height)
+                {
+                    // GL only renders where all attachments overlap: keep the viewport inside every target, and say so
+                    // (a target whose desc didn't follow the others, e.g. a depth buffer without the color target's scale)
+                    std::cout << "ERROR::RENDER_GRAPH::ATTACHMENT_SIZE_MISMATCH: pass " << pass.name << ", " << r.name << " is " << target.width << "x"
+                        << target.height << ", the pass was " << pass.width << "x" << pass.height << std::endl;
+                    pass.width = std::min(pass.width, target.width);
+                    pass.height = std::min(pass.height, target.height);
+                }
+            }
+            if (drawBuffers.empty())
+                glDrawBuffer(GL_NONE);
+            else
+                glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::RENDER_GRAPH::FRAMEBUFFER_INCOMPLETE: pass " << pass.name << std::endl;
+            pass.framebuffer = framebuffer;
+            framebuffers.push_back(framebuffer);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void resolveSize(const RGTextureDesc& desc, int& width, int& height) const
+    {
+        width = desc.width > 0 ? desc.width : (int)(compiledWidth * desc.scale + 0.5f);
+        height = desc.height > 0 ? desc.height : (int)(compiledHeight * desc.scale + 0.5f);
+        width = width < 1 ? 1 : width;
+        height = height < 1 ? 1 : height;
+    }
+
+    // Immutable storage (see texture_objects.h): a new size is a new texture anyway. Passes sample them with sampler 0,
+    // so the filter is set on the texture
+    static GLuint createTexture(const PhysicalTexture& slot)
+    {
+        GLuint texture = createTexture2D(slot.desc.internalFormat, slot.width, slot.height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, slot.desc.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, slot.desc.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    static bool isDepthFormat(GLenum internalFormat)
+    {
+        return internalFormat == GL_DEPTH_COMPONENT16 || internalFormat == GL_DEPTH_COMPONENT24 || internalFormat == GL_DEPTH_COMPONENT32F;
+    }
+
+    static size_t bytesPerPixel(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_RGBA16F: return 8;
+        case GL_RGBA32F: return 16;
+        case GL_DEPTH_COMPONENT16: return 2;
+        default: return 4;
+        }
+    }
+
+    void releaseGL()
+    {
+        if (!framebuffers.empty())
+            glDeleteFramebuffers((GLsizei)framebuffers.size(), framebuffers.data());
+        framebuffers.clear();
+        for (size_t t = 0; t < physicalTextures.size(); t++)
+            if (physicalTextures[t].texture != 0)
+                glDeleteTextures(1, &physicalTextures[t].texture);
+        physicalTextures.clear();
+        compiled = false;
+    }
+};
+
+inline GLuint RGPassContext::texture(RGResource resource) const
+{
+    return graph->texture(resource);
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+// Sort-key render queue. Every draw is pushed as a 64-bit key + a compact payload; once per frame the keys are radix
+// sorted and the draws are recorded in that order, so draws sharing a program / textures / VAO end up next to each
+// other and most glUseProgram / glBindTexture calls disappear (the state cache skips the redundant ones)
+//
+// Key layout, most significant bit first:
+//   opaque:       layer:4 | translucent:1 (0) | program:10 | texture0:12 | texture1:12 | vertexArray:8 | depth:17 (near -> far)
+//   translucent:  layer:4 | translucent:1 (1) | depth:17 (far -> near) | program:10 | texture0:12 | texture1:12 | vertexArray:8
+// Translucent draws have to be blended back to front, so for them depth wins over state. Within a layer every opaque draw
+// comes first: they draw with blending off and write depth, translucent ones blend over them (BlendMode, gl_state_cache.h).
+// record() can take the two buckets apart, so something else (the world map) can draw in between
+// GL names are truncated to their field width: two names that collide only sort next to each other, the payload keeps
+// the real names so the draw itself is always right
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "command_buffer.h"
+#include "gl_state_cache.h"
+
+struct DrawItem
+{
+    // Sort inputs
+    uint8_t layer = 0;          // 0..15, drawn in increasing order (world, then overlays ...)
+    bool translucent = false;
+    float depth = 0.0f;         // View depth normalized to [0, 1]
+
+    // Payload (translucent: drawn with BlendMode::PremultipliedAlpha)
+    GLuint program = 0;
+    GLuint textures[2] = { 0, 0 };
+    GLuint samplers[2] = { 0, 0 }; // Per texture unit, from the SamplerCache (0 = the texture's own parameters)
+    GLuint vertexArray = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    uintptr_t indexOffset = 0;
+    GLsizei instanceCount = 1;
+    GLint floatUniformLocation = -1; // One per-draw float (the mix intensity for our shader), -1 = none
+    float floatUniformValue = 0.0f;
+};
+
+enum class RenderBucket
+{
+    All,
+    Opaque,
+    Translucent
+};
+
+struct RenderQueueStats
+{
+    unsigned int draws = 0;
+    unsigned int switchesUnsorted = 0; // State switches if we had drawn in push order
+    unsigned int switchesSorted = 0;   // State switches after sorting
+
+    unsigned int saved() const { return switchesUnsorted > switchesSorted ? switchesUnsorted - switchesSorted : 0; }
+};
+
+class RenderQueue
+{
+public:
+    void clear()
+    {
+        items.clear();
+        keys.clear();
+    }
+
+    void push(const DrawItem& item)
+    {
+        SortEntry entry;
+        entry.key = makeKey(item);
+        entry.index = (uint32_t)items.size();
+        keys.push_back(entry);
+        items.push_back(item);
+    }
+
+    // Radix sort by key (stable, 8 bits per pass; passes where every key has the same byte are skipped)
+    // ------------------------------------------------------------------------
+    void sort()
+    {
+        stats = RenderQueueStats();
+        stats.draws = (unsigned int)items.size();
+        stats.switchesUnsorted = countSwitches(false);
+
+        scratch.resize(keys.size());
+        for (int pass = 0; pass < 8; pass++)
+        {
+            const int shift = pass * 8;
+            size_t histogram[256] = {};
+            for (size_t i = 0; i < keys.size(); i++)
+                histogram[(keys[i].key >> shift) & 0xFF]++;
+            if (!keys.empty() && histogram[(keys[0].key >> shift) & 0xFF] == keys.size())
+                continue; // All keys share this byte
+
+            size_t offset = 0;
+            for (int bucket = 0; bucket < 256; bucket++)
+            {
+                size_t count = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += count;
+            }
+            for (size_t i = 0; i < keys.size(); i++)
+                scratch[histogram[(keys[i].key >> shift) & 0xFF]++] = keys[i];
+            keys.swap(scratch);
+        }
+
+        stats.switchesSorted = countSwitches(true);
+    }
+
+    // Record the draws of 'bucket' in sorted order, each with its blend mode. Binds go into the list unconditionally: the
+    // replay's GLStateCache drops the redundant ones against the real GL state
+    // ------------------------------------------------------------------------
+    void record(CommandList& commands, RenderBucket bucket = RenderBucket::All) const
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            const DrawItem& item = items[keys[i].index];
+            if ((bucket == RenderBucket::Opaque && item.translucent) || (bucket == RenderBucket::Translucent && !item.translucent))
+                continue;
+            commands.setBlendMode(item.translucent ? BlendMode::PremultipliedAlpha : BlendMode::Opaque);
+            commands.useProgram(item.program);
+            commands.bindTexture(0, GL_TEXTURE_2D, item.textures[0]);
+            commands.bindTexture(1, GL_TEXTURE_2D, item.textures[1]);
+            commands.bindSampler(0, item.samplers[0]);
+            commands.bindSampler(1, item.samplers[1]);
+            commands.bindVertexArray(item.vertexArray);
+            if (item.floatUniformLocation >= 0)
+                commands.uniform1f(item.floatUniformLocation, item.floatUniformValue);
+            if (item.instanceCount == 1)
+                commands.drawElements(GL_TRIANGLES, item.indexCount, item.indexType, item.indexOffset);
+            else
+                commands.drawElementsInstanced(GL_TRIANGLES, item.indexCount, item.indexType, item.indexOffset, item.instanceCount);
+        }
+    }
+
+    const RenderQueueStats& lastStats() const { return stats; }
+    size_t size() const { return items.size(); }
+
+    static uint64_t makeKey(const DrawItem& item)
+    {
+        uint64_t layer = item.layer & 0xF;
+        uint64_t program = item.program & 0x3FF;
+        uint64_t texture0 = item.textures[0] & 0xFFF;
+        uint64_t texture1 = item.textures[1] & 0xFFF;
+        uint64_t vertexArray = item.vertexArray & 0xFF;
+        float clamped = item.depth < 0.0f ? 0.0f : (item.depth > 1.0f ? 1.0f : item.depth);
+        uint64_t depth = (uint64_t)(clamped * 0x1FFFF) & 0x1FFFF;
+        uint64_t state = (program << 32) | (texture0 << 20) | (texture1 << 8) | vertexArray; // 42 bits
+        // Samplers aren't in the key: a texture is nearly always drawn with the same one, so they group with their textures
+
+        if (!item.translucent)
+            return (layer << 60) | (state << 17) | depth;
+        return (layer << 60) | (1ull << 59) | ((0x1FFFF - depth) << 42) | state;
+    }
+
+private:
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+    std::vector<DrawItem> items;
+    std::vector<SortEntry> keys;
+    std::vector<SortEntry> scratch;
+    RenderQueueStats stats;
+
+    unsigned int countSwitches(bool sorted) const
+    {
+        BoundState bound;
+        unsigned int switches = 0;
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            const DrawItem& item = sorted ? items[keys[i].index] : items[i];
+            switches += bound.setProgram(item.program) ? 1 : 0;
+            switches += bound.setTexture(0, GL_TEXTURE_2D, item.textures[0]) ? 1 : 0;
+            switches += bound.setTexture(1, GL_TEXTURE_2D, item.textures[1]) ? 1 : 0;
+            switches += bound.setSampler(0, item.samplers[0]) ? 1 : 0;
+            switches += bound.setSampler(1, item.samplers[1]) ? 1 : 0;
+            switches += bound.setVertexArray(item.vertexArray) ? 1 : 0;
+            switches += bound.setBlendMode(item.translucent ? BlendMode::PremultipliedAlpha : BlendMode::Opaque) ? 1 : 0;
+        }
+        return switches;
+    }
+};
+
+#endif
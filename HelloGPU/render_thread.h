@@ -0,0 +1,133 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+// Dedicated render thread. It owns the GL context (glfwMakeContextCurrent on that thread), so a blocking
+// glfwSwapBuffers only stalls rendering while the main thread keeps polling events and simulating.
+// The main thread hands over one immutable snapshot per frame through a lock-free single producer / single consumer
+// queue with room for one frame. Double buffered: while frame N is being submitted to the GPU (its snapshot already popped),
+// frame N+1 is simulated and waits in the queue, and the main thread waits before pushing N+2. A deeper queue would let it
+// run further ahead and add a frame of input latency for each extra slot
+
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Lock-free ring buffer for exactly one producer thread and one consumer thread
+// ------------------------------------------------------------------------
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+public:
+    bool push(const T& value)
+    {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) % (Capacity + 1);
+        if (next == headIndex.load(std::memory_order_acquire))
+            return false; // Full
+        slots[tail] = value;
+        tailIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value)
+    {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire))
+            return false; // Empty
+        value = slots[head];
+        headIndex.store((head + 1) % (Capacity + 1), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const { return headIndex.load(std::memory_order_acquire) == tailIndex.load(std::memory_order_acquire); }
+
+private:
+    T slots[Capacity + 1]; // One slot stays unused to tell full from empty
+    // Producer and consumer indices on separate cache lines so the two threads don't fight over one line
+    alignas(64) std::atomic<size_t> headIndex{ 0 };
+    alignas(64) std::atomic<size_t> tailIndex{ 0 };
+};
+
+
+template <typename Snapshot>
+class RenderThread
+{
+public:
+    ~RenderThread() { stop(); }
+
+    // Take the window's context over to a new thread. The caller must have released it (glfwMakeContextCurrent(NULL)).
+    // 'init' runs once on the render thread with the context current (swap interval, ...), 'render' once per snapshot
+    // ------------------------------------------------------------------------
+    void start(GLFWwindow* window, std::function<void()> init, std::function<void(const Snapshot&)> render)
+    {
+        running.store(true);
+        thread = std::thread([this, window, init, render]()
+        {
+            glfwMakeContextCurrent(window);
+            if (init)
+                init();
+
+            Snapshot snapshot;
+            while (true)
+            {
+                if (frames.pop(snapshot))
+                {
+                    wakeProducer.notify_one();
+                    render(snapshot);
+                    continue;
+                }
+                if (!running.load())
+                    break;
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                wakeConsumer.wait(lock, [this]() { return !frames.empty() || !running.load(); });
+            }
+
+            glfwMakeContextCurrent(NULL); // Give the context back so the main thread can clean up
+        });
+    }
+
+    // Hand a frame to the render thread. Blocks while the previous one is still waiting (back pressure)
+    // ------------------------------------------------------------------------
+    void submit(const Snapshot& snapshot)
+    {
+        while (!frames.push(snapshot))
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeProducer.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        std::lock_guard<std::mutex> lock(sleepMutex); // Pairs with the consumer's predicate check so the wakeup can't be lost
+        wakeConsumer.notify_one();
+    }
+
+    // Finish the queued frames and join. The context is released, call glfwMakeContextCurrent(window) afterwards
+    // ------------------------------------------------------------------------
+    void stop()
+    {
+        if (!thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            running.store(false);
+        }
+        wakeConsumer.notify_one();
+        thread.join();
+    }
+
+    bool isRunning() const { return thread.joinable(); }
+
+private:
+    SpscQueue<Snapshot, 1> frames; // Plus the snapshot being rendered: two frames in flight
+    std::thread thread;
+    std::atomic<bool> running{ false };
+    std::mutex sleepMutex; // Only used to sleep when there is nothing to do, never held while touching the queue data
+    std::condition_variable wakeConsumer;
+    std::condition_variable wakeProducer;
+};
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef SCENE_STORAGE_H
+#define SCENE_STORAGE_H
+
+// Data-oriented storage for scene objects. An entity is just a handle; its data lives in components, and all entities with
+// the same set of components share an archetype that keeps one contiguous array per component (row i of every array is
+// the same entity). Systems walk whole arrays instead of chasing per-object pointers, and can split them over the job
+// system. Bounds are kept as a BoundsSoA so the culling reads them directly
+//
+// Handles stay valid while rows move around (removal swaps the last row into the hole): they go through a slot table,
+// and a generation counter makes a handle to a destroyed entity fail instead of hitting whoever reused its slot
+//
+//     Entity quad = scene.create(COMPONENT_TRANSFORM | COMPONENT_RENDERABLE | COMPONENT_MATERIAL | COMPONENT_BOUNDS);
+//     scene.transform(quad)->node = hierarchy.addNode(TransformHierarchy::NO_PARENT, position, rotation, scale);
+//     scene.parallelForEach(COMPONENT_TRANSFORM | COMPONENT_BOUNDS, 4096, [&](Archetype& a, size_t begin, size_t end) { ... });
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "culling.h"
+#include "job_system.h"
+#include "mesh_lod.h"
+
+// Components
+// ------------------------------------------------------------------------
+// The entity's node in the TransformHierarchy, which holds its local transform and computes its world matrix
+struct Transform
+{
+    uint32_t node = 0xFFFFFFFFu;
+};
+
+// Oscillates an entity around its origin and spins it around z, relative to its parent (the animation system writes the
+// local transform of its node from it)
+struct Motion
+{
+    float origin[3] = { 0.0f, 0.0f, 0.0f };
+    float amplitude = 0.0f;
+    float frequency = 0.0f; // Radians per second
+    float phase = 0.0f;
+    float spin = 0.0f; // Radians per second
+};
+
+struct Renderable
+{
+    GLuint vertexArray = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    float boundingRadius = 0.0f; // Of the mesh at scale 1, around its origin
+    const MeshLod* lods = NULL;  // The mesh's levels of detail (lodCount of them, owned by its GpuMesh), NULL = just the indexCount above
+    uint32_t lodCount = 0;
+    uint32_t lod = 0;            // Level drawn last frame, for the selection hysteresis (mesh_lod.h)
+    float meshUnitsPerTexcoord = 0.0f; // Texcoord density of the mesh (GpuMesh), for texture streaming
+};
+
+struct Material
+{
+    GLuint program = 0;
+    GLuint textures[2] = { 0, 0 };
+    GLuint samplers[2] = { 0, 0 }; // How each texture is filtered & wrapped (shared sampler objects, see texture_objects.h)
+    bool translucent = false;      // A texture isn't opaque: blended, back to front, after the opaque draws (see render_queue.h)
+};
+
+enum ComponentFlags : uint32_t
+{
+    COMPONENT_TRANSFORM = 1u << 0,
+    COMPONENT_MOTION = 1u << 1,
+    COMPONENT_RENDERABLE = 1u << 2,
+    COMPONENT_MATERIAL = 1u << 3,
+    COMPONENT_BOUNDS = 1u << 4
+};
+
+struct Entity
+{
+    uint32_t slot = 0xFFFFFFFFu;
+    uint32_t generation = 0;
+};
+
+
+// All entities with exactly one component set. Arrays of components the archetype doesn't have stay empty
+// ------------------------------------------------------------------------
+struct Archetype
+{
+    uint32_t mask = 0;
+    std::vector<uint32_t> entitySlots; // Row -> slot, to fix up the handle of the row moved on removal
+    std::vector<Transform> transforms;
+    std::vector<Motion> motions;
+    std::vector<Renderable> renderables;
+    std::vector<Material> materials;
+    BoundsSoA bounds;
+
+    size_t size() const { return entitySlots.size(); }
+    bool has(uint32_t components) const { return (mask & components) == components; }
+};
+
+
+class SceneStorage
+{
+public:
+    // New entity with default-initialized components
+    // ------------------------------------------------------------------------
+    Entity create(uint32_t components)
+    {
+        uint32_t slotIndex;
+        if (!freeSlots.empty())
+        {
+            slotIndex = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            slotIndex = (uint32_t)slots.size();
+            slots.push_back(Slot());
+        }
+
+        int archetypeIndex = findOrCreateArchetype(components);
+        Archetype& archetype = archetypes[archetypeIndex];
+        Slot& slot = slots[slotIndex];
+        slot.archetype = archetypeIndex;
+        slot.row = (uint32_t)archetype.size();
+        slot.alive = true;
+
+        archetype.entitySlots.push_back(slotIndex);
+        if (archetype.has(COMPONENT_TRANSFORM))
+            archetype.transforms.push_back(Transform());
+        if (archetype.has(COMPONENT_MOTION))
+            archetype.motions.push_back(Motion());
+        if (archetype.has(COMPONENT_RENDERABLE))
+            archetype.renderables.push_back(Renderable());
+        if (archetype.has(COMPONENT_MATERIAL))
+            archetype.materials.push_back(Material());
+        if (archetype.has(COMPONENT_BOUNDS))
+            archetype.bounds.add(0.0f, 0.0f, 0.0f, 0.0f);
+
+        Entity entity;
+        entity.slot = slotIndex;
+        entity.generation = slot.generation;
+        return entity;
+    }
+
+    // ------------------------------------------------------------------------
+    void destroy(Entity entity)
+    {
+        if (!alive(entity))
+            return;
+        Slot& slot = slots[entity.slot];
+        Archetype& archetype = archetypes[slot.archetype];
+        size_t row = slot.row;
+        size_t last = archetype.size() - 1;
+
+        // Move the last row into the hole and repoint its handle
+        archetype.entitySlots[row] = archetype.entitySlots[last];
+        slots[archetype.entitySlots[row]].row = (uint32_t)row;
+        archetype.entitySlots.pop_back();
+        swapRemove(archetype.transforms, row);
+        swapRemove(archetype.motions, row);
+        swapRemove(archetype.renderables, row);
+        swapRemove(archetype.materials, row);
+        if (archetype.has(COMPONENT_BOUNDS))
+            archetype.bounds.swapRemove(row);
+
+        slot.alive = false;
+        slot.generation++;
+        freeSlots.push_back(entity.slot);
+    }
+
+    bool alive(Entity entity) const
+    {
+        return entity.slot < slots.size() && slots[entity.slot].alive && slots[entity.slot].generation == entity.generation;
+    }
+
+    // Component access by handle (NULL if the entity is gone or doesn't have it). Pointers are only valid until the next create/destroy
+    // ------------------------------------------------------------------------
+    Transform* transform(Entity entity) { return component(entity, COMPONENT_TRANSFORM, &Archetype::transforms); }
+    Motion* motion(Entity entity) { return component(entity, COMPONENT_MOTION, &Archetype::motions); }
+    Renderable* renderable(Entity entity) { return component(entity, COMPONENT_RENDERABLE, &Archetype::renderables); }
+    Material* material(Entity entity) { return component(entity, COMPONENT_MATERIAL, &Archetype::materials); }
+
+    // Iterate every archetype that has at least 'components', in chunks of rows: body(archetype, beginRow, endRow)
+    // ------------------------------------------------------------------------
+    template <typename Body>
+    void forEach(uint32_t components, Body body)
+    {
+        for (size_t a = 0; a < archetypes.size(); a++)
+            if (archetypes[a].has(components) && archetypes[a].size() > 0)
+                body(archetypes[a], (size_t)0, archetypes[a].size());
+    }
+
+    // Same, with the rows of each archetype split over the job system ('grain' rows per job). The body runs on several
+    // threads at once, on disjoint rows: it may write the components of its own rows, nothing shared
+    template <typename Body>
+    void parallelForEach(uint32_t components, size_t grain, Body body)
+    {
+        for (size_t a = 0; a < archetypes.size(); a++)
+        {
+            Archetype& archetype = archetypes[a];
+            if (!archetype.has(components) || archetype.size() == 0)
+                continue;
+            JobSystem::get().parallelFor(archetype.size(), grain, [&archetype, &body](size_t begin, size_t end) { body(archetype, begin, end); });
+        }
+    }
+
+    size_t entityCount() const { return slots.size() - freeSlots.size(); }
+    size_t archetypeCount() const { return archetypes.size(); }
+
+private:
+    struct Slot
+    {
+        uint32_t generation = 0;
+        int archetype = -1;
+        uint32_t row = 0;
+        bool alive = false;
+    };
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::vector<Archetype> archetypes;
+
+    int findOrCreateArchetype(uint32_t components)
+    {
+        for (size_t a = 0; a < archetypes.size(); a++)
+            if (archetypes[a].mask == components)
+                return (int)a;
+        Archetype archetype;
+        archetype.mask = components;
+        archetypes.push_back(archetype);
+        return (int)archetypes.size() - 1;
+    }
+
+    template <typename Component>
+    Component* component(Entity entity, uint32_t flag, std::vector<Component> Archetype::* column)
+    {
+        if (!alive(entity))
+            return NULL;
+        const Slot& slot = slots[entity.slot];
+        Archetype& archetype = archetypes[slot.archetype];
+        if (!archetype.has(flag))
+            return NULL;
+        return &(archetype.*column)[slot.row];
+    }
+
+    template <typename Component>
+    static void swapRemove(std::vector<Component>& column, size_t row)
+    {
+        if (column.empty())
+            return;
+        column[row] = column.back();
+        column.pop_back();
+    }
+};
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef SHADER_BATCH_H
+#define SHADER_BATCH_H
+
+// Compile many shader programs at once. The Shader constructor compiles, links and then asks for GL_COMPILE_STATUS /
+// GL_LINK_STATUS straight away, which forces the driver to finish each program before the next one is even submitted.
+// A batch issues every glCompileShader / glLinkProgram first and only looks at the results at the end, so with
+// KHR_parallel_shader_compile the driver's compiler threads work on all of them while we keep doing startup work
+//
+//     ShaderBatch batch;
+//     int index = batch.add("Shaders/vertexShader/a.glsl", "Shaders/fragmentShader/a.glsl");
+//     batch.submit();
+//     ... upload buffers, load textures ...
+//     batch.finish();                 // Reports errors here, after everything was compiled
+//     Shader shader(batch.program(index));
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <thread>
+#include <iostream>
+
+#include "shader_master.h"
+#include "shader_source_cache.h"
+#include "gl_extensions.h"
+
+class ShaderBatch
+{
+public:
+    // Let the driver use as many compiler threads as it likes (0xFFFFFFFF = implementation maximum)
+    // ------------------------------------------------------------------------
+    static void setMaxCompilerThreads(GLuint threads = 0xFFFFFFFFu)
+    {
+        if (glExtensions().parallelShaderCompile)
+            glExtensions().glMaxShaderCompilerThreads(threads);
+    }
+
+    // Queue a vertex/fragment pair. Returns the index to pass to program()
+    // ------------------------------------------------------------------------
+    int add(const char* vertexPath, const char* fragmentPath)
+    {
+        Entry entry;
+        entry.vertexPath = vertexPath;
+        entry.fragmentPath = fragmentPath;
+        entries.push_back(entry);
+        return (int)entries.size() - 1;
+    }
+
+    // Issue every compile, then every link, without querying any status in between
+    // ------------------------------------------------------------------------
+    void submit()
+    {
+        for (size_t i = submitted; i < entries.size(); i++)
+        {
+            Entry& entry = entries[i];
+            ShaderSource vertexSource = ShaderSourceCache::get().load(entry.vertexPath);
+            ShaderSource fragmentSource = ShaderSourceCache::get().load(entry.fragmentPath);
+            if (!vertexSource.valid || !fragmentSource.valid)
+            {
+                // Nothing is compiled for it, finish() reports it failed and program() stays 0
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << entry.vertexPath << " + " << entry.fragmentPath << std::endl;
+                entry.sourceMissing = true;
+                continue;
+            }
+
+            entry.vertex = glCreateShader(GL_VERTEX_SHADER);
+            glShaderSource(entry.vertex, vertexSource.count(), vertexSource.strings(), vertexSource.lengths());
+            glCompileShader(entry.vertex);
+
+            entry.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(entry.fragment, fragmentSource.count(), fragmentSource.strings(), fragmentSource.lengths());
+            glCompileShader(entry.fragment);
+        }
+        // Linking right after compiling is fine: the driver chains the link behind its compile jobs
+        for (size_t i = submitted; i < entries.size(); i++)
+        {
+            Entry& entry = entries[i];
+            if (entry.sourceMissing)
+                continue;
+            entry.program = glCreateProgram();
+            glAttachShader(entry.program, entry.vertex);
+            glAttachShader(entry.program, entry.fragment);
+            glLinkProgram(entry.program);
+        }
+        submitted = entries.size();
+    }
+
+    // Non-blocking: true once every submitted program finished linking. Without the extension there is no way to ask
+    // without blocking, so it just reports true and finish() does the (blocking) status checks
+    // ------------------------------------------------------------------------
+    bool isComplete()
+    {
+        if (!glExtensions().parallelShaderCompile)
+            return true;
+        for (; completed < submitted; completed++)
+        {
+            if (entries[completed].sourceMissing)
+                continue;
+            GLint done = GL_FALSE;
+            glGetProgramiv(entries[completed].program, GL_COMPLETION_STATUS_KHR, &done);
+            if (done == GL_FALSE)
+                return false;
+        }
+        return true;
+    }
+
+    // Wait for the batch, report compile/link errors for every program and release the shader objects.
+    // Returns true if all programs linked
+    // ------------------------------------------------------------------------
+    bool finish()
+    {
+        submit();
+        while (!isComplete())
+            std::this_thread::yield();
+
+        bool allLinked = true;
+        for (size_t i = checked; i < entries.size(); i++)
+        {
+            Entry& entry = entries[i];
+            if (entry.sourceMissing)
+            {
+                std::cout << "ERROR::SHADER_BATCH::PROGRAM_FAILED: " << entry.vertexPath << " + " << entry.fragmentPath << std::endl;
+                allLinked = false;
+                continue;
+            }
+            bool vertexOk = Shader::checkCompileErrors(entry.vertex, "VERTEX");
+            bool fragmentOk = Shader::checkCompileErrors(entry.fragment, "FRAGMENT");
+            bool linked = Shader::checkCompileErrors(entry.program, "PROGRAM");
+            if (!vertexOk || !fragmentOk || !linked)
+            {
+                std::cout << "ERROR::SHADER_BATCH::PROGRAM_FAILED: " << entry.vertexPath << " + " << entry.fragmentPath << std::endl;
+                allLinked = false;
+            }
+            glDetachShader(entry.program, entry.vertex);
+            glDetachShader(entry.program, entry.fragment);
+            glDeleteShader(entry.vertex);
+            glDeleteShader(entry.fragment);
+            entry.vertex = entry.fragment = 0;
+        }
+        checked = entries.size();
+        return allLinked;
+    }
+
+    unsigned int program(int index) const { return entries[index].program; }
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry
+    {
+        std::string vertexPath;
+        std::string fragmentPath;
+        GLuint vertex = 0;
+        GLuint fragment = 0;
+        GLuint program = 0;
+        bool sourceMissing = false; // A file (or an #include) couldn't be read, nothing was compiled
+    };
+    std::vector<Entry> entries;
+    size_t submitted = 0;
+    size_t completed = 0;
+    size_t checked = 0;
+};
+
+#endif
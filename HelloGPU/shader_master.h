@@ -4,10 +4,10 @@
 #include <glad/glad.h>
 
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
 
+#include "shader_source_cache.h"
+
 class Shader
 {
 public:
@@ -19,46 +19,26 @@ public:
 
     Shader(const char* vertexPath, const char* fragmentPath)
     {
-        // 1. Retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
+        // 1. Retrieve the vertex/fragment source code from the shared source cache (mapped once per process, never copied)
+        ShaderSource vertexSource = ShaderSourceCache::get().load(vertexPath);
+        ShaderSource fragmentSource = ShaderSourceCache::get().load(fragmentPath);
+        if (!vertexSource.valid || !fragmentSource.valid)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+            // A file or one of its #includes is missing: don't hand half a source to the compiler
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << vertexPath << " + " << fragmentPath << std::endl;
+            ID = 0;
+            return;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
         // 2. Compile shaders
         unsigned int vertex, fragment;
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glShaderSource(vertex, vertexSource.count(), vertexSource.strings(), vertexSource.lengths()); // Pointer + length of every segment, no null terminators needed
         glCompileShader(vertex);
         checkCompileErrors(vertex, "VERTEX");
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glShaderSource(fragment, fragmentSource.count(), fragmentSource.strings(), fragmentSource.lengths());
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
         // shader Program
@@ -72,6 +52,10 @@ public:
         glDeleteShader(fragment);
     }
 
+    // Wrap a program that was already compiled & linked elsewhere (ShaderBatch in shader_batch.h):
+    // ------------------------------------------------------------------------
+    explicit Shader(unsigned int programID) : ID(programID) {}
+
     // Use the shader program:
     // ------------------------------------------------------------------------
     void use()
@@ -96,10 +80,9 @@ public:
         glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
     }
 
-private:
-    // Utility function for checking shader compilation/linking errors.
+    // Utility function for checking shader compilation/linking errors. Returns false (and prints the log) on failure
     // ------------------------------------------------------------------------
-    void checkCompileErrors(unsigned int shader, std::string type)
+    static bool checkCompileErrors(unsigned int shader, std::string type)
     {
         int success;
         char infoLog[1024];
@@ -121,6 +104,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success != 0;
     }
 };
 
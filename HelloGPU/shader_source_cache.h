@@ -0,0 +1,156 @@
+#ifndef SHADER_SOURCE_CACHE_H
+#define SHADER_SOURCE_CACHE_H
+
+// Process wide cache of GLSL source files. Every file is opened through the VFS once (mapped, or viewed straight out of the
+// asset pack) and stays mapped while the cache holds it, so a file shared by many programs costs one read in total.
+// Sources are never copied: glShaderSource gets pointer + length pairs into the mappings
+//
+// A line of the form   #include "Shaders/common/foo.glsl"   is expanded by splitting the source into several strings
+// around it (glShaderSource takes an array of strings), not by pasting text together
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "virtual_fs.h"
+
+// The pieces of one shader stage, ready for glShaderSource(shader, count(), strings(), lengths())
+// ------------------------------------------------------------------------
+struct ShaderSource
+{
+    std::vector<const GLchar*> segmentStrings;
+    std::vector<GLint> segmentLengths;
+    std::vector<std::shared_ptr<const AssetBlob>> files; // Keeps the mappings alive while the source is in use
+    bool valid = true;
+
+    GLsizei count() const { return (GLsizei)segmentStrings.size(); }
+    const GLchar* const* strings() const { return segmentStrings.data(); }
+    const GLint* lengths() const { return segmentLengths.data(); }
+
+    void addSegment(const unsigned char* begin, const unsigned char* end)
+    {
+        if (end > begin)
+        {
+            segmentStrings.push_back((const GLchar*)begin);
+            segmentLengths.push_back((GLint)(end - begin));
+        }
+    }
+};
+
+class ShaderSourceCache
+{
+public:
+    static ShaderSourceCache& get()
+    {
+        static ShaderSourceCache instance;
+        return instance;
+    }
+
+    // Open (or reuse) one file. Returns NULL if it couldn't be read
+    // ------------------------------------------------------------------------
+    std::shared_ptr<const AssetBlob> acquire(const std::string& path)
+    {
+        std::string key = normalizeAssetPath(path);
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        std::map<std::string, std::shared_ptr<const AssetBlob>>::iterator it = files.find(key);
+        if (it != files.end())
+            return it->second;
+
+        std::shared_ptr<AssetBlob> blob(new AssetBlob(VirtualFS::get().open(key)));
+        if (!blob->valid())
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << key << std::endl;
+            return NULL;
+        }
+        files[key] = blob;
+        return blob;
+    }
+
+    // Build the segment list of a shader stage, following #include lines
+    // ------------------------------------------------------------------------
+    ShaderSource load(const std::string& path)
+    {
+        ShaderSource source;
+        appendFile(source, path, 0);
+        return source;
+    }
+
+    // Drop every cached file once startup compilation is done (sources still referenced by a ShaderSource stay mapped)
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        files.clear();
+    }
+
+private:
+    ShaderSourceCache() {}
+    std::mutex cacheMutex;
+    std::map<std::string, std::shared_ptr<const AssetBlob>> files;
+
+    static const int MAX_INCLUDE_DEPTH = 16;
+
+    void appendFile(ShaderSource& source, const std::string& path, int depth)
+    {
+        if (depth > MAX_INCLUDE_DEPTH)
+        {
+            std::cout << "ERROR::SHADER::INCLUDE_TOO_DEEP: " << path << std::endl;
+            source.valid = false;
+            return;
+        }
+        std::shared_ptr<const AssetBlob> blob = acquire(path);
+        if (!blob)
+        {
+            source.valid = false;
+            return;
+        }
+        source.files.push_back(blob);
+
+        const unsigned char* cursor = blob->data();
+        const unsigned char* const end = cursor + blob->size();
+        const unsigned char* segmentStart = cursor;
+        while (cursor < end)
+        {
+            const unsigned char* lineEnd = cursor;
+            while (lineEnd < end && *lineEnd != '\n')
+                lineEnd++;
+
+            std::string includePath;
+            if (parseInclude(cursor, lineEnd, includePath))
+            {
+                source.addSegment(segmentStart, cursor);
+                appendFile(source, includePath, depth + 1);
+                segmentStart = lineEnd; // Keep the newline so line numbers in the including file stay close
+            }
+            cursor = lineEnd < end ? lineEnd + 1 : end;
+        }
+        source.addSegment(segmentStart, end);
+    }
+
+    static bool parseInclude(const unsigned char* line, const unsigned char* lineEnd, std::string& includePath)
+    {
+        while (line < lineEnd && (*line == ' ' || *line == '\t'))
+            line++;
+        static const char directive[] = "#include";
+        const size_t directiveLength = sizeof(directive) - 1;
+        if ((size_t)(lineEnd - line) <= directiveLength || std::memcmp(line, directive, directiveLength) != 0)
+            return false;
+        const unsigned char* open = line + directiveLength;
+        while (open < lineEnd && *open != '"')
+            open++;
+        const unsigned char* close = open + 1;
+        while (close < lineEnd && *close != '"')
+            close++;
+        if (open >= lineEnd || close >= lineEnd)
+            return false;
+        includePath.assign((const char*)open + 1, (const char*)close);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+// Small 3D math library: Vec3, Vec4, Quat and Mat4 (column major, same layout as GLSL so m can go straight to
+// glUniformMatrix4fv / buffers). The hot operations (matrix * matrix, matrix * vector, TRS composition) have SSE and NEON
+// paths picked at compile time, with a plain C++ fallback; everything else is scalar since the compiler does fine with it
+//
+// Conventions: right handed, rotations counter-clockwise looking down the axis, angles in radians, Quat = (x, y, z, w)
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_MATH_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_MATH_NEON 1
+#endif
+
+struct Vec3
+{
+    float x, y, z;
+};
+
+struct Vec4
+{
+    float x, y, z, w;
+};
+
+struct Quat
+{
+    float x, y, z, w;
+};
+
+struct Mat4
+{
+    float m[16]; // Column major: m[column * 4 + row]
+};
+
+// Vec3
+// ------------------------------------------------------------------------
+inline Vec3 vec3(float x, float y, float z) { Vec3 v = { x, y, z }; return v; }
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return vec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return vec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Vec3 operator*(const Vec3& a, float s) { return vec3(a.x * s, a.y * s, a.z * s); }
+inline Vec3 operator*(const Vec3& a, const Vec3& b) { return vec3(a.x * b.x, a.y * b.y, a.z * b.z); }
+inline float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 cross(const Vec3& a, const Vec3& b) { return vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+inline float length(const Vec3& a) { return std::sqrt(dot(a, a)); }
+inline Vec3 normalize(const Vec3& a)
+{
+    float len = length(a);
+    return len > 0.0f ? a * (1.0f / len) : a;
+}
+
+// Quat
+// ------------------------------------------------------------------------
+inline Quat quatIdentity() { Quat q = { 0.0f, 0.0f, 0.0f, 1.0f }; return q; }
+
+inline Quat quatFromAxisAngle(const Vec3& axis, float angle)
+{
+    Vec3 n = normalize(axis);
+    float s = std::sin(angle * 0.5f);
+    Quat q = { n.x * s, n.y * s, n.z * s, std::cos(angle * 0.5f) };
+    return q;
+}
+
+// a * b: rotate by b, then by a
+inline Quat operator*(const Quat& a, const Quat& b)
+{
+    Quat q = {
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+    };
+    return q;
+}
+
+inline Quat normalize(const Quat& q)
+{
+    float len = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    float inverse = len > 0.0f ? 1.0f / len : 0.0f;
+    Quat r = { q.x * inverse, q.y * inverse, q.z * inverse, q.w * inverse };
+    return r;
+}
+
+inline Vec3 rotate(const Quat& q, const Vec3& v)
+{
+    // v + 2w(u x v) + 2(u x (u x v)), u = vector part
+    Vec3 u = vec3(q.x, q.y, q.z);
+    Vec3 t = cross(u, v) * 2.0f;
+    return v + t * q.w + cross(u, t);
+}
+
+// Normalized lerp along the shortest arc: close enough to slerp for animation steps and much cheaper
+inline Quat nlerp(const Quat& a, const Quat& b, float t)
+{
+    float sign = (a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w) < 0.0f ? -1.0f : 1.0f;
+    Quat q = { a.x + (b.x * sign - a.x) * t, a.y + (b.y * sign - a.y) * t, a.z + (b.z * sign - a.z) * t, a.w + (b.w * sign - a.w) * t };
+    return normalize(q);
+}
+
+// Mat4
+// ------------------------------------------------------------------------
+inline Mat4 mat4Identity()
+{
+    Mat4 r = { { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f } };
+    return r;
+}
+
+inline Mat4 mat4Translation(const Vec3& t)
+{
+    Mat4 r = mat4Identity();
+    r.m[12] = t.x;
+    r.m[13] = t.y;
+    r.m[14] = t.z;
+    return r;
+}
+
+inline Mat4 mat4Scale(const Vec3& s)
+{
+    Mat4 r = mat4Identity();
+    r.m[0] = s.x;
+    r.m[5] = s.y;
+    r.m[10] = s.z;
+    return r;
+}
+
+// Translation * Rotation * Scale in one go (what a node's local transform is)
+inline Mat4 mat4FromTRS(const Vec3& t, const Quat& q, const Vec3& s)
+{
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    Mat4 r;
+    r.m[0] = (1.0f - 2.0f * (yy + zz)) * s.x;
+    r.m[1] = (2.0f * (xy + wz)) * s.x;
+    r.m[2] = (2.0f * (xz - wy)) * s.x;
+    r.m[3] = 0.0f;
+    r.m[4] = (2.0f * (xy - wz)) * s.y;
+    r.m[5] = (1.0f - 2.0f * (xx + zz)) * s.y;
+    r.m[6] = (2.0f * (yz + wx)) * s.y;
+    r.m[7] = 0.0f;
+    r.m[8] = (2.0f * (xz + wy)) * s.z;
+    r.m[9] = (2.0f * (yz - wx)) * s.z;
+    r.m[10] = (1.0f - 2.0f * (xx + yy)) * s.z;
+    r.m[11] = 0.0f;
+    r.m[12] = t.x;
+    r.m[13] = t.y;
+    r.m[14] = t.z;
+    r.m[15] = 1.0f;
+    return r;
+}
+
+// a * b (apply b first). Each result column is a linear combination of a's columns weighted by b's column
+inline void mat4Multiply(const Mat4& a, const Mat4& b, Mat4& out)
+{
+#if defined(SIMD_MATH_SSE)
+    __m128 a0 = _mm_loadu_ps(a.m + 0), a1 = _mm_loadu_ps(a.m + 4), a2 = _mm_loadu_ps(a.m + 8), a3 = _mm_loadu_ps(a.m + 12);
+    for (int c = 0; c < 4; c++)
+    {
+        const float* column = b.m + c * 4;
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+        _mm_storeu_ps(out.m + c * 4, r);
+    }
+#elif defined(SIMD_MATH_NEON)
+    float32x4_t a0 = vld1q_f32(a.m + 0), a1 = vld1q_f32(a.m + 4), a2 = vld1q_f32(a.m + 8), a3 = vld1q_f32(a.m + 12);
+    for (int c = 0; c < 4; c++)
+    {
+        float32x4_t column = vld1q_f32(b.m + c * 4);
+        float32x4_t r = vmulq_n_f32(a0, vgetq_lane_f32(column, 0));
+        r = vmlaq_n_f32(r, a1, vgetq_lane_f32(column, 1));
+        r = vmlaq_n_f32(r, a2, vgetq_lane_f32(column, 2));
+        r = vmlaq_n_f32(r, a3, vgetq_lane_f32(column, 3));
+        vst1q_f32(out.m + c * 4, r);
+    }
+#else
+    float result[16];
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+            result[c * 4 + r] = a.m[r] * b.m[c * 4] + a.m[4 + r] * b.m[c * 4 + 1] + a.m[8 + r] * b.m[c * 4 + 2] + a.m[12 + r] * b.m[c * 4 + 3];
+    for (int i = 0; i < 16; i++)
+        out.m[i] = result[i];
+#endif
+}
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+    Mat4 r;
+    mat4Multiply(a, b, r);
+    return r;
+}
+
+inline Vec4 operator*(const Mat4& a, const Vec4& v)
+{
+#if defined(SIMD_MATH_SSE)
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(a.m + 0), _mm_set1_ps(v.x));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(a.m + 4), _mm_set1_ps(v.y)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(a.m + 8), _mm_set1_ps(v.z)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(a.m + 12), _mm_set1_ps(v.w)));
+    Vec4 out;
+    _mm_storeu_ps(&out.x, r);
+    return out;
+#elif defined(SIMD_MATH_NEON)
+    float32x4_t r = vmulq_n_f32(vld1q_f32(a.m + 0), v.x);
+    r = vmlaq_n_f32(r, vld1q_f32(a.m + 4), v.y);
+    r = vmlaq_n_f32(r, vld1q_f32(a.m + 8), v.z);
+    r = vmlaq_n_f32(r, vld1q_f32(a.m + 12), v.w);
+    Vec4 out;
+    vst1q_f32(&out.x, r);
+    return out;
+#else
+    Vec4 out = {
+        a.m[0] * v.x + a.m[4] * v.y + a.m[8] * v.z + a.m[12] * v.w,
+        a.m[1] * v.x + a.m[5] * v.y + a.m[9] * v.z + a.m[13] * v.w,
+        a.m[2] * v.x + a.m[6] * v.y + a.m[10] * v.z + a.m[14] * v.w,
+        a.m[3] * v.x + a.m[7] * v.y + a.m[11] * v.z + a.m[15] * v.w
+    };
+    return out;
+#endif
+}
+
+inline Vec3 transformPoint(const Mat4& a, const Vec3& p)
+{
+    Vec4 r = a * Vec4{ p.x, p.y, p.z, 1.0f };
+    return vec3(r.x, r.y, r.z);
+}
+
+inline Vec3 mat4GetTranslation(const Mat4& a) { return vec3(a.m[12], a.m[13], a.m[14]); }
+
+// Largest axis scale (bounding sphere radius scale)
+inline float mat4MaxScale(const Mat4& a)
+{
+    float sx = a.m[0] * a.m[0] + a.m[1] * a.m[1] + a.m[2] * a.m[2];
+    float sy = a.m[4] * a.m[4] + a.m[5] * a.m[5] + a.m[6] * a.m[6];
+    float sz = a.m[8] * a.m[8] + a.m[9] * a.m[9] + a.m[10] * a.m[10];
+    float s = sx > sy ? sx : sy;
+    return std::sqrt(s > sz ? s : sz);
+}
+
+// Same as glOrtho: the box [left, right] x [bottom, top] x [-near, -far] maps to NDC
+inline Mat4 mat4Ortho(float left, float right, float bottom, float top, float nearZ, float farZ)
+{
+    Mat4 r = mat4Identity();
+    r.m[0] = 2.0f / (right - left);
+    r.m[5] = 2.0f / (top - bottom);
+    r.m[10] = -2.0f / (farZ - nearZ);
+    r.m[12] = -(right + left) / (right - left);
+    r.m[13] = -(top + bottom) / (top - bottom);
+    r.m[14] = -(farZ + nearZ) / (farZ - nearZ);
+    return r;
+}
+
+// Same as gluPerspective (vertical field of view)
+inline Mat4 mat4Perspective(float fovY, float aspect, float nearZ, float farZ)
+{
+    float f = 1.0f / std::tan(fovY * 0.5f);
+    Mat4 r = { { 0.0f } };
+    r.m[0] = f / aspect;
+    r.m[5] = f;
+    r.m[10] = (farZ + nearZ) / (nearZ - farZ);
+    r.m[11] = -1.0f;
+    r.m[14] = 2.0f * farZ * nearZ / (nearZ - farZ);
+    return r;
+}
+
+inline Mat4 mat4LookAt(const Vec3& eye, const Vec3& target, const Vec3& up)
+{
+    Vec3 f = normalize(target - eye);
+    Vec3 s = normalize(cross(f, up));
+    Vec3 u = cross(s, f);
+    Mat4 r = mat4Identity();
+    r.m[0] = s.x; r.m[4] = s.y; r.m[8] = s.z;
+    r.m[1] = u.x; r.m[5] = u.y; r.m[9] = u.z;
+    r.m[2] = -f.x; r.m[6] = -f.y; r.m[10] = -f.z;
+    r.m[12] = -dot(s, eye);
+    r.m[13] = -dot(u, eye);
+    r.m[14] = dot(f, eye);
+    return r;
+}
+
+#endif
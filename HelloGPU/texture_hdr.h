@@ -0,0 +1,403 @@
+#ifndef TEXTURE_HDR_H
+#define TEXTURE_HDR_H
+
+// High precision textures: Radiance .hdr images (stbi_loadf) and 16 bit PNGs (stbi_load_16), for data that doesn't fit
+// in 8 bits per channel (lighting, anything brighter than white). imagePrecision() tells from the file's bytes which path an
+// image needs (stbi_is_hdr / stbi_is_16_bit); 8 bit images go on through the usual RGBA8 path (texture_streaming.h).
+//
+// Both kinds are decoded to linear float RGBA (16 bit sRGB images are decoded to linear first), mip filtered in float and
+// converted to one of the smaller GPU formats (alpha premultiplied, like the 8 bit textures), never uploaded as GL_RGBA32F
+// (16 bytes a texel):
+//   Rgba16F       8 bytes  half floats, keeps alpha and negative values
+//   R11G11B10F    4 bytes  unsigned floats with 6/6/5 mantissa bits, no alpha
+//   Rgb9E5        4 bytes  9 bit mantissas sharing one exponent (precise for the brightest channel of each texel), no alpha
+//
+// The float -> half conversion is the bulk of the work (4 values a texel, every level): it runs 8 values at a time with F16C
+// when the compiler targets it (AVX2 builds), 4 at a time in SSE2 integer math otherwise, rounding to nearest even like the
+// hardware. These textures aren't streamed: the whole chain is uploaded at once, in immutable storage where supported
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "stb_image.h"
+#include "texture_master.h" // ColorSpace
+#include "texture_objects.h" // createTexture2D
+#include "virtual_fs.h"
+
+#if defined(__F16C__) || defined(__AVX2__)
+#include <immintrin.h>
+#define TEXTURE_HDR_F16C 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_HDR_SSE 1
+#endif
+
+enum class ImagePrecision
+{
+    Ldr8,     // 8 bits per channel (PNG, JPG, TGA ...)
+    Unorm16,  // 16 bits per channel PNG
+    Hdr       // Radiance .hdr, float texels
+};
+
+enum class HdrTextureFormat
+{
+    Rgba16F,
+    R11G11B10F,
+    Rgb9E5
+};
+
+inline const char* hdrTextureFormatName(HdrTextureFormat format)
+{
+    return format == HdrTextureFormat::Rgba16F ? "RGBA16F" : format == HdrTextureFormat::R11G11B10F ? "R11F_G11F_B10F" : "RGB9_E5";
+}
+
+// Which loading path the image in 'data' needs (just reads its header)
+// ------------------------------------------------------------------------
+inline ImagePrecision imagePrecision(const unsigned char* data, size_t size)
+{
+    if (stbi_is_hdr_from_memory(data, (int)size))
+        return ImagePrecision::Hdr;
+    if (stbi_is_16_bit_from_memory(data, (int)size))
+        return ImagePrecision::Unorm16;
+    return ImagePrecision::Ldr8;
+}
+inline ImagePrecision imagePrecision(const char* path)
+{
+    AssetBlob blob = VirtualFS::get().open(path);
+    if (!blob.valid() || blob.size() == 0)
+        return ImagePrecision::Ldr8; // Let the usual path report the missing file
+    return imagePrecision(blob.data(), blob.size());
+}
+
+
+// Float -> small float conversions
+// ------------------------------------------------------------------------
+namespace texture_hdr_detail
+{
+    inline uint32_t floatBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, 4);
+        return bits;
+    }
+    inline float bitsFloat(uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, 4);
+        return value;
+    }
+
+    // A positive float (sign bit clear) to a float with 5 exponent bits (bias 15) and 'mantissaBits' mantissa bits, rounded
+    // to nearest even: half (10), the 11 (6) and 10 (5) bit floats of R11F_G11F_B10F. Too big = infinity, NaN stays NaN
+    inline uint32_t toSmallFloat(uint32_t bits, int mantissaBits)
+    {
+        const int shift = 23 - mantissaBits;
+        const uint32_t infinity = 0x1Fu << mantissaBits;
+        if (bits >= (127u + 16u) << 23) // 2^16 and up: out of range
+            return bits > 0x7F800000u ? infinity | (1u << (mantissaBits - 1)) : infinity;
+        if (bits < 113u << 23) // Under 2^-14: denormal (or 0). Adding this magic number lines the mantissa up at the bottom, the FPU rounds
+        {
+            const uint32_t magic = (uint32_t)((127 - 15) + shift + 1) << 23;
+            return floatBits(bitsFloat(bits) + bitsFloat(magic)) - magic;
+        }
+        uint32_t mantissaOdd = (bits >> shift) & 1u;
+        bits += ((uint32_t)(15 - 127) << 23) + (1u << (shift - 1)) - 1u + mantissaOdd; // Rebias the exponent, round half to even
+        return bits >> shift;
+    }
+
+#if defined(TEXTURE_HDR_SSE)
+    // toSmallFloat(.., 10) with the sign, on 4 floats. Results in the low 16 bits of each lane
+    inline __m128i floatToHalf4(__m128 value)
+    {
+        const __m128i signMask = _mm_set1_epi32((int)0x80000000u);
+        const __m128i halfOverflow = _mm_set1_epi32(((127 + 16) << 23) - 1);
+        const __m128i floatInfinity = _mm_set1_epi32(0x7F800000);
+        const __m128i denormalLimit = _mm_set1_epi32(113 << 23);
+        const __m128i denormalMagic = _mm_set1_epi32(((127 - 15) + 13 + 1) << 23);
+        const __m128i rebias = _mm_set1_epi32((int)(((uint32_t)(15 - 127) << 23) + 0xFFFu));
+
+        __m128i bits = _mm_castps_si128(value);
+        __m128i sign = _mm_and_si128(bits, signMask);
+        bits = _mm_xor_si128(bits, sign);
+
+        __m128i isNan = _mm_cmpgt_epi32(bits, floatInfinity);
+        __m128i outOfRange = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(isNan, _mm_set1_epi32(0x0200)));
+        __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(denormalMagic))), denormalMagic);
+        __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+        __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(bits, rebias), mantissaOdd), 13);
+
+        __m128i isDenormal = _mm_cmplt_epi32(bits, denormalLimit);
+        __m128i isOutOfRange = _mm_cmpgt_epi32(bits, halfOverflow);
+        __m128i result = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+        result = _mm_or_si128(_mm_and_si128(isOutOfRange, outOfRange), _mm_andnot_si128(isOutOfRange, result));
+        return _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+    }
+#endif
+}
+
+inline uint16_t floatToHalf(float value)
+{
+    uint32_t bits = texture_hdr_detail::floatBits(value);
+    return (uint16_t)(((bits >> 16) & 0x8000u) | texture_hdr_detail::toSmallFloat(bits & 0x7FFFFFFFu, 10));
+}
+
+// 'count' floats to halves
+// ------------------------------------------------------------------------
+inline void floatToHalf(const float* source, uint16_t* result, size_t count)
+{
+    size_t i = 0;
+#if defined(TEXTURE_HDR_F16C)
+    for (; i + 8 <= count; i += 8)
+        _mm_storeu_si128((__m128i*)(result + i), _mm256_cvtps_ph(_mm256_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT));
+#elif defined(TEXTURE_HDR_SSE)
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i low = texture_hdr_detail::floatToHalf4(_mm_loadu_ps(source + i));
+        __m128i high = texture_hdr_detail::floatToHalf4(_mm_loadu_ps(source + i + 4));
+        // Sign extend the 16 bit results so the saturating pack leaves them as they are
+        low = _mm_srai_epi32(_mm_slli_epi32(low, 16), 16);
+        high = _mm_srai_epi32(_mm_slli_epi32(high, 16), 16);
+        _mm_storeu_si128((__m128i*)(result + i), _mm_packs_epi32(low, high));
+    }
+#endif
+    for (; i < count; i++)
+        result[i] = floatToHalf(source[i]);
+}
+
+// GL_R11F_G11F_B10F texel (GL_UNSIGNED_INT_10F_11F_11F_REV: red in the low bits). No sign: negative values clamp to 0, and
+// finite values too big for a channel to its largest finite value (the GL rule), only infinity stays infinity
+// ------------------------------------------------------------------------
+inline uint32_t packR11G11B10F(float r, float g, float b)
+{
+    auto channel = [](float value, int mantissaBits)
+    {
+        uint32_t bits = texture_hdr_detail::floatBits(value);
+        uint32_t magnitude = bits & 0x7FFFFFFFu;
+        if (magnitude > 0x7F800000u || magnitude == bits) // NaN (stays NaN) or positive
+        {
+            float maxFinite = 65536.0f - (float)(1 << (15 - mantissaBits));
+            if (magnitude < 0x7F800000u && value > maxFinite)
+                magnitude = texture_hdr_detail::floatBits(maxFinite);
+            return texture_hdr_detail::toSmallFloat(magnitude, mantissaBits);
+        }
+        return 0u;
+    };
+    return channel(r, 6) | (channel(g, 6) << 11) | (channel(b, 5) << 22);
+}
+
+// GL_RGB9_E5 texel (GL_UNSIGNED_INT_5_9_9_9_REV), as EXT_texture_shared_exponent packs it: the exponent fits the brightest
+// channel, the others lose the bits under it. Negative values and NaN clamp to 0, too big to the largest value
+// ------------------------------------------------------------------------
+inline uint32_t packRgb9E5(float r, float g, float b)
+{
+    const int mantissaBits = 9, exponentBias = 15, maxExponent = 31;
+    const float maxValue = (float)((1 << mantissaBits) - 1) / (float)(1 << mantissaBits) * (float)(1 << (maxExponent - exponentBias)); // 65408
+    auto clampChannel = [maxValue](float value) { return value > 0.0f ? std::min(value, maxValue) : 0.0f; }; // NaN fails > too
+    float rc = clampChannel(r), gc = clampChannel(g), bc = clampChannel(b);
+    float brightest = std::max(rc, std::max(gc, bc));
+
+    int exponent = -exponentBias - 1; // floor(log2(brightest)), at least -16
+    if (brightest > 0.0f)
+    {
+        int frexpExponent;
+        std::frexp(brightest, &frexpExponent); // brightest = m * 2^e, m in [0.5, 1)
+        exponent = std::max(exponent, frexpExponent - 1);
+    }
+    int sharedExponent = exponent + 1 + exponentBias;
+    float scale = std::ldexp(1.0f, mantissaBits + exponentBias - sharedExponent);
+    if ((int)std::floor(brightest * scale + 0.5f) == (1 << mantissaBits)) // Rounded up past 9 bits: one exponent more
+    {
+        sharedExponent++;
+        scale *= 0.5f;
+    }
+    uint32_t rm = (uint32_t)std::floor(rc * scale + 0.5f), gm = (uint32_t)std::floor(gc * scale + 0.5f), bm = (uint32_t)std::floor(bc * scale + 0.5f);
+    return rm | (gm << 9) | (bm << 18) | ((uint32_t)sharedExponent << 27);
+}
+
+// Next mip level of a float RGBA image: 2x2 box filter (the texels are linear already), same sizes as downsampleImage()
+// ------------------------------------------------------------------------
+inline void downsampleImageFloat(const float* source, int width, int height, std::vector<float>& result)
+{
+    int resultWidth = std::max(1, width / 2), resultHeight = std::max(1, height / 2);
+    result.resize((size_t)resultWidth * resultHeight * 4);
+    for (int y = 0; y < resultHeight; y++)
+    {
+        const float* row0 = source + (size_t)std::min(y * 2, height - 1) * width * 4;
+        const float* row1 = source + (size_t)std::min(y * 2 + 1, height - 1) * width * 4;
+        float* out = &result[(size_t)y * resultWidth * 4];
+        for (int x = 0; x < resultWidth; x++)
+        {
+            int x0 = std::min(x * 2, width - 1) * 4, x1 = std::min(x * 2 + 1, width - 1) * 4;
+            for (int c = 0; c < 4; c++)
+                out[x * 4 + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+        }
+    }
+}
+
+
+// A high precision image's whole mip chain, converted to its GPU format
+// ------------------------------------------------------------------------
+struct HdrMips
+{
+    int width = 0;
+    int height = 0;
+    ImagePrecision precision = ImagePrecision::Hdr;  // Of the source
+    HdrTextureFormat format = HdrTextureFormat::Rgba16F;
+    GLenum internalFormat = GL_RGBA16F;
+    GLenum uploadFormat = GL_RGBA;
+    GLenum uploadType = GL_HALF_FLOAT;
+    size_t bytesPerTexel = 8;
+    bool translucent = false;                        // Some texel isn't opaque (Rgba16F only: the other formats have no alpha)
+    std::vector<std::vector<unsigned char>> levels;  // levels[0] is the full size
+
+    bool valid() const { return !levels.empty(); }
+    size_t bytes() const
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < levels.size(); i++)
+            total += levels[i].size();
+        return total;
+    }
+};
+
+namespace texture_hdr_detail
+{
+    inline void convertLevel(const float* texels, size_t texelCount, HdrTextureFormat format, std::vector<unsigned char>& result)
+    {
+        if (format == HdrTextureFormat::Rgba16F)
+        {
+            result.resize(texelCount * 8);
+            floatToHalf(texels, (uint16_t*)result.data(), texelCount * 4);
+            return;
+        }
+        result.resize(texelCount * 4);
+        uint32_t* packed = (uint32_t*)result.data();
+        for (size_t t = 0; t < texelCount; t++)
+        {
+            const float* texel = texels + t * 4;
+            packed[t] = format == HdrTextureFormat::R11G11B10F ? packR11G11B10F(texel[0], texel[1], texel[2]) : packRgb9E5(texel[0], texel[1], texel[2]);
+        }
+    }
+}
+
+// Decode a .hdr or 16 bit image through the VFS, filter its whole mip chain in float and convert every level to 'format'.
+// 'colorSpace' is what a 16 bit image's texels hold (.hdr texels are always linear). Any thread (stbi's flip setting applies);
+// false if the image can't be read or is 8 bit
+// ------------------------------------------------------------------------
+inline bool decodeHdrMips(const char* path, ColorSpace colorSpace, HdrTextureFormat format, HdrMips& mips)
+{
+    mips = HdrMips();
+    AssetBlob blob = VirtualFS::get().open(path);
+    if (!blob.valid() || blob.size() == 0)
+    {
+        std::cout << "ERROR::TEXTURE::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+    mips.precision = imagePrecision(blob.data(), blob.size());
+    int width = 0, height = 0, colorChNum;
+    std::vector<float> level;
+    if (mips.precision == ImagePrecision::Hdr)
+    {
+        float* image = stbi_loadf_from_memory(blob.data(), (int)blob.size(), &width, &height, &colorChNum, 4);
+        if (image)
+            level.assign(image, image + (size_t)width * height * 4);
+        stbi_image_free(image);
+    }
+    else if (mips.precision == ImagePrecision::Unorm16)
+    {
+        stbi_us* image = stbi_load_16_from_memory(blob.data(), (int)blob.size(), &width, &height, &colorChNum, 4);
+        if (image)
+        {
+            level.resize((size_t)width * height * 4);
+            for (size_t i = 0; i < level.size(); i++)
+            {
+                float value = image[i] / 65535.0f;
+                bool decode = colorSpace == ColorSpace::Srgb && (i & 3) != 3; // Alpha is linear
+                level[i] = !decode ? value : value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+        }
+        stbi_image_free(image);
+    }
+    if (level.empty())
+    {
+        std::cout << "ERROR::TEXTURE::HDR_DECODE_FAILED: " << path << (mips.precision == ImagePrecision::Ldr8 ? " (8 bit image)" : "") << std::endl;
+        return false;
+    }
+
+    // Premultiplied alpha like the 8 bit textures (see premultiplyAlpha() in texture_master.h); formats without alpha stay opaque
+    if (format == HdrTextureFormat::Rgba16F)
+    {
+        for (size_t t = 0; t < level.size(); t += 4)
+        {
+            float alpha = level[t + 3];
+            if (alpha >= 1.0f)
+                continue;
+            mips.translucent = true;
+            level[t] *= alpha;
+            level[t + 1] *= alpha;
+            level[t + 2] *= alpha;
+        }
+    }
+
+    mips.width = width;
+    mips.height = height;
+    mips.format = format;
+    switch (format)
+    {
+    case HdrTextureFormat::Rgba16F:
+        mips.internalFormat = GL_RGBA16F;
+        mips.uploadFormat = GL_RGBA;
+        mips.uploadType = GL_HALF_FLOAT;
+        mips.bytesPerTexel = 8;
+        break;
+    case HdrTextureFormat::R11G11B10F:
+        mips.internalFormat = GL_R11F_G11F_B10F;
+        mips.uploadFormat = GL_RGB;
+        mips.uploadType = GL_UNSIGNED_INT_10F_11F_11F_REV;
+        mips.bytesPerTexel = 4;
+        break;
+    case HdrTextureFormat::Rgb9E5:
+        mips.internalFormat = GL_RGB9_E5;
+        mips.uploadFormat = GL_RGB;
+        mips.uploadType = GL_UNSIGNED_INT_5_9_9_9_REV;
+        mips.bytesPerTexel = 4;
+        break;
+    }
+
+    int levelCount = 1;
+    while ((width >> levelCount) > 0 || (height >> levelCount) > 0)
+        levelCount++;
+    mips.levels.resize(levelCount);
+    std::vector<float> next;
+    for (int l = 0; l < levelCount; l++)
+    {
+        int levelWidth = std::max(1, width >> l), levelHeight = std::max(1, height >> l);
+        if (l > 0)
+        {
+            downsampleImageFloat(level.data(), std::max(1, width >> (l - 1)), std::max(1, height >> (l - 1)), next);
+            level.swap(next);
+        }
+        texture_hdr_detail::convertLevel(level.data(), (size_t)levelWidth * levelHeight, format, mips.levels[l]);
+    }
+    return true;
+}
+
+// GL thread. A new GL_TEXTURE_2D holding every level of 'mips' (its filtering comes from a sampler or is set by the caller).
+// Leaves it bound to the active unit (invalidate a state cache that is in use afterwards)
+// ------------------------------------------------------------------------
+inline GLuint createHdrTexture(const HdrMips& mips)
+{
+    GLuint texture = createTexture2D(mips.internalFormat, mips.width, mips.height, (GLsizei)mips.levels.size());
+    for (size_t l = 0; l < mips.levels.size(); l++)
+        glTexSubImage2D(GL_TEXTURE_2D, (GLint)l, 0, 0, std::max(1, mips.width >> l), std::max(1, mips.height >> l), mips.uploadFormat, mips.uploadType,
+            mips.levels[l].data());
+    return texture;
+}
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef TEXTURE_MASTER_H
+#define TEXTURE_MASTER_H
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "virtual_fs.h" // Images are read through the VFS so they can come from an asset pack
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_MASTER_SSE 1
+#endif
+
+// Decode an image with stb_image from the bytes the VFS hands us (stbi_load_from_memory) instead of letting stbi_load fopen() it.
+// Same contract as stbi_load: returns NULL on failure, free the result with stbi_image_free()
+// ------------------------------------------------------------------------
+inline unsigned char* loadImage(const char* path, int* width, int* height, int* colorChNum, int desiredChannels)
+{
+    AssetBlob blob = VirtualFS::get().open(path);
+    if (!blob.valid() || blob.size() == 0)
+    {
+        std::cout << "ERROR::TEXTURE::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return NULL;
+    }
+    return stbi_load_from_memory(blob.data(), (int)blob.size(), width, height, colorChNum, desiredChannels);
+}
+
+// Color space of an image's texels. Color images (photos, albedo ...) are stored sRGB encoded: uploaded as GL_SRGB8_ALPHA8
+// the sampler decodes them to linear before filtering and blending, so the shaders never convert. Data images (normals,
+// masks, heights) are Linear and used as they are. Alpha is always linear
+// ------------------------------------------------------------------------
+enum class ColorSpace
+{
+    Srgb,
+    Linear
+};
+
+// sRGB <-> linear for 8 bit values (the piecewise curve of the sRGB standard, same as the GL_SRGB8 formats). Decode is a
+// table; encode searches the midpoints between the decoded values, so it rounds to the nearest code like the hardware
+struct SrgbTables
+{
+    float toLinear[256];
+    float midpoints[255]; // Linear value halfway between code i and i + 1
+
+    SrgbTables()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < 255; i++)
+            midpoints[i] = (toLinear[i] + toLinear[i + 1]) * 0.5f;
+    }
+};
+inline const SrgbTables& srgbTables()
+{
+    static const SrgbTables tables; // Built once, thread safe
+    return tables;
+}
+inline float srgbToLinear(unsigned char value) { return srgbTables().toLinear[value]; }
+inline unsigned char linearToSrgb(float value)
+{
+    const float* midpoints = srgbTables().midpoints;
+    return (unsigned char)(std::upper_bound(midpoints, midpoints + 255, value) - midpoints);
+}
+
+// Premultiplied alpha: color * alpha stored in the texture instead of the color alone. Filtering and blending then mix
+// colors weighted by their coverage (a transparent texel has no color left to bleed into its neighbours at the edges), and
+// one blend function, GL_ONE / GL_ONE_MINUS_SRC_ALPHA, composites everything (see BlendMode in gl_state_cache.h).
+// sRGB colors are multiplied in linear light and encoded again: premultiplied[alpha][code], built once (64 KB)
+struct PremultiplyTables
+{
+    unsigned char srgb[256][256];
+
+    PremultiplyTables()
+    {
+        for (int alpha = 0; alpha < 256; alpha++)
+            for (int code = 0; code < 256; code++)
+                srgb[alpha][code] = linearToSrgb(srgbToLinear((unsigned char)code) * (alpha / 255.0f));
+    }
+};
+inline const PremultiplyTables& premultiplyTables()
+{
+    static const PremultiplyTables tables;
+    return tables;
+}
+
+// Premultiply the colors of an RGBA8 image by their alpha, in place. An opaque texel doesn't change, so the SIMD loop
+// skips blocks of 4 opaque texels with one compare (all opaque images, the usual case, cost one pass over their alpha) and
+// multiplies the others: 16 bit lanes for linear images, the table for sRGB ones. Returns true if any texel isn't opaque
+// (the image needs blending)
+// ------------------------------------------------------------------------
+inline bool premultiplyAlpha(unsigned char* texels, size_t texelCount, ColorSpace colorSpace)
+{
+    const PremultiplyTables* tables = colorSpace == ColorSpace::Srgb ? &premultiplyTables() : NULL;
+    auto premultiplyTexel = [tables](unsigned char* texel)
+    {
+        unsigned int alpha = texel[3];
+        for (int c = 0; c < 3; c++)
+        {
+            unsigned int product = texel[c] * alpha + 128; // Rounded product / 255
+            texel[c] = tables ? tables->srgb[alpha][texel[c]] : (unsigned char)((product + (product >> 8)) >> 8);
+        }
+    };
+
+    bool translucent = false;
+    size_t i = 0;
+#if defined(TEXTURE_MASTER_SSE)
+    const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000u);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i colorLanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    const __m128i alphaTimes255 = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0); // Alpha is multiplied by 255 / 255: unchanged
+    const __m128i half = _mm_set1_epi16(128);
+    for (; i + 4 <= texelCount; i += 4)
+    {
+        unsigned char* block = texels + i * 4;
+        __m128i texels4 = _mm_loadu_si128((const __m128i*)block);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(texels4, alphaMask), alphaMask)) == 0xFFFF)
+            continue; // All 4 opaque
+        translucent = true;
+        if (tables)
+        {
+            for (int t = 0; t < 4; t++)
+                premultiplyTexel(block + t * 4);
+            continue;
+        }
+        // 2 texels per register as 16 bit lanes, each lane times its texel's alpha: t = c * a + 128, (t + (t >> 8)) >> 8
+        __m128i halves[2] = { _mm_unpacklo_epi8(texels4, zero), _mm_unpackhi_epi8(texels4, zero) };
+        for (int h = 0; h < 2; h++)
+        {
+            __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(halves[h], _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            alpha = _mm_or_si128(_mm_and_si128(alpha, colorLanes), alphaTimes255);
+            __m128i product = _mm_add_epi16(_mm_mullo_epi16(halves[h], alpha), half);
+            halves[h] = _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+        }
+        _mm_storeu_si128((__m128i*)block, _mm_packus_epi16(halves[0], halves[1]));
+    }
+#endif
+    for (; i < texelCount; i++)
+    {
+        unsigned char* texel = texels + i * 4;
+        if (texel[3] == 255)
+            continue;
+        translucent = true;
+        premultiplyTexel(texel);
+    }
+    return translucent;
+}
+
+// Next mip level of an RGBA8 image: 2x2 box filter, max(1, size / 2) on each side (the last row / column repeats on odd sizes).
+// sRGB images are averaged in linear space (averaging the encoded values darkens every level a little more)
+// ------------------------------------------------------------------------
+inline void downsampleImage(const unsigned char* source, int width, int height, std::vector<unsigned char>& result, ColorSpace colorSpace = ColorSpace::Linear)
+{
+    int resultWidth = std::max(1, width / 2), resultHeight = std::max(1, height / 2);
+    result.resize((size_t)resultWidth * resultHeight * 4);
+    const float* toLinear = srgbTables().toLinear;
+    for (int y = 0; y < resultHeight; y++)
+    {
+        const unsigned char* row0 = source + (size_t)std::min(y * 2, height - 1) * width * 4;
+        const unsigned char* row1 = source + (size_t)std::min(y * 2 + 1, height - 1) * width * 4;
+        unsigned char* out = &result[(size_t)y * resultWidth * 4];
+        for (int x = 0; x < resultWidth; x++)
+        {
+            int x0 = std::min(x * 2, width - 1) * 4, x1 = std::min(x * 2 + 1, width - 1) * 4;
+            int linearChannels = colorSpace == ColorSpace::Srgb ? 3 : 0;
+            for (int c = 0; c < linearChannels; c++)
+                out[x * 4 + c] = linearToSrgb((toLinear[row0[x0 + c]] + toLinear[row0[x1 + c]] + toLinear[row1[x0 + c]] + toLinear[row1[x1 + c]]) * 0.25f);
+            for (int c = linearChannels; c < 4; c++)
+                out[x * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+#endif
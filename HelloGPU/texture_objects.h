@@ -0,0 +1,181 @@
+#ifndef TEXTURE_OBJECTS_H
+#define TEXTURE_OBJECTS_H
+
+// Texture storage and sampler objects.
+//
+// createTexture2D() allocates every level of a texture at once with glTexStorage2D (GL_ARB_texture_storage) when the
+// driver has it. Immutable storage can't change size, format or level count afterwards, so the driver knows the texture
+// is complete when it's created and doesn't have to check again at every draw that samples it. Without the extension
+// it falls back to one glTexImage2D per level (with GL_TEXTURE_MAX_LEVEL set, so the texture is just as complete).
+// Textures whose levels come and go (texture_streaming.h) have to stay mutable and don't use it.
+//
+// Filtering & wrapping live in sampler objects (core in 3.3) instead of in each texture: a sampler bound to a unit
+// overrides the parameters of whatever texture is bound there. SamplerCache hands out one sampler per distinct state, so
+// textures that filter the same way share it, and switching filtering is a bind (see GLStateCache::bindSampler). Sampler 0
+// means "use the texture's own parameters" (render targets and virtual textures set theirs once)
+//
+// Texture quality tiers (TextureQuality) gather the knobs that trade sampling cost & texture memory for sharpness in one
+// place: anisotropy, mip bias, trilinear or not, and the finest mip level the streaming keeps on the GPU. Switching tiers
+// only swaps samplers and moves the streaming's finest level, nothing is reloaded
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gl_extensions.h"
+
+// Pixel format & type glTexImage2D wants for an internal format (the data pointer is NULL, but they must be valid)
+// ------------------------------------------------------------------------
+inline void textureUploadFormat(GLenum internalFormat, GLenum& format, GLenum& type)
+{
+    switch (internalFormat)
+    {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+        format = GL_DEPTH_COMPONENT;
+        type = GL_FLOAT;
+        break;
+    case GL_RGBA16F:
+    case GL_RGBA32F:
+        format = GL_RGBA;
+        type = GL_FLOAT;
+        break;
+    case GL_R11F_G11F_B10F:
+    case GL_RGB9_E5:
+        format = GL_RGB;
+        type = GL_FLOAT;
+        break;
+    default:
+        format = GL_RGBA;
+        type = GL_UNSIGNED_BYTE;
+        break;
+    }
+}
+
+// A new GL_TEXTURE_2D with 'levels' levels allocated (contents undefined, fill them with glTexSubImage2D), immutable where
+// the driver supports it. Leaves it bound to the active unit (invalidate a state cache that is in use afterwards)
+// ------------------------------------------------------------------------
+inline GLuint createTexture2D(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei levels = 1)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (glExtensions().textureStorage)
+    {
+        glExtensions().glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+        return texture;
+    }
+    GLenum format, type;
+    textureUploadFormat(internalFormat, format, type);
+    for (GLsizei level = 0; level < levels; level++)
+    {
+        GLsizei levelWidth = width >> level, levelHeight = height >> level;
+        glTexImage2D(GL_TEXTURE_2D, level, internalFormat, levelWidth > 0 ? levelWidth : 1, levelHeight > 0 ? levelHeight : 1, 0, format, type, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    return texture;
+}
+
+// Sampler state. Two equal descriptions get the same sampler object
+// ------------------------------------------------------------------------
+struct SamplerDesc
+{
+    GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLenum magFilter = GL_LINEAR;
+    GLenum wrapS = GL_REPEAT;
+    GLenum wrapT = GL_REPEAT;
+    float maxAnisotropy = 1.0f; // 1 = isotropic. Clamped to what the driver takes, ignored without anisotropic filtering
+    float lodBias = 0.0f;       // Added to the mip level the sampler computes (> 0: blurrier, fewer texels fetched)
+
+    bool operator==(const SamplerDesc& other) const
+    {
+        return minFilter == other.minFilter && magFilter == other.magFilter && wrapS == other.wrapS && wrapT == other.wrapT
+            && maxAnisotropy == other.maxAnisotropy && lodBias == other.lodBias;
+    }
+};
+
+class SamplerCache
+{
+public:
+    ~SamplerCache() { release(); }
+
+    // GL thread. The sampler object for 'desc', created the first time it's asked for
+    GLuint get(const SamplerDesc& desc)
+    {
+        for (size_t i = 0; i < entries.size(); i++)
+            if (entries[i].desc == desc)
+                return entries[i].sampler;
+        Entry entry;
+        entry.desc = desc;
+        glGenSamplers(1, &entry.sampler);
+        glSamplerParameteri(entry.sampler, GL_TEXTURE_MIN_FILTER, (GLint)desc.minFilter);
+        glSamplerParameteri(entry.sampler, GL_TEXTURE_MAG_FILTER, (GLint)desc.magFilter);
+        glSamplerParameteri(entry.sampler, GL_TEXTURE_WRAP_S, (GLint)desc.wrapS);
+        glSamplerParameteri(entry.sampler, GL_TEXTURE_WRAP_T, (GLint)desc.wrapT);
+        glSamplerParameterf(entry.sampler, GL_TEXTURE_LOD_BIAS, desc.lodBias);
+        if (glExtensions().textureFilterAnisotropic && desc.maxAnisotropy > 1.0f)
+            glSamplerParameterf(entry.sampler, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(desc.maxAnisotropy, glExtensions().maxTextureAnisotropy));
+        entries.push_back(entry);
+        return entry.sampler;
+    }
+
+    size_t size() const { return entries.size(); }
+
+    // GL thread
+    void release()
+    {
+        for (size_t i = 0; i < entries.size(); i++)
+            glDeleteSamplers(1, &entries[i].sampler);
+        entries.clear();
+    }
+
+private:
+    struct Entry
+    {
+        SamplerDesc desc;
+        GLuint sampler = 0;
+    };
+    std::vector<Entry> entries;
+};
+
+// Texture quality tiers, cheapest first
+// ------------------------------------------------------------------------
+enum class TextureQuality { Low, Medium, High, Ultra };
+const int TEXTURE_QUALITY_COUNT = 4;
+
+struct TextureQualityTier
+{
+    const char* name;
+    float maxAnisotropy;  // Texels blended along the direction a surface is stretched in (glancing angles); each one is a fetch
+    float lodBias;        // > 0 samples coarser levels: less bandwidth & cache misses, blurrier
+    bool trilinear;       // Blend two mip levels (twice the fetches) or take the nearest one (a visible seam where the level changes)
+    int finestLevel;      // Finest mip level the streaming keeps resident: 1 = never the full size level (a quarter of the memory)
+};
+
+inline const TextureQualityTier& textureQualityTier(TextureQuality quality)
+{
+    static const TextureQualityTier tiers[TEXTURE_QUALITY_COUNT] =
+    {
+        { "Low",    1.0f,  1.0f, false, 2 },
+        { "Medium", 2.0f,  0.5f, true,  1 },
+        { "High",   8.0f,  0.0f, true,  0 },
+        { "Ultra",  16.0f, 0.0f, true,  0 },
+    };
+    return tiers[std::min(std::max((int)quality, 0), TEXTURE_QUALITY_COUNT - 1)];
+}
+
+// 'desc' as sampled at a quality tier: its wrapping & magnification stay, the tier sets anisotropy, bias and the mip filter
+// (only of samplers that use mipmaps: one that samples a single level stays that way)
+// ------------------------------------------------------------------------
+inline SamplerDesc applyTextureQuality(SamplerDesc desc, const TextureQualityTier& tier)
+{
+    desc.maxAnisotropy = tier.maxAnisotropy;
+    desc.lodBias = tier.lodBias;
+    if (desc.minFilter == GL_LINEAR_MIPMAP_LINEAR || desc.minFilter == GL_LINEAR_MIPMAP_NEAREST)
+        desc.minFilter = tier.trilinear ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR_MIPMAP_NEAREST;
+    return desc;
+}
+
+#endif
@@ -0,0 +1,399 @@
+#ifndef TEXTURE_STREAMING_H
+#define TEXTURE_STREAMING_H
+
+// Mip level streaming. A texture starts with only its mip tail on the GPU (the levels no bigger than a few dozen texels)
+// and GL_TEXTURE_BASE_LEVEL clamped to the finest of them, so loading uploads a few KB instead of the whole chain. Every
+// frame the draws tell the streamer how many pixels one texture repeat covers on screen at most (request()), which gives
+// the finest level the sampler can pick. Missing levels are decoded on the job system and uploaded on the GL thread
+// (update()), then the base level moves down to them.
+//
+// Levels stay once they are loaded, even when nothing needs them anymore, until the resident bytes would go over the
+// budget: then the least recently needed ones are dropped (base level moved up, the level freed with a 0x0 image). With
+// GL 3.3 mutable textures the levels under the base level don't have to exist, so levels that aren't loaded take no memory.
+//
+// The sources are PNGs, which only decode whole: streaming a level in decodes the image again and box filters it down to
+// the levels asked for (the full size image only lives for the length of the job). sRGB images are filtered in linear space
+// and uploaded as GL_SRGB8_ALPHA8 (see ColorSpace in texture_master.h). Colors are premultiplied by alpha right after the
+// decode (premultiplyAlpha()), so every level is filtered and stored premultiplied
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gl_state_cache.h"
+#include "job_system.h"
+#include "redraw_tracker.h"
+#include "texture_master.h"
+
+const int TEXTURE_MAX_LEVELS = 16; // Up to 32768 x 32768
+
+// Some levels of an image's mip chain, RGBA8, filtered on the CPU
+struct DecodedMips
+{
+    int width = 0;       // Of level 0
+    int height = 0;
+    int levelCount = 0;  // Of the whole chain (down to 1x1)
+    int firstLevel = 0;  // levels[0] is this level, levels[1] the next one ...
+    ColorSpace colorSpace = ColorSpace::Srgb;
+    bool translucent = false; // Some texel isn't opaque. The levels hold premultiplied alpha either way
+    std::vector<std::vector<unsigned char>> levels;
+
+    bool valid() const { return !levels.empty(); }
+};
+
+inline int mipLevelCount(int width, int height)
+{
+    int levels = 1;
+    while ((width >> levels) > 0 || (height >> levels) > 0)
+        levels++;
+    return levels;
+}
+inline int mipSize(int size, int level) { return std::max(1, size >> level); }
+inline size_t mipLevelBytes(int width, int height, int level) { return (size_t)mipSize(width, level) * mipSize(height, level) * 4; }
+
+// GL format of an RGBA8 image in 'colorSpace': the sampler decodes sRGB textures to linear before it filters
+inline GLenum textureInternalFormat(ColorSpace colorSpace) { return colorSpace == ColorSpace::Srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8; }
+
+namespace texture_streaming_detail
+{
+    // Decode 'path' and keep levels [firstLevel, lastLevel] of its chain (lastLevel < 0: down to 1x1). With tailSize > 0
+    // firstLevel is the first level whose larger side is at most tailSize instead
+    inline bool decodeLevels(const char* path, ColorSpace colorSpace, int tailSize, int firstLevel, int lastLevel, DecodedMips& mips)
+    {
+        mips = DecodedMips();
+        mips.colorSpace = colorSpace;
+        int width, height, colorChNum;
+        unsigned char* image = loadImage(path, &width, &height, &colorChNum, 4);
+        if (!image)
+            return false;
+        mips.translucent = premultiplyAlpha(image, (size_t)width * height, colorSpace); // Before filtering, so the levels average premultiplied colors
+        mips.width = width;
+        mips.height = height;
+        mips.levelCount = std::min(mipLevelCount(width, height), TEXTURE_MAX_LEVELS);
+        if (tailSize > 0)
+        {
+            firstLevel = 0;
+            while (firstLevel + 1 < mips.levelCount && std::max(mipSize(width, firstLevel), mipSize(height, firstLevel)) > tailSize)
+                firstLevel++;
+        }
+        if (lastLevel < 0 || lastLevel >= mips.levelCount)
+            lastLevel = mips.levelCount - 1;
+        mips.firstLevel = std::min(std::max(firstLevel, 0), lastLevel);
+
+        // Filter level by level, only keeping a copy of the ones asked for
+        std::vector<unsigned char> current, next;
+        const unsigned char* level = image;
+        for (int l = 0; l <= lastLevel; l++)
+        {
+            if (l > 0)
+            {
+                downsampleImage(level, mipSize(width, l - 1), mipSize(height, l - 1), next, colorSpace);
+                current.swap(next);
+                level = current.data();
+                if (l == 1)
+                {
+                    stbi_image_free(image); // Level 0 isn't needed anymore
+                    image = NULL;
+                }
+            }
+            if (l >= mips.firstLevel)
+                mips.levels.emplace_back(level, level + mipLevelBytes(width, height, l));
+        }
+        stbi_image_free(image);
+        return true;
+    }
+}
+
+// Decode an image and filter it down to its mip tail: the levels whose larger side is at most 'tailSize' texels (what a
+// streamed texture starts with). 'colorSpace' is what the texels hold, it is kept in 'mips'. Any thread; false if the
+// image can't be read
+// ------------------------------------------------------------------------
+inline bool decodeMipTail(const char* path, ColorSpace colorSpace, int tailSize, DecodedMips& mips)
+{
+    return texture_streaming_detail::decodeLevels(path, colorSpace, std::max(tailSize, 1), 0, -1, mips);
+}
+
+// Decode an image and keep levels [firstLevel, lastLevel] of its chain. Any thread; false if the image can't be read
+// ------------------------------------------------------------------------
+inline bool decodeMipLevels(const char* path, ColorSpace colorSpace, int firstLevel, int lastLevel, DecodedMips& mips)
+{
+    return texture_streaming_detail::decodeLevels(path, colorSpace, 0, firstLevel, lastLevel, mips);
+}
+
+struct TextureStreamingSettings
+{
+    size_t budgetBytes = 32u << 20; // Resident levels of all streamed textures; over it, levels nobody needs are dropped
+    int maxPendingDecodes = 2;      // Textures being decoded at once (each one decodes a whole image)
+    int finestLevel = 0;            // Levels finer than this are never streamed in (the tail is always kept), see setFinestLevel()
+};
+
+struct TextureStreamingStats
+{
+    size_t residentBytes = 0;      // On the GPU now (level bytes as uploaded, RGBA8)
+    size_t fullChainBytes = 0;     // If every level of every texture were loaded
+    unsigned int textures = 0;
+    unsigned int levelsStreamed = 0; // Since the start
+    unsigned int levelsDropped = 0;
+    unsigned int pendingDecodes = 0;
+};
+
+class TextureStreamer
+{
+public:
+    explicit TextureStreamer(const TextureStreamingSettings& settings = TextureStreamingSettings()) : settings(settings) {}
+    ~TextureStreamer()
+    {
+        // The decode jobs write into the requests
+        for (size_t i = 0; i < entries.size(); i++)
+            if (entries[i].pending)
+                JobSystem::get().wait(entries[i].pending->done);
+    }
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // GL thread, at load. Upload the decoded tail into 'texture' (its wrap / filter parameters are left as they are), clamp
+    // its base level to it, and stream the rest of the chain from 'path' from now on, in the tail's color space. Binds with glBindTexture (invalidate a
+    // state cache that is in use afterwards). False if 'tail' is empty (the image failed to decode)
+    // ------------------------------------------------------------------------
+    bool add(GLuint texture, const char* path, const DecodedMips& tail)
+    {
+        if (!tail.valid())
+            return false;
+        Entry entry;
+        entry.texture = texture;
+        entry.path = path;
+        entry.width = tail.width;
+        entry.height = tail.height;
+        entry.levelCount = tail.levelCount;
+        entry.colorSpace = tail.colorSpace;
+        entry.tailLevel = entry.residentLevel = tail.firstLevel;
+        entry.requestedLevel = entry.wantedLevel = tail.firstLevel;
+        for (int l = 0; l < TEXTURE_MAX_LEVELS; l++)
+            entry.lastNeeded[l] = 0;
+
+        glBindTexture(GL_TEXTURE_2D, texture);
+        upload(entry, tail);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry.levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.residentLevel);
+
+        currentStats.textures++;
+        for (int l = 0; l < entry.levelCount; l++)
+            currentStats.fullChainBytes += mipLevelBytes(entry.width, entry.height, l);
+        for (int l = entry.residentLevel; l < entry.levelCount; l++)
+            currentStats.residentBytes += mipLevelBytes(entry.width, entry.height, l);
+        entries.push_back(std::move(entry));
+        return true;
+    }
+
+    // Render side, while going over the draws of a frame: a draw samples 'texture' with one texture repeat (0..1 texcoords)
+    // covering about 'pixelsPerTexcoord' pixels on screen. The finest level the draws of the frame ask for is streamed in
+    // ------------------------------------------------------------------------
+    void request(GLuint texture, float pixelsPerTexcoord)
+    {
+        Entry* entry = find(texture);
+        if (!entry || !(pixelsPerTexcoord > 0.0f))
+            return;
+        // The sampler picks level log2(texels per pixel); linear mip filtering also blends in the next coarser one
+        float texelsPerPixel = (float)std::max(entry->width, entry->height) / pixelsPerTexcoord;
+        int level = texelsPerPixel <= 1.0f ? 0 : (int)std::floor(std::log2(texelsPerPixel));
+        entry->requestedLevel = std::min(entry->requestedLevel, std::min(level, entry->levelCount - 1));
+    }
+
+    // GL thread. Cap the finest level every texture streams to (a texture quality tier's max resident mip). Takes effect at
+    // the next update(): levels finer than the cap are dropped right away, whatever the budget
+    // ------------------------------------------------------------------------
+    void setFinestLevel(int level) { settings.finestLevel = std::max(level, 0); }
+
+    // GL thread, once per frame after the requests: uploads the levels that finished decoding, drops unneeded levels if
+    // the budget needs the room, and starts decoding what is missing (a finished decode asks for a redraw, see
+    // redraw_tracker.h). Binds through 'stateCache' (unit 0). Returns true when a texture got new levels
+    // ------------------------------------------------------------------------
+    bool update(GLStateCache& stateCache)
+    {
+        frame++;
+        bool streamedIn = false;
+
+        // What this frame needed. A texture nobody drew only needs its tail
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            Entry& entry = entries[i];
+            entry.wantedLevel = std::min(std::max(entry.requestedLevel, settings.finestLevel), entry.tailLevel);
+            entry.requestedLevel = entry.levelCount;
+            for (int l = entry.wantedLevel; l < entry.levelCount; l++)
+                entry.lastNeeded[l] = frame;
+            // Finer than the cap (it was just raised): no frame may use them anymore, the memory goes back now
+            while (!entry.pending && entry.residentLevel < std::min(settings.finestLevel, entry.tailLevel))
+                dropLevel(entry, stateCache);
+        }
+
+        // Finished decodes -> GPU, base level down to them
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            Entry& entry = entries[i];
+            if (!entry.pending || !entry.pending->done.done())
+                continue;
+            std::unique_ptr<StreamRequest> request = std::move(entry.pending);
+            currentStats.pendingDecodes--;
+            pendingBytes -= request->bytes;
+            if (!request->decoded || !request->mips.valid() || request->mips.width != entry.width || request->mips.height != entry.height)
+            {
+                std::cout << "ERROR::TEXTURE::STREAMING_FAILED: " << entry.path << " stays at level " << entry.residentLevel << std::endl;
+                entry.failed = true;
+                continue;
+            }
+            stateCache.bindTextureForEdit(0, GL_TEXTURE_2D, entry.texture);
+            upload(entry, request->mips);
+            int firstLevel = request->mips.firstLevel;
+            for (int l = firstLevel; l < entry.residentLevel; l++)
+                currentStats.residentBytes += mipLevelBytes(entry.width, entry.height, l);
+            currentStats.levelsStreamed += entry.residentLevel - firstLevel;
+            entry.residentLevel = firstLevel;
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.residentLevel);
+            streamedIn = true;
+        }
+
+        // Start decoding what's missing, making room first if the budget asks for it
+        for (size_t i = 0; i < entries.size() && currentStats.pendingDecodes < (unsigned int)settings.maxPendingDecodes; i++)
+        {
+            Entry& entry = entries[i];
+            if (entry.pending || entry.failed || entry.wantedLevel >= entry.residentLevel)
+                continue;
+            int lastLevel = entry.residentLevel - 1;
+            int firstLevel = entry.wantedLevel;
+            size_t bytes = levelBytes(entry, firstLevel, lastLevel);
+            while (currentStats.residentBytes + pendingBytes + bytes > settings.budgetBytes)
+                if (!dropLeastRecentlyNeeded(stateCache))
+                    break;
+            // Still too big: as many of the levels next to the resident ones as fit
+            while (firstLevel <= lastLevel && currentStats.residentBytes + pendingBytes + bytes > settings.budgetBytes)
+            {
+                bytes -= mipLevelBytes(entry.width, entry.height, firstLevel);
+                firstLevel++;
+            }
+            if (firstLevel > lastLevel)
+                continue;
+
+            entry.pending.reset(new StreamRequest());
+            StreamRequest* request = entry.pending.get();
+            request->bytes = bytes;
+            pendingBytes += bytes;
+            currentStats.pendingDecodes++;
+            std::string path = entry.path;
+            ColorSpace colorSpace = entry.colorSpace;
+            JobSystem::get().run([request, path, colorSpace, firstLevel, lastLevel]()
+            {
+                request->decoded = decodeMipLevels(path.c_str(), colorSpace, firstLevel, lastLevel, request->mips);
+                RedrawTracker::get().requestRender(); // Wake a render-on-demand loop: the next frame uploads it
+            }, &request->done);
+        }
+
+        return streamedIn;
+    }
+
+    // Finest level of 'texture' on the GPU now (its base level), -1 if it isn't streamed
+    int residentLevel(GLuint texture) const
+    {
+        for (size_t i = 0; i < entries.size(); i++)
+            if (entries[i].texture == texture)
+                return entries[i].residentLevel;
+        return -1;
+    }
+
+    const TextureStreamingStats& stats() const { return currentStats; }
+
+private:
+    struct StreamRequest
+    {
+        JobCounter done;
+        DecodedMips mips;
+        bool decoded = false;
+        size_t bytes = 0;
+    };
+
+    struct Entry
+    {
+        GLuint texture = 0;
+        std::string path;
+        int width = 0, height = 0, levelCount = 0;
+        ColorSpace colorSpace = ColorSpace::Srgb; // Every level is uploaded in the same format
+        int tailLevel = 0;       // Finest level of the tail (loaded at add(), never dropped)
+        int residentLevel = 0;   // Finest level on the GPU = GL_TEXTURE_BASE_LEVEL
+        int requestedLevel = 0;  // Finest level asked for so far this frame
+        int wantedLevel = 0;     // Finest level the last frame needed
+        uint64_t lastNeeded[TEXTURE_MAX_LEVELS]; // Frame each level was last needed, to drop the least recently needed first
+        std::unique_ptr<StreamRequest> pending;  // Decode in flight
+        bool failed = false;     // Don't retry a file that didn't decode
+    };
+
+    Entry* find(GLuint texture)
+    {
+        for (size_t i = 0; i < entries.size(); i++)
+            if (entries[i].texture == texture)
+                return &entries[i];
+        return NULL;
+    }
+
+    static size_t levelBytes(const Entry& entry, int firstLevel, int lastLevel)
+    {
+        size_t bytes = 0;
+        for (int l = firstLevel; l <= lastLevel; l++)
+            bytes += mipLevelBytes(entry.width, entry.height, l);
+        return bytes;
+    }
+
+    // The texture must be bound (unit 0)
+    static void upload(const Entry& entry, const DecodedMips& mips)
+    {
+        for (size_t i = 0; i < mips.levels.size(); i++)
+        {
+            int level = mips.firstLevel + (int)i;
+            glTexImage2D(GL_TEXTURE_2D, level, textureInternalFormat(entry.colorSpace), mipSize(entry.width, level), mipSize(entry.height, level), 0, GL_RGBA,
+                GL_UNSIGNED_BYTE, mips.levels[i].data());
+        }
+    }
+
+    // Free the finest level of the texture whose finest level went unneeded the longest. False if no level can go (every
+    // texture needs all it has, only has its tail, or is waiting for a decode)
+    bool dropLeastRecentlyNeeded(GLStateCache& stateCache)
+    {
+        Entry* victim = NULL;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            Entry& entry = entries[i];
+            if (entry.pending || entry.residentLevel >= entry.tailLevel || entry.residentLevel >= entry.wantedLevel)
+                continue;
+            if (!victim || entry.lastNeeded[entry.residentLevel] < victim->lastNeeded[victim->residentLevel])
+                victim = &entry;
+        }
+        if (!victim)
+            return false;
+        dropLevel(*victim, stateCache);
+        return true;
+    }
+
+    // Free the finest resident level of 'entry'
+    void dropLevel(Entry& entry, GLStateCache& stateCache)
+    {
+        int level = entry.residentLevel;
+        stateCache.bindTextureForEdit(0, GL_TEXTURE_2D, entry.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1); // Out of the sampled range before it goes
+        glTexImage2D(GL_TEXTURE_2D, level, textureInternalFormat(entry.colorSpace), 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        entry.residentLevel = level + 1;
+        currentStats.residentBytes -= mipLevelBytes(entry.width, entry.height, level);
+        currentStats.levelsDropped++;
+    }
+
+    TextureStreamingSettings settings;
+    std::vector<Entry> entries;
+    size_t pendingBytes = 0; // Of the decodes in flight, counted against the budget already
+    uint64_t frame = 0;
+    TextureStreamingStats currentStats;
+};
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+// Parent/child transforms stored breadth-first in flat arrays: every node of depth d comes before every node of depth d + 1,
+// and the children of a node are next to each other. A world matrix is parent world * local, so walking the arrays in order
+// always finds the parent already done - no recursion, no pointer chasing, and each depth level is one parallel loop
+//
+// Only what changed is recomputed: setLocal() flags the node, and update() recomputes a node if it is flagged or its parent
+// was recomputed this update (the flag flows down the levels), so a static subtree costs one byte read per node
+//
+// Nodes are referred to by a handle that doesn't change when the arrays are reordered (adding nodes re-sorts them):
+//
+//     uint32_t body = hierarchy.addNode(TransformHierarchy::NO_PARENT, vec3(0, 0, 0), quatIdentity(), vec3(1, 1, 1));
+//     uint32_t arm = hierarchy.addNode(body, vec3(1, 0, 0), quatIdentity(), vec3(0.5f, 0.5f, 0.5f));
+//     hierarchy.setLocal(body, position, rotation, scale); // Any thread, as long as two threads don't set the same node
+//     hierarchy.update(); // Recomputes body and arm
+//     const Mat4& armWorld = hierarchy.world(arm);
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "job_system.h"
+#include "simd_math.h"
+
+class TransformHierarchy
+{
+public:
+    enum : uint32_t { NO_PARENT = 0xFFFFFFFFu }; // Parent of roots (an enum so it can be passed by reference without a definition)
+
+    // Levels are split over the job system in chunks of this many nodes; levels under two chunks run on the calling thread
+    size_t parallelGrain = 4096;
+
+    // New node (parent must already exist). Returns its handle. The layout is rebuilt at the next update()
+    // ------------------------------------------------------------------------
+    uint32_t addNode(uint32_t parentHandle, const Vec3& position, const Quat& rotation, const Vec3& scale)
+    {
+        if (!layoutDirty)
+            syncPendingLocals();
+        uint32_t handle = (uint32_t)indexOfHandle.size();
+        pendingParents.push_back(parentHandle);
+        pendingLocals.push_back(Local{ position, rotation, scale });
+        indexOfHandle.push_back(NO_PARENT); // Placed by rebuildLayout()
+        layoutDirty = true;
+        return handle;
+    }
+
+    // Change a node's local transform (relative to its parent). Its subtree is recomputed at the next update()
+    // ------------------------------------------------------------------------
+    void setLocal(uint32_t handle, const Vec3& position, const Quat& rotation, const Vec3& scale)
+    {
+        if (layoutDirty)
+        {
+            pendingLocals[handle] = Local{ position, rotation, scale };
+            return;
+        }
+        uint32_t index = indexOfHandle[handle];
+        locals[index] = Local{ position, rotation, scale };
+        dirty[index] = 1;
+    }
+
+    // Same, keeping the node's scale (animation usually only moves and turns things)
+    void setLocal(uint32_t handle, const Vec3& position, const Quat& rotation)
+    {
+        if (layoutDirty)
+        {
+            setLocal(handle, position, rotation, pendingLocals[handle].scale);
+            return;
+        }
+        setLocal(handle, position, rotation, locals[indexOfHandle[handle]].scale);
+    }
+
+    // Recompute the world matrix of every dirty node and of everything below it. Returns how many were recomputed
+    // ------------------------------------------------------------------------
+    size_t update()
+    {
+        if (layoutDirty)
+            rebuildLayout();
+
+        std::atomic<size_t> recomputed{ 0 };
+        for (size_t level = 0; level + 1 < levelStart.size(); level++)
+        {
+            size_t begin = levelStart[level], end = levelStart[level + 1];
+            auto updateRange = [this, &recomputed](size_t rangeBegin, size_t rangeEnd)
+            {
+                size_t count = 0;
+                for (size_t i = rangeBegin; i < rangeEnd; i++)
+                {
+                    uint32_t parent = parents[i];
+                    // The parent's flag is still set if it was recomputed in this update: its children follow
+                    if (!dirty[i] && (parent == NO_PARENT || !dirty[parent]))
+                        continue;
+                    dirty[i] = 1;
+                    const Local& local = locals[i];
+                    if (parent == NO_PARENT)
+                        worlds[i] = mat4FromTRS(local.position, local.rotation, local.scale);
+                    else
+                        mat4Multiply(worlds[parent], mat4FromTRS(local.position, local.rotation, local.scale), worlds[i]);
+                    count++;
+                }
+                recomputed.fetch_add(count, std::memory_order_relaxed);
+            };
+            if (end - begin >= parallelGrain * 2)
+                JobSystem::get().parallelFor(end - begin, parallelGrain, [&updateRange, begin](size_t rangeBegin, size_t rangeEnd) { updateRange(begin + rangeBegin, begin + rangeEnd); });
+            else
+                updateRange(begin, end);
+        }
+        // Every flag has been consumed (a level only reads the flags of the level above, so they can all go at the end)
+        if (!dirty.empty())
+            std::memset(dirty.data(), 0, dirty.size());
+        return recomputed.load(std::memory_order_relaxed);
+    }
+
+    const Mat4& world(uint32_t handle) const { return worlds[indexOfHandle[handle]]; }
+
+    size_t nodeCount() const { return indexOfHandle.size(); }
+    size_t levelCount() const { return levelStart.empty() ? 0 : levelStart.size() - 1; }
+
+private:
+    struct Local
+    {
+        Vec3 position;
+        Quat rotation;
+        Vec3 scale;
+    };
+
+    // Breadth-first arrays, all indexed by layout position
+    std::vector<uint32_t> parents; // Layout index of the parent, NO_PARENT for roots
+    std::vector<Local> locals;
+    std::vector<Mat4> worlds;
+    std::vector<uint8_t> dirty;
+    std::vector<size_t> levelStart; // Level d is [levelStart[d], levelStart[d + 1])
+
+    std::vector<uint32_t> indexOfHandle; // Handle -> layout index
+    std::vector<uint32_t> handleOfIndex;
+
+    // Nodes by handle, as added; the source of every rebuild
+    std::vector<uint32_t> pendingParents; // Parent handle
+    std::vector<Local> pendingLocals;
+    bool layoutDirty = false;
+
+    // While the layout is valid setLocal() writes the layout arrays: copy them back before the layout goes stale
+    void syncPendingLocals()
+    {
+        for (size_t index = 0; index < locals.size(); index++)
+            pendingLocals[handleOfIndex[index]] = locals[index];
+    }
+
+    // Sort the nodes breadth-first: roots in handle order, then the children of each node of a level in the order of
+    // their parents. Every node comes out dirty
+    void rebuildLayout()
+    {
+        size_t count = pendingParents.size();
+        // Children of every handle, grouped (counting sort on the parent handle)
+        std::vector<uint32_t> childStart(count + 1, 0);
+        for (size_t handle = 0; handle < count; handle++)
+            if (pendingParents[handle] != NO_PARENT)
+                childStart[pendingParents[handle] + 1]++;
+        for (size_t handle = 0; handle < count; handle++)
+            childStart[handle + 1] += childStart[handle];
+        std::vector<uint32_t> children(childStart[count]);
+        std::vector<uint32_t> fill(childStart.begin(), childStart.end() - 1);
+        for (size_t handle = 0; handle < count; handle++)
+            if (pendingParents[handle] != NO_PARENT)
+                children[fill[pendingParents[handle]]++] = (uint32_t)handle;
+
+        std::vector<uint32_t> order; // Layout index -> handle
+        order.reserve(count);
+        for (size_t handle = 0; handle < count; handle++)
+            if (pendingParents[handle] == NO_PARENT)
+                order.push_back((uint32_t)handle);
+        levelStart.assign(1, 0);
+        size_t levelBegin = 0;
+        while (levelBegin < order.size())
+        {
+            size_t levelEnd = order.size();
+            levelStart.push_back(levelEnd);
+            for (size_t i = levelBegin; i < levelEnd; i++)
+                for (uint32_t c = childStart[order[i]]; c < childStart[order[i] + 1]; c++)
+                    order.push_back(children[c]);
+            levelBegin = levelEnd;
+        }
+
+        parents.resize(count);
+        locals.resize(count);
+        worlds.resize(count);
+        dirty.assign(count, 1);
+        for (size_t index = 0; index < order.size(); index++)
+            indexOfHandle[order[index]] = (uint32_t)index;
+        for (size_t index = 0; index < order.size(); index++)
+        {
+            uint32_t handle = order[index];
+            parents[index] = pendingParents[handle] == NO_PARENT ? NO_PARENT : indexOfHandle[pendingParents[handle]];
+            locals[index] = pendingLocals[handle];
+        }
+        handleOfIndex.swap(order);
+        layoutDirty = false;
+    }
+};
+
+#endif
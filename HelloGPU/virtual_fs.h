@@ -0,0 +1,150 @@
+#ifndef VIRTUAL_FS_H
+#define VIRTUAL_FS_H
+
+// Virtual file system that every asset load goes through. Mounted packs (asset_pack.h) are searched first, newest mount
+// wins, and anything not packed falls back to mapping the loose file from disk. So the code can keep using its
+// relative paths ("Shaders/vertexShader/...", "Textures/images/...") whether or not a pack is shipped
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "mapped_file.h"
+#include "asset_pack.h"
+
+// Bytes of one asset. Points straight into the pack mapping when the blob is stored uncompressed, otherwise owns a
+// decompressed buffer or a mapping of the loose file
+// ------------------------------------------------------------------------
+class AssetBlob
+{
+public:
+    AssetBlob() {}
+
+    static AssetBlob fromView(const unsigned char* data, size_t size)
+    {
+        AssetBlob blob;
+        blob.bytes = data;
+        blob.byteCount = size;
+        blob.isValid = true;
+        return blob;
+    }
+    static AssetBlob fromBuffer(std::vector<unsigned char>&& buffer)
+    {
+        AssetBlob blob;
+        blob.ownedBuffer.swap(buffer);
+        blob.bytes = blob.ownedBuffer.data();
+        blob.byteCount = blob.ownedBuffer.size();
+        blob.isValid = true;
+        return blob;
+    }
+    static AssetBlob fromMapping(MappedFile&& mapping)
+    {
+        AssetBlob blob;
+        blob.ownedMapping = std::move(mapping);
+        blob.bytes = blob.ownedMapping.data();
+        blob.byteCount = blob.ownedMapping.size();
+        blob.isValid = true;
+        return blob;
+    }
+
+    AssetBlob(AssetBlob&& other) { *this = std::move(other); }
+    AssetBlob& operator=(AssetBlob&& other)
+    {
+        if (this != &other)
+        {
+            // A moved std::vector keeps its heap block, so bytes stays valid for buffers as well as mappings
+            ownedBuffer = std::move(other.ownedBuffer);
+            ownedMapping = std::move(other.ownedMapping);
+            bytes = other.bytes;
+            byteCount = other.byteCount;
+            isValid = other.isValid;
+            other.bytes = NULL;
+            other.byteCount = 0;
+            other.isValid = false;
+        }
+        return *this;
+    }
+    AssetBlob(const AssetBlob&) = delete;
+    AssetBlob& operator=(const AssetBlob&) = delete;
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return byteCount; }
+    bool valid() const { return isValid; }
+
+private:
+    const unsigned char* bytes = NULL;
+    size_t byteCount = 0;
+    bool isValid = false;
+    std::vector<unsigned char> ownedBuffer;
+    MappedFile ownedMapping;
+};
+
+
+class VirtualFS
+{
+public:
+    // One VFS per process, shared by the Shader class and the texture loader
+    // ------------------------------------------------------------------------
+    static VirtualFS& get()
+    {
+        static VirtualFS instance;
+        return instance;
+    }
+
+    // Mount a pack. A missing pack is not an error (loose files are used instead), a corrupt one is reported by AssetPack
+    // ------------------------------------------------------------------------
+    bool mountPack(const std::string& packPath)
+    {
+        std::unique_ptr<AssetPack> pack(new AssetPack());
+        if (!pack->open(packPath))
+            return false;
+        std::cout << "VFS: Mounted " << packPath << " (" << pack->entryCount() << " assets)" << std::endl;
+        packs.push_back(std::move(pack));
+        return true;
+    }
+
+    // Open an asset by its relative path. Check valid() on the result
+    // ------------------------------------------------------------------------
+    AssetBlob open(const std::string& path) const
+    {
+        std::string normalized = normalizeAssetPath(path);
+
+        for (size_t i = packs.size(); i-- > 0;)
+        {
+            const PackEntry* entry = packs[i]->find(normalized);
+            if (entry == NULL)
+                continue;
+
+            const unsigned char* stored = packs[i]->storedData(*entry);
+            if (stored == NULL)
+            {
+                std::cout << "ERROR::VFS::ENTRY_OUT_OF_BOUNDS: " << normalized << std::endl;
+                return AssetBlob();
+            }
+            packs[i]->prefetch(*entry);
+
+            if ((entry->flags & PACK_ENTRY_LZ4) == 0)
+                return AssetBlob::fromView(stored, entry->storedSize);
+
+            std::vector<unsigned char> buffer(entry->rawSize);
+            if (lz4::decompress(stored, (int)entry->storedSize, buffer.data(), (int)entry->rawSize) < 0)
+            {
+                std::cout << "ERROR::VFS::CORRUPT_LZ4_BLOB: " << normalized << std::endl;
+                return AssetBlob();
+            }
+            return AssetBlob::fromBuffer(std::move(buffer));
+        }
+
+        MappedFile loose;
+        if (loose.open(normalized))
+            return AssetBlob::fromMapping(std::move(loose));
+        return AssetBlob();
+    }
+
+private:
+    VirtualFS() {}
+    std::vector<std::unique_ptr<AssetPack>> packs;
+};
+
+#endif
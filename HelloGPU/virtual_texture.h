@@ -0,0 +1,548 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+// Virtual texturing: an image of any size (a tile file from Tools/texture_tiler.cpp, see virtual_texture_format.h) drawn
+// from a fixed size page cache, so the VRAM it takes doesn't depend on how big the image is.
+//
+// - Page cache: one RGBA8 texture of cacheSidePages x cacheSidePages slots, each holding one page + its border
+// - Indirection texture: one texel per page of the virtual texture, with a mip level per level of the tile file. It tells
+//   the shader which slot to read for that page: (slot x, slot y, level of the page that is there). A page that isn't
+//   loaded points to the slot of its closest loaded ancestor, and the last level (one page) is always loaded, so there is
+//   always something to show while the detail streams in
+// - Feedback: the virtual textured geometry is drawn once more into a small target (the viewport / feedbackDivisor), with a
+//   shader writing the page and level each pixel wants. It's read back through a pixel buffer a frame or more later (no
+//   stall), only when the view changed
+// - Requested pages (coarse levels first) are read from the tile file and decompressed on the job system; the GL thread
+//   uploads a few per frame into free slots, or into the least recently requested one when the cache is full
+//
+// The CPU keeps the page table (page -> slot) and a copy of the indirection texture, and only uploads the rectangle of
+// each indirection level that a page mapping changed. The indirection texture is 4 bytes per page (about 1/16000 of the
+// image), the only part that grows with the image
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "gl_state_cache.h"
+#include "job_system.h"
+#include "lz4_lite.h"
+#include "redraw_tracker.h"
+#include "texture_objects.h"
+#include "virtual_fs.h"
+#include "virtual_texture_format.h"
+
+struct VirtualTextureSettings
+{
+    int cacheSidePages = 16;     // Slots on a side of the page cache (16: 256 pages, 2176x2176 RGBA8 = 18 MB)
+    int feedbackDivisor = 8;     // The feedback target is the viewport divided by this on each side
+    int maxUploadsPerFrame = 8;  // Pages put in the cache per frame (glTexSubImage2D of 136x136 each)
+    int maxPendingLoads = 16;    // Pages being read + decompressed on the job system at once
+};
+
+struct VirtualTextureStats
+{
+    unsigned int residentPages = 0;  // In the cache now
+    unsigned int cachePages = 0;     // Slots in the cache
+    unsigned int requestedPages = 0; // Asked for by the last feedback read back (with their ancestors)
+    unsigned int pagesLoaded = 0;    // Since the start
+    unsigned int pagesEvicted = 0;
+    unsigned int pendingLoads = 0;
+    unsigned int feedbackReads = 0;
+};
+
+class VirtualTexture
+{
+public:
+    VirtualTexture() {}
+    ~VirtualTexture() { waitForLoads(); }
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+    // GL thread. Map the tile file (through the VFS), create the cache + indirection textures and load the last level.
+    // False if the file is missing (silently: a virtual texture is optional content) or broken (with an error)
+    // ------------------------------------------------------------------------
+    bool load(const char* path, const VirtualTextureSettings& textureSettings = VirtualTextureSettings())
+    {
+        settings = textureSettings;
+        settings.cacheSidePages = std::min(std::max(settings.cacheSidePages, 2), 255); // Slot coordinates are stored in bytes
+        settings.feedbackDivisor = std::max(settings.feedbackDivisor, 1);
+        file = VirtualFS::get().open(path);
+        if (!file.valid())
+            return false;
+        if (!parseVirtualTextureFile(file.data(), file.size(), path, view))
+            return false;
+
+        const VirtualTextureFileHeader& header = view.header;
+        pageSlots.assign(header.pageCount, -1);
+        pageLoading.assign(header.pageCount, 0);
+        pageStamps.assign(header.pageCount, 0);
+        slots.assign((size_t)settings.cacheSidePages * settings.cacheSidePages, Slot());
+        indirection.resize(header.levelCount);
+        dirty.resize(header.levelCount);
+        for (uint32_t l = 0; l < header.levelCount; l++)
+            indirection[l].assign((size_t)view.levels[l].pagesPerSide * view.levels[l].pagesPerSide, 0);
+
+        // Page cache: bilinear, no mips (every page has the border it needs). sRGB files are decoded to linear by the sampler
+        int cacheTexels = settings.cacheSidePages * (int)VT_STORED_PAGE_SIZE;
+        GLenum cacheFormat = (header.flags & VT_FLAG_SRGB) ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        cacheTexture = createTexture2D(cacheFormat, cacheTexels, cacheTexels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        // Indirection: read with texelFetch, one mip level per level of the file
+        indirectionTexture = createTexture2D(GL_RGBA8, (GLsizei)header.pagesPerSide, (GLsizei)header.pagesPerSide, (GLsizei)header.levelCount);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        // The last level goes in slot 0 for good: the fallback of every page
+        std::vector<unsigned char> texels;
+        uint32_t lastPage = header.pageCount - 1;
+        if (!readPage(lastPage, texels))
+        {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::CORRUPT_PAGE: " << path << " (page " << lastPage << ")" << std::endl;
+            release();
+            return false;
+        }
+        glBindTexture(GL_TEXTURE_2D, cacheTexture);
+        putInSlot(0, lastPage, texels.data());
+        slots[0].pinned = true;
+        glBindTexture(GL_TEXTURE_2D, indirectionTexture);
+        uploadIndirection();
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // Feedback target + read back buffers
+        glGenFramebuffers(1, &feedbackFramebuffer);
+        glGenBuffers(FEEDBACK_BUFFERS, feedbackBuffers);
+        currentStats.cachePages = (unsigned int)slots.size();
+        return true;
+    }
+
+    bool loaded() const { return cacheTexture != 0; }
+    uint32_t imageWidth() const { return view.header.imageWidth; }
+    uint32_t imageHeight() const { return view.header.imageHeight; }
+
+    // Set the uniforms of a program that samples this virtual texture (VirtualTexture_fragSh.glsl or the feedback shader),
+    // with the cache on 'cacheUnit' and the indirection on 'indirectionUnit'. The program must be in use
+    // ------------------------------------------------------------------------
+    void setupProgram(GLuint program, GLuint cacheUnit, GLuint indirectionUnit) const
+    {
+        float virtualScale = 1.0f / (float)(view.header.pagesPerSide * VT_PAGE_SIZE);
+        glUniform1i(glGetUniformLocation(program, "vtCache"), (GLint)cacheUnit);
+        glUniform1i(glGetUniformLocation(program, "vtIndirection"), (GLint)indirectionUnit);
+        glUniform1i(glGetUniformLocation(program, "vtPagesPerSide"), (GLint)view.header.pagesPerSide);
+        glUniform1i(glGetUniformLocation(program, "vtMaxLevel"), (GLint)view.header.levelCount - 1);
+        glUniform2f(glGetUniformLocation(program, "vtImageScale"), (float)view.header.imageWidth * virtualScale, (float)view.header.imageHeight * virtualScale);
+        glUniform1f(glGetUniformLocation(program, "vtCacheTexels"), (float)(settings.cacheSidePages * VT_STORED_PAGE_SIZE));
+        glUniform1f(glGetUniformLocation(program, "vtFeedbackBias"), std::log2((float)settings.feedbackDivisor));
+    }
+
+    void bind(GLStateCache& stateCache, GLuint cacheUnit, GLuint indirectionUnit) const
+    {
+        stateCache.bindTexture(cacheUnit, GL_TEXTURE_2D, cacheTexture);
+        stateCache.bindTexture(indirectionUnit, GL_TEXTURE_2D, indirectionTexture);
+        stateCache.bindSampler(cacheUnit, 0); // Their filtering is set on the textures, fixed for their lifetime
+        stateCache.bindSampler(indirectionUnit, 0);
+    }
+
+    // Feedback pass. Only needed when what is on screen changed: 'viewKey' is anything that changes with it (the
+    // model-view-projection matrix of the geometry, 16 floats) and the viewport size. If this returns true, draw the virtual
+    // textured geometry with the feedback program, then call endFeedback(). Saves and restores the bound framebuffer
+    // and viewport. A new feedback size recreates its target behind 'stateCache' (then invalidated)
+    // ------------------------------------------------------------------------
+    bool beginFeedback(GLStateCache& stateCache, const float* viewKey, int viewportWidth, int viewportHeight)
+    {
+        if (!loaded() || viewportWidth <= 0 || viewportHeight <= 0)
+            return false;
+        int width = std::max(1, viewportWidth / settings.feedbackDivisor), height = std::max(1, viewportHeight / settings.feedbackDivisor);
+        bool changed = width != feedbackWidth || height != feedbackHeight || std::memcmp(viewKey, lastViewKey, sizeof(lastViewKey)) != 0;
+        if (!changed || feedbackFences[feedbackWrite] != 0)
+            return false; // Same view as the last feedback, or every read back buffer is still in flight
+        std::memcpy(lastViewKey, viewKey, sizeof(lastViewKey));
+
+        if (width != feedbackWidth || height != feedbackHeight)
+        {
+            feedbackWidth = width;
+            feedbackHeight = height;
+            if (feedbackTexture)
+                glDeleteTextures(1, &feedbackTexture); // Immutable: a new size is a new texture
+            feedbackTexture = createTexture2D(GL_RGBA8, width, height);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            stateCache.invalidate(); // Bound on whatever unit was active, the cache can't know which
+            glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedFramebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackTexture, 0);
+            glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)savedFramebuffer);
+            for (int b = 0; b < FEEDBACK_BUFFERS; b++)
+            {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[b]);
+                glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, savedViewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+        glViewport(0, 0, feedbackWidth, feedbackHeight);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f); // Alpha 0: no page wanted
+        glClear(GL_COLOR_BUFFER_BIT);
+        return true;
+    }
+
+    void endFeedback()
+    {
+        // Into a pixel buffer: glReadPixels returns at once, the bytes are mapped in a later update() once the fence passed
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[feedbackWrite]);
+        glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        feedbackFences[feedbackWrite] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        feedbackWrite = (feedbackWrite + 1) % FEEDBACK_BUFFERS;
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)savedFramebuffer);
+        glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+        RedrawTracker::get().requestRender(); // Another frame has to come to read it back
+    }
+
+    // GL thread, once per frame before drawing with the texture: reads back finished feedback, starts loading what it asks
+    // for, puts finished loads in the cache and updates the indirection. Binds through 'stateCache' (unit 0)
+    // ------------------------------------------------------------------------
+    void update(GLStateCache& stateCache)
+    {
+        if (!loaded())
+            return;
+        readFeedback();
+        startLoads();
+
+        // Finished loads -> cache slots. A page can only take the slot of one nobody asked for this time
+        bool uploaded = false;
+        int uploads = 0;
+        for (size_t i = 0; i < pendingLoads.size() && uploads < settings.maxUploadsPerFrame;)
+        {
+            PageLoad& load = *pendingLoads[i];
+            if (!load.done.done())
+            {
+                i++;
+                continue;
+            }
+            int slot = load.ok ? findFreeSlot() : -1;
+            if (slot >= 0)
+            {
+                if (!uploaded)
+                    stateCache.bindTextureForEdit(0, GL_TEXTURE_2D, cacheTexture);
+                putInSlot(slot, load.page, load.texels.data());
+                uploaded = true;
+                uploads++;
+            }
+            else if (!load.ok)
+                std::cout << "ERROR::VIRTUAL_TEXTURE::CORRUPT_PAGE: page " << load.page << std::endl;
+            pageLoading[load.page] = 0;
+            pendingLoads.erase(pendingLoads.begin() + i);
+        }
+        if (uploaded)
+        {
+            stateCache.bindTextureForEdit(0, GL_TEXTURE_2D, indirectionTexture);
+            uploadIndirection();
+        }
+        if (uploads == settings.maxUploadsPerFrame)
+            RedrawTracker::get().requestRender(); // More may be waiting
+        currentStats.pendingLoads = (unsigned int)pendingLoads.size();
+    }
+
+    const VirtualTextureStats& stats() const { return currentStats; }
+
+    // GL thread
+    void release()
+    {
+        waitForLoads();
+        pendingLoads.clear();
+        for (int b = 0; b < FEEDBACK_BUFFERS; b++)
+            if (feedbackFences[b])
+            {
+                glDeleteSync(feedbackFences[b]);
+                feedbackFences[b] = 0;
+            }
+        if (cacheTexture)
+        {
+            glDeleteTextures(1, &cacheTexture);
+            glDeleteTextures(1, &indirectionTexture);
+            if (feedbackTexture)
+                glDeleteTextures(1, &feedbackTexture);
+            glDeleteFramebuffers(1, &feedbackFramebuffer);
+            glDeleteBuffers(FEEDBACK_BUFFERS, feedbackBuffers);
+        }
+        cacheTexture = indirectionTexture = feedbackTexture = feedbackFramebuffer = 0;
+        feedbackWidth = feedbackHeight = 0;
+        file = AssetBlob();
+    }
+
+private:
+    static const int FEEDBACK_BUFFERS = 3;
+
+    struct Slot
+    {
+        int32_t page = -1;
+        uint64_t lastRequested = 0; // Feedback frame that last asked for its page
+        bool pinned = false;
+    };
+
+    struct PageLoad
+    {
+        JobCounter done;
+        uint32_t page = 0;
+        std::vector<unsigned char> texels;
+        bool ok = false;
+    };
+
+    // Page 'page' (index into the page table) decompressed to VT_STORED_PAGE_BYTES. Any thread
+    bool readPage(uint32_t page, std::vector<unsigned char>& texels) const
+    {
+        const VirtualTextureFilePage& entry = view.pages[page];
+        texels.resize(VT_STORED_PAGE_BYTES);
+        if (entry.size == 0)
+            return false;
+        const unsigned char* stored = view.data + entry.offset;
+        if (entry.flags & VT_PAGE_LZ4)
+            return lz4::decompress(stored, (int)entry.size, texels.data(), (int)texels.size()) == (int)texels.size();
+        if (entry.size != VT_STORED_PAGE_BYTES)
+            return false;
+        std::memcpy(texels.data(), stored, texels.size());
+        return true;
+    }
+
+    void pageLocation(uint32_t page, uint32_t& level, uint32_t& x, uint32_t& y) const
+    {
+        level = 0;
+        while (level + 1 < view.header.levelCount && page >= view.levels[level + 1].firstPage)
+            level++;
+        uint32_t index = page - view.levels[level].firstPage;
+        x = index % view.levels[level].pagesPerSide;
+        y = index / view.levels[level].pagesPerSide;
+    }
+
+    // The cache texture must be bound. Replaces whatever page was there
+    void putInSlot(int slot, uint32_t page, const unsigned char* texels)
+    {
+        Slot& target = slots[slot];
+        if (target.page >= 0)
+        {
+            pageSlots[target.page] = -1;
+            remapFootprint((uint32_t)target.page);
+            currentStats.pagesEvicted++;
+            currentStats.residentPages--;
+        }
+        int sideX = slot % settings.cacheSidePages, sideY = slot / settings.cacheSidePages;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, sideX * (GLint)VT_STORED_PAGE_SIZE, sideY * (GLint)VT_STORED_PAGE_SIZE, VT_STORED_PAGE_SIZE, VT_STORED_PAGE_SIZE,
+            GL_RGBA, GL_UNSIGNED_BYTE, texels);
+        target.page = (int32_t)page;
+        target.lastRequested = requestFrame;
+        pageSlots[page] = slot;
+        remapFootprint(page);
+        currentStats.pagesLoaded++;
+        currentStats.residentPages++;
+    }
+
+    // An empty slot, or the least recently requested one that the last feedback didn't ask for. -1 if every slot is wanted
+    int findFreeSlot() const
+    {
+        int best = -1;
+        for (size_t s = 0; s < slots.size(); s++)
+        {
+            const Slot& slot = slots[s];
+            if (slot.pinned)
+                continue;
+            if (slot.page < 0)
+                return (int)s;
+            if (slot.lastRequested < requestFrame && (best < 0 || slot.lastRequested < slots[best].lastRequested))
+                best = (int)s;
+        }
+        return best;
+    }
+
+    // A page got loaded or evicted: every indirection texel under it (its own level and the finer ones) points to the
+    // closest loaded page again. Coarse to fine, so a texel can take its parent's entry
+    void remapFootprint(uint32_t page)
+    {
+        uint32_t pageLevel, pageX, pageY;
+        pageLocation(page, pageLevel, pageX, pageY);
+        for (int l = (int)pageLevel; l >= 0; l--)
+        {
+            uint32_t shift = pageLevel - (uint32_t)l;
+            uint32_t side = view.levels[l].pagesPerSide, span = 1u << shift;
+            uint32_t x0 = pageX << shift, y0 = pageY << shift;
+            std::vector<uint32_t>& entries = indirection[l];
+            for (uint32_t y = y0; y < y0 + span; y++)
+            {
+                for (uint32_t x = x0; x < x0 + span; x++)
+                {
+                    int slot = pageSlots[view.levels[l].firstPage + y * side + x];
+                    uint32_t entry;
+                    if (slot >= 0)
+                        entry = (uint32_t)(slot % settings.cacheSidePages) | (uint32_t)(slot / settings.cacheSidePages) << 8 | (uint32_t)l << 16 | 0xFF000000u;
+                    else if (l + 1 < (int)view.header.levelCount)
+                        entry = indirection[l + 1][(y / 2) * view.levels[l + 1].pagesPerSide + x / 2];
+                    else
+                        entry = 0;
+                    entries[y * side + x] = entry;
+                }
+            }
+            DirtyRect& rect = dirty[l];
+            rect.x0 = std::min(rect.x0, x0);
+            rect.y0 = std::min(rect.y0, y0);
+            rect.x1 = std::max(rect.x1, x0 + span);
+            rect.y1 = std::max(rect.y1, y0 + span);
+        }
+    }
+
+    // The indirection texture must be bound. Only the changed rectangle of each level
+    void uploadIndirection()
+    {
+        for (uint32_t l = 0; l < view.header.levelCount; l++)
+        {
+            DirtyRect& rect = dirty[l];
+            if (rect.x0 >= rect.x1)
+                continue;
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)view.levels[l].pagesPerSide);
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, (GLint)rect.x0);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, (GLint)rect.y0);
+            glTexSubImage2D(GL_TEXTURE_2D, (GLint)l, (GLint)rect.x0, (GLint)rect.y0, (GLsizei)(rect.x1 - rect.x0), (GLsizei)(rect.y1 - rect.y0),
+                GL_RGBA, GL_UNSIGNED_BYTE, indirection[l].data());
+            rect = DirtyRect();
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    }
+
+    // Map the oldest feedback whose fence passed and turn it into the list of pages to load
+    void readFeedback()
+    {
+        GLsync fence = feedbackFences[feedbackRead];
+        if (fence == 0)
+            return;
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            RedrawTracker::get().requestRender(); // Not there yet, look again next frame
+            return;
+        }
+        glDeleteSync(fence);
+        feedbackFences[feedbackRead] = 0;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[feedbackRead]);
+        feedbackRead = (feedbackRead + 1) % FEEDBACK_BUFFERS;
+        size_t bytes = (size_t)feedbackWidth * feedbackHeight * 4;
+        const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+        if (!pixels)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            return;
+        }
+
+        // Every page asked for plus its ancestors (they're the fallback while it loads, and must not be evicted for it)
+        requestFrame++;
+        requests.clear();
+        currentStats.requestedPages = 0;
+        for (size_t p = 0; p < bytes; p += 4)
+        {
+            uint32_t level = pixels[p + 3];
+            if (level == 0)
+                continue; // Nothing virtual textured there
+            level--;
+            uint32_t x = pixels[p] | (uint32_t)(pixels[p + 2] & 15) << 8;
+            uint32_t y = pixels[p + 1] | (uint32_t)(pixels[p + 2] >> 4) << 8;
+            for (; level < view.header.levelCount; level++, x /= 2, y /= 2)
+            {
+                uint32_t side = view.levels[level].pagesPerSide;
+                if (x >= side || y >= side)
+                    break;
+                uint32_t page = view.levels[level].firstPage + y * side + x;
+                if (pageStamps[page] == requestFrame)
+                    break; // Seen, and so are its ancestors
+                pageStamps[page] = requestFrame;
+                currentStats.requestedPages++;
+                if (pageSlots[page] >= 0)
+                    slots[pageSlots[page]].lastRequested = requestFrame;
+                else if (view.pages[page].size != 0)
+                    requests.push_back(page);
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        // Coarse levels first: they show up fast and cover the most
+        std::sort(requests.begin(), requests.end(), [](uint32_t a, uint32_t b) { return a > b; });
+        currentStats.feedbackReads++;
+    }
+
+    // Start reading + decompressing the requested pages that aren't there yet, on the job system
+    void startLoads()
+    {
+        while (!requests.empty() && (int)pendingLoads.size() < settings.maxPendingLoads)
+        {
+            uint32_t page = requests.front();
+            requests.erase(requests.begin());
+            if (pageSlots[page] >= 0 || pageLoading[page])
+                continue;
+            pageLoading[page] = 1;
+            pendingLoads.emplace_back(new PageLoad());
+            PageLoad* load = pendingLoads.back().get();
+            load->page = page;
+            JobSystem::get().run([this, load]()
+            {
+                load->ok = readPage(load->page, load->texels); // Page faults on the mapped tile file happen here, off the GL thread
+                RedrawTracker::get().requestRender();
+            }, &load->done);
+        }
+    }
+
+    void waitForLoads()
+    {
+        for (size_t i = 0; i < pendingLoads.size(); i++)
+            JobSystem::get().wait(pendingLoads[i]->done);
+    }
+
+    struct DirtyRect
+    {
+        uint32_t x0 = 0xFFFFFFFFu, y0 = 0xFFFFFFFFu, x1 = 0, y1 = 0;
+    };
+
+    VirtualTextureSettings settings;
+    AssetBlob file; // The mapped tile file, read by the load jobs
+    VirtualTextureView view;
+
+    std::vector<int32_t> pageSlots;              // Page -> cache slot, -1 if not loaded
+    std::vector<uint8_t> pageLoading;            // Page -> a load is in flight
+    std::vector<uint64_t> pageStamps;            // Page -> last feedback that asked for it
+    std::vector<Slot> slots;
+    std::vector<std::vector<uint32_t>> indirection; // CPU copy of each level of the indirection texture (RGBA8 texels)
+    std::vector<DirtyRect> dirty;
+    std::vector<uint32_t> requests;              // Pages still to load from the last feedback, coarse first
+    std::vector<std::unique_ptr<PageLoad>> pendingLoads;
+    uint64_t requestFrame = 0;                   // Counts the feedbacks read back
+
+    GLuint cacheTexture = 0;
+    GLuint indirectionTexture = 0;
+    GLuint feedbackFramebuffer = 0;
+    GLuint feedbackTexture = 0;
+    GLuint feedbackBuffers[FEEDBACK_BUFFERS] = {};
+    GLsync feedbackFences[FEEDBACK_BUFFERS] = {};
+    int feedbackWrite = 0;
+    int feedbackRead = 0;
+    int feedbackWidth = 0;
+    int feedbackHeight = 0;
+    float lastViewKey[16] = {};
+    GLint savedFramebuffer = 0;
+    GLint savedViewport[4] = {};
+
+    VirtualTextureStats currentStats;
+};
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef VIRTUAL_TEXTURE_FORMAT_H
+#define VIRTUAL_TEXTURE_FORMAT_H
+
+// Tile file of a virtual texture (.hgvt): an image of any size cut into pages of VT_PAGE_SIZE x VT_PAGE_SIZE texels, at
+// every mip level, so the app only ever has the pages it looks at on the GPU (see virtual_texture.h). Written by
+// Tools/texture_tiler.cpp
+//
+// Layout:
+//   VirtualTextureFileHeader               (48 bytes)
+//   VirtualTextureFileLevel[levelCount]    (16 bytes each, finest first)
+//   VirtualTextureFilePage[pageCount]      (16 bytes each: where each page's bytes are, level by level, row by row)
+//   page data                              (RGBA8 texels, LZ4 compressed when that is smaller, see lz4_lite.h)
+//
+// Virtual space: the image is put in the corner of a square of (pages at level 0) x VT_PAGE_SIZE texels, with a power of
+// two number of pages on a side, so every level is exactly half the one before in pages and the last level is one page.
+// Texcoords 0..1 over the image are (imageWidth, imageHeight) / virtualSize of that square. Pages that are all outside the
+// image aren't stored (size 0) and are never asked for
+//
+// Every stored page is VT_PAGE_SIZE + 2 * VT_PAGE_BORDER texels on a side: the page plus a border copied from its
+// neighbours (edge texels repeated at the border of the image), so bilinear filtering at the edge of a page doesn't need
+// the page next to it in the cache.
+//
+// All integers are little endian; this header doesn't need GL so the tools can use it
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const char VT_MAGIC[4] = { 'H', 'G', 'V', 'T' };
+const uint32_t VT_VERSION = 1;
+const uint32_t VT_PAGE_SIZE = 128;                                  // Texels of the image per page side
+const uint32_t VT_PAGE_BORDER = 4;                                  // Texels of border on each side
+const uint32_t VT_STORED_PAGE_SIZE = VT_PAGE_SIZE + 2 * VT_PAGE_BORDER; // 136: what a page takes in the file and in the cache
+const uint32_t VT_MAX_LEVELS = 11;                                  // Up to 1024 pages (131072 texels) on a side
+const uint32_t VT_PAGE_LZ4 = 1;                                     // VirtualTextureFilePage::flags
+const uint32_t VT_FLAG_SRGB = 1;                                    // VirtualTextureFileHeader::flags: color texels, sRGB encoded
+
+struct VirtualTextureFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t imageWidth;       // Of the source image (level 0)
+    uint32_t imageHeight;
+    uint32_t pagesPerSide;     // At level 0, a power of two
+    uint32_t pageSize;         // VT_PAGE_SIZE
+    uint32_t pageBorder;       // VT_PAGE_BORDER
+    uint32_t levelCount;       // log2(pagesPerSide) + 1
+    uint32_t pageCount;        // Of all levels, stored or not
+    uint32_t flags;            // VT_FLAG_SRGB (levels were filtered in linear space, the cache is GL_SRGB8_ALPHA8)
+    uint64_t pageTableOffset;  // From the start of the file
+};
+
+struct VirtualTextureFileLevel
+{
+    uint32_t pagesPerSide;     // pagesPerSide of the header >> level
+    uint32_t firstPage;        // Into the page table
+    uint32_t imageWidth;       // Of the image at this level (texels past it are padding)
+    uint32_t imageHeight;
+};
+
+struct VirtualTextureFilePage
+{
+    uint64_t offset;           // From the start of the file; 0 with size 0 = not stored (outside the image)
+    uint32_t size;             // Bytes stored
+    uint32_t flags;            // VT_PAGE_LZ4
+};
+
+static_assert(sizeof(VirtualTextureFileHeader) == 48, "VirtualTextureFileHeader layout is part of the file format");
+static_assert(sizeof(VirtualTextureFileLevel) == 16, "VirtualTextureFileLevel layout is part of the file format");
+static_assert(sizeof(VirtualTextureFilePage) == 16, "VirtualTextureFilePage layout is part of the file format");
+
+const size_t VT_STORED_PAGE_BYTES = (size_t)VT_STORED_PAGE_SIZE * VT_STORED_PAGE_SIZE * 4;
+
+
+// Read side: checks a tile file in memory and points into it (nothing is copied, the bytes must stay alive)
+// ------------------------------------------------------------------------
+struct VirtualTextureView
+{
+    VirtualTextureFileHeader header = {};
+    const VirtualTextureFileLevel* levels = NULL;
+    const VirtualTextureFilePage* pages = NULL;
+    const unsigned char* data = NULL; // The whole file, page offsets are from here
+};
+
+inline bool parseVirtualTextureFile(const unsigned char* data, size_t size, const std::string& name, VirtualTextureView& view)
+{
+    if (data == NULL || size < sizeof(VirtualTextureFileHeader))
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::TRUNCATED_HEADER: " << name << std::endl;
+        return false;
+    }
+    std::memcpy(&view.header, data, sizeof(VirtualTextureFileHeader));
+    const VirtualTextureFileHeader& header = view.header;
+    if (std::memcmp(header.magic, VT_MAGIC, 4) != 0 || header.version != VT_VERSION)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::BAD_MAGIC_OR_VERSION: " << name << std::endl;
+        return false;
+    }
+    if (header.pageSize != VT_PAGE_SIZE || header.pageBorder != VT_PAGE_BORDER || header.levelCount == 0 || header.levelCount > VT_MAX_LEVELS
+        || header.pagesPerSide != (1u << (header.levelCount - 1)))
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::BAD_HEADER: " << name << std::endl;
+        return false;
+    }
+    // Offsets come from the file: compare the bytes against what is left after the offset, offset + bytes could wrap around
+    uint64_t pageTableBytes = (uint64_t)header.pageCount * sizeof(VirtualTextureFilePage);
+    if (sizeof(VirtualTextureFileHeader) + header.levelCount * sizeof(VirtualTextureFileLevel) > size
+        || header.pageTableOffset > size || pageTableBytes > size - header.pageTableOffset)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::TRUNCATED_DATA: " << name << std::endl;
+        return false;
+    }
+    view.levels = (const VirtualTextureFileLevel*)(data + sizeof(VirtualTextureFileHeader));
+    view.pages = (const VirtualTextureFilePage*)(data + header.pageTableOffset);
+    view.data = data;
+    uint32_t pageCount = 0;
+    for (uint32_t l = 0; l < header.levelCount; l++)
+    {
+        const VirtualTextureFileLevel& level = view.levels[l];
+        if (level.pagesPerSide != header.pagesPerSide >> l || level.firstPage != pageCount)
+        {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::BAD_LEVEL: " << name << " (level " << l << ")" << std::endl;
+            return false;
+        }
+        pageCount += level.pagesPerSide * level.pagesPerSide;
+    }
+    if (pageCount != header.pageCount)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::BAD_PAGE_TABLE: " << name << std::endl;
+        return false;
+    }
+    for (uint32_t p = 0; p < header.pageCount; p++)
+    {
+        const VirtualTextureFilePage& page = view.pages[p];
+        if (page.offset > size || page.size > size - page.offset || page.size > VT_STORED_PAGE_BYTES)
+        {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::BAD_PAGE: " << name << " (page " << p << ")" << std::endl;
+            return false;
+        }
+    }
+    // The last level is the fallback of every other page, it has to be there
+    if (view.pages[header.pageCount - 1].size == 0)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::MISSING_LAST_LEVEL: " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+// Write side: used by the offline tiler (Tools/texture_tiler.cpp). 'pageData' holds the stored bytes of every page in
+// page table order, 'pages' their flags and sizes (offsets are filled in here)
+// ------------------------------------------------------------------------
+inline bool writeVirtualTextureFile(const std::string& path, VirtualTextureFileHeader header, const std::vector<VirtualTextureFileLevel>& levels,
+    std::vector<VirtualTextureFilePage> pages, const std::vector<std::vector<unsigned char>>& pageData)
+{
+    if (levels.size() != header.levelCount || pages.size() != header.pageCount || pageData.size() != pages.size())
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::BAD_TILE_INPUT: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(header.magic, VT_MAGIC, 4);
+    header.version = VT_VERSION;
+    header.pageTableOffset = sizeof(VirtualTextureFileHeader) + levels.size() * sizeof(VirtualTextureFileLevel);
+    uint64_t offset = header.pageTableOffset + pages.size() * sizeof(VirtualTextureFilePage);
+    for (size_t p = 0; p < pages.size(); p++)
+    {
+        pages[p].size = (uint32_t)pageData[p].size();
+        pages[p].offset = pages[p].size ? offset : 0;
+        offset += pages[p].size;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::CANNOT_CREATE: " << path << std::endl;
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)levels.data(), (std::streamsize)(levels.size() * sizeof(VirtualTextureFileLevel)));
+    file.write((const char*)pages.data(), (std::streamsize)(pages.size() * sizeof(VirtualTextureFilePage)));
+    for (size_t p = 0; p < pageData.size(); p++)
+        file.write((const char*)pageData[p].data(), (std::streamsize)pageData[p].size());
+    if (!file)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::WRITE_FAILED: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif